@@ -42,6 +42,7 @@
 #include "sim-config.h"
 #include "arch.h"
 #include "stats.h"
+#include "toplevel-support.h"
 
 /* Branch prediction buffer */
 
@@ -306,3 +307,15 @@ reg_bpb_sec ()
   reg_config_param (sec, "missdelay",   PARAMT_INT, bpb_missdelay);
   reg_config_param (sec, "hitdelay",    PARAMT_INT, bpb_hitdelay);
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the branch prediction buffer and BTIC as simulator state        */
+/*---------------------------------------------------------------------------*/
+void
+reg_bpb_state ()
+{
+  reg_sim_state (&bpb, sizeof (bpb));
+  reg_sim_state (&btic, sizeof (btic));
+
+}	/* reg_bpb_state() */
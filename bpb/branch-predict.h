@@ -38,5 +38,6 @@ extern void  bpb_update (oraddr_t addr, int taken);
 extern void  btic_info ();
 extern void  btic_update (oraddr_t targetaddr);
 extern void  reg_bpb_sec ();
+extern void  reg_bpb_state ();
 
 #endif	/* BRANCH_PREDICT__H */
@@ -31,6 +31,11 @@
 
 /* Autoconf and/or portability configuration */
 #include "config.h"
+#include "port.h"
+
+/* System includes */
+#include <stdlib.h>
+#include <string.h>
 
 /* Package includes */
 #include "dcache-model.h"
@@ -40,18 +45,42 @@
 #include "stats.h"
 #include "misc.h"
 #include "pcu.h"
+#include "toplevel-support.h"
+#include "checkpoint.h"
+
+/* Data cache.  The configuration lives in config.dc; the derived shifts and
+   masks and the cache arrays themselves are set up by dc_end_sec ().  The
+   arrays are sized then, so the shape of the cache cannot be changed
+   afterwards (for example with the "set" command).  Without a dc section
+   there are no arrays, and all accesses go straight to memory.
+
+   Tags and usage states are held in compact per-set arrays (way i of set s
+   is at index (s << ways_log2) + i), so a lookup only touches the tags of
+   one set.  The most recently used way of each set is remembered and probed
+   first.  Since that way always holds the top usage state, a hit on it needs
+   no LRU update at all.  The line data is kept in its own array and only
+   touched once the way is known.
 
-/* Data cache */
+   With stats_only set there is no line data at all.  Tags and usage states
+   are tracked as usual, but every access goes straight to memory, with the
+   cycle cost of a hit or refill accounted as if the line had been held. */
 
-struct dc_set
+#define DC_NO_MRU  0xff			/*!< No MRU way known for the set */
+
+static struct
 {
-  struct
-  {
-    uint32_t line[MAX_DC_BLOCK_SIZE/4];
-    oraddr_t tagaddr;		/* tag address */
-    int lru;			/* least recently used */
-  } way[MAX_DC_WAYS];
-} dc[MAX_DC_SETS];
+  oraddr_t      *tags;			/*!< nsets * nways tag addresses */
+  int           *lrus;			/*!< nsets * nways usage states */
+  uint8_t       *mru;			/*!< Most recently used way per set */
+  uint32_t      *lines;			/*!< Line data (NULL if stats_only) */
+  unsigned int   ways_log2;		/*!< log2(nways) */
+  unsigned int   blocksize_log2;	/*!< log2(blocksize) */
+  unsigned int   tag_shift;		/*!< log2(blocksize * nsets) */
+  unsigned int   line_words_log2;	/*!< log2(words per line) */
+  oraddr_t       set_mask;		/*!< nsets - 1 */
+  oraddr_t       block_offset_mask;	/*!< blocksize - 1 */
+  int            ustates_reload;	/*!< ustates - 1 */
+} dc;
 
 void
 dc_info (void)
@@ -68,6 +97,254 @@ dc_info (void)
 	  config.dc.nsets, config.dc.blocksize);
 }
 
+
+/*---------------------------------------------------------------------------*/
+/*!Find the way of a set holding a tag
+
+   The MRU way is tried first, then the remaining ways.  At most one way can
+   hold any given tag.
+
+   @param[in] base    Index of way 0 of the set in the tag array
+   @param[in] set     The set
+   @param[in] tagaddr The tag to look for
+
+   @return  The matching way, or -1 if there is none                         */
+/*---------------------------------------------------------------------------*/
+static inline int
+dc_find_way (unsigned int  base,
+	     unsigned int  set,
+	     oraddr_t      tagaddr)
+{
+  const oraddr_t *tags = &dc.tags[base];
+  unsigned int    mru  = dc.mru[set];
+  int             i;
+
+  if ((mru != DC_NO_MRU) && (tags[mru] == tagaddr))
+    return mru;
+
+  for (i = 0; i < config.dc.nways; i++)
+    if (tags[i] == tagaddr)
+      return i;
+
+  return -1;
+
+}	/* dc_find_way() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Mark a way as most recently used after a hit
+
+   Decrement the usage state of every way above the hit way, then give the
+   hit way the top usage state.  Nothing changes if the way is already the
+   MRU way.
+
+   @param[in] base  Index of way 0 of the set
+   @param[in] set   The set
+   @param[in] way   The way which hit                                        */
+/*---------------------------------------------------------------------------*/
+static inline void
+dc_touch_way (unsigned int  base,
+	      unsigned int  set,
+	      int           way)
+{
+  int *lrus = &dc.lrus[base];
+  int  i;
+
+  if (way == dc.mru[set])
+    return;
+
+  for (i = 0; i < config.dc.nways; i++)
+    if (lrus[i] > lrus[way])
+      lrus[i]--;
+
+  lrus[way]    = dc.ustates_reload;
+  dc.mru[set] = way;
+
+}	/* dc_touch_way() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Mark a way as most recently used after a refill
+
+   Decrement every non-zero usage state, then give the new way the top usage
+   state.
+
+   @param[in] base  Index of way 0 of the set
+   @param[in] set   The set
+   @param[in] way   The way which was refilled                               */
+/*---------------------------------------------------------------------------*/
+static inline void
+dc_fill_way (unsigned int  base,
+	     unsigned int  set,
+	     int           way)
+{
+  int *lrus = &dc.lrus[base];
+  int  i;
+
+  for (i = 0; i < config.dc.nways; i++)
+    if (lrus[i])
+      lrus[i]--;
+
+  lrus[way]    = dc.ustates_reload;
+  dc.mru[set] = way;
+
+}	/* dc_fill_way() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Invalidate one way of a set
+
+   @param[in] base  Index of way 0 of the set
+   @param[in] set   The set
+   @param[in] way   The way to invalidate                                    */
+/*---------------------------------------------------------------------------*/
+static inline void
+dc_kill_way (unsigned int  base,
+	     unsigned int  set,
+	     int           way)
+{
+  dc.tags[base + way] = -1;
+  dc.lrus[base + way] = 0;
+
+  if (dc.mru[set] == way)
+    dc.mru[set] = DC_NO_MRU;
+
+}	/* dc_kill_way() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Choose the way of a set to replace on a miss
+
+   A read replaces the way with the lowest usage state below the top one.  A
+   write has always taken the last such way instead, which is kept so that
+   results do not change.
+
+   @param[in] base   Index of way 0 of the set
+   @param[in] write  Non-zero for a write miss
+
+   @return  The way to replace                                               */
+/*---------------------------------------------------------------------------*/
+static inline int
+dc_pick_way (unsigned int  base,
+	     int           write)
+{
+  const int *lrus   = &dc.lrus[base];
+  int        minlru = dc.ustates_reload;
+  int        minway = 0;
+  int        i;
+
+  for (i = 0; i < config.dc.nways; i++)
+    if (lrus[i] < minlru)
+      {
+	minway = i;
+	if (!write)
+	  minlru = lrus[i];
+      }
+
+  return minway;
+
+}	/* dc_pick_way() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Account a cache access when only statistics are kept
+
+   Update the tags, usage states and statistics, and charge the hit or miss
+   delay.  A miss also costs the memory reads a refill would have made.  The
+   caller has already made the access itself, so cur_area is valid.
+
+   @param[in] dataaddr  The physical address accessed
+   @param[in] write     Non-zero for a write                                 */
+/*---------------------------------------------------------------------------*/
+static void
+dc_stats_access (oraddr_t  dataaddr,
+		 int       write)
+{
+  unsigned int  set     = (dataaddr >> dc.blocksize_log2) & dc.set_mask;
+  oraddr_t      tagaddr = dataaddr >> dc.tag_shift;
+  unsigned int  base    = set << dc.ways_log2;
+  int           way     = dc_find_way (base, set, tagaddr);
+
+  if (way >= 0)
+    {
+      if (write)
+	{
+	  dc_stats.writehit++;
+	  runtime.sim.mem_cycles += config.dc.store_hitdelay;
+	}
+      else
+	{
+	  dc_stats.readhit++;
+	  runtime.sim.mem_cycles += config.dc.load_hitdelay;
+	}
+
+      dc_touch_way (base, set, way);
+      return;
+    }
+
+  way = dc_pick_way (base, write);
+  dc.tags[base + way] = tagaddr;
+  dc_fill_way (base, set, way);
+
+  if (write)
+    {
+      dc_stats.writemiss++;
+      runtime.sim.mem_cycles += config.dc.store_missdelay;
+    }
+  else
+    {
+      dc_stats.readmiss++;
+      runtime.sim.mem_cycles += config.dc.load_missdelay;
+    }
+
+  runtime.sim.mem_cycles += cur_area->ops.delayr << dc.line_words_log2;
+
+  if (config.pcu.enabled)
+    pcu_count_event(SPR_PCMR_DCM);
+
+}	/* dc_stats_access() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Refill a line, critical word first
+
+   @param[in] dataaddr  The address which missed
+   @param[in] line      The line data to fill
+   @param[in] log       Non-zero to log the reads to the area's log file
+
+   @return  Non-zero if the refill completed, zero if it ran off the end of
+            memory                                                           */
+/*---------------------------------------------------------------------------*/
+static int
+dc_refill (oraddr_t  dataaddr,
+	   uint32_t *line,
+	   int       log)
+{
+  oraddr_t  block = dataaddr & ~dc.block_offset_mask;
+  oraddr_t  word  = dataaddr & ~ADDR_C (3);
+  int       i;
+
+  for (i = 0; i < config.dc.blocksize; i += 4)
+    {
+      /* FIXME: What is the virtual address meant to be? (ie. What happens if
+       * we read out of memory while refilling a cache line?) */
+      uint32_t  tmp = evalsim_mem32 (block + ((word + i) &
+					      dc.block_offset_mask), 0);
+
+      line[((dataaddr + i) & dc.block_offset_mask) >> 2] = tmp;
+
+      if (!cur_area)
+	return 0;
+      else if (log && cur_area->log)
+	fprintf (cur_area->log, "[%" PRIxADDR "] -> read %08" PRIx32 "\n",
+		 dataaddr, tmp);
+    }
+
+  return 1;
+
+}	/* dc_refill() */
+
+
 /* First check if data is already in the cache and if it is:
     - increment DC read hit stats,
     - set 'lru' at this way to config.dc.ustates - 1 and
@@ -83,13 +360,14 @@ dc_info (void)
 uint32_t
 dc_simulate_read (oraddr_t dataaddr, oraddr_t virt_addr, int width)
 {
-  int set, way = -1;
-  int i;
+  unsigned int set, base;
+  int way;
   oraddr_t tagaddr;
+  uint32_t *line;
   uint32_t tmp = 0;
 
   if (!(cpu_state.sprs[SPR_UPR] & SPR_UPR_DCP) ||
-      !(cpu_state.sprs[SPR_SR] & SPR_SR_DCE) || data_ci)
+      !(cpu_state.sprs[SPR_SR] & SPR_SR_DCE) || data_ci || !dc.tags)
     {
       if (width == 4)
 	tmp = evalsim_mem32 (dataaddr, virt_addr);
@@ -105,105 +383,81 @@ dc_simulate_read (oraddr_t dataaddr, oraddr_t virt_addr, int width)
       return tmp;
     }
 
+  if (config.dc.stats_only)
+    {
+      /* Read memory directly, the cache model supplies the timing */
+      int  mem_cycles = runtime.sim.mem_cycles;
+
+      if (width == 4)
+	tmp = evalsim_mem32 (dataaddr, virt_addr);
+      else if (width == 2)
+	tmp = evalsim_mem16 (dataaddr, virt_addr);
+      else if (width == 1)
+	tmp = evalsim_mem8 (dataaddr, virt_addr);
+
+      runtime.sim.mem_cycles = mem_cycles;
+
+      if (cur_area)
+	{
+	  if (cur_area->log)
+	    fprintf (cur_area->log, "[%" PRIxADDR "] -> read %08" PRIx32 "\n",
+		     dataaddr, tmp);
+
+	  dc_stats_access (dataaddr, 0);
+	}
+
+      return tmp;
+    }
+
   /* Which set to check out? */
-  set = (dataaddr / config.dc.blocksize) % config.dc.nsets;
-  tagaddr = (dataaddr / config.dc.blocksize) / config.dc.nsets;
+  set = (dataaddr >> dc.blocksize_log2) & dc.set_mask;
+  tagaddr = dataaddr >> dc.tag_shift;
+  base = set << dc.ways_log2;
 
-  /* Scan all ways and try to find a matching way. */
-  for (i = 0; i < config.dc.nways; i++)
-    if (dc[set].way[i].tagaddr == tagaddr)
-      way = i;
+  way = dc_find_way (base, set, tagaddr);
 
   /* Did we find our cached data? */
   if (way >= 0)
     {				/* Yes, we did. */
       dc_stats.readhit++;
 
-      for (i = 0; i < config.dc.nways; i++)
-	if (dc[set].way[i].lru > dc[set].way[way].lru)
-	  dc[set].way[i].lru--;
-      dc[set].way[way].lru = config.dc.ustates - 1;
+      dc_touch_way (base, set, way);
       runtime.sim.mem_cycles += config.dc.load_hitdelay;
-
-      tmp =
-	dc[set].way[way].line[(dataaddr & (config.dc.blocksize - 1)) >> 2];
-      if (width == 4)
-	return tmp;
-      else if (width == 2)
-	{
-	  tmp = ((tmp >> ((dataaddr & 2) ? 0 : 16)) & 0xffff);
-	  return tmp;
-	}
-      else if (width == 1)
-	{
-	  tmp = ((tmp >> (8 * (3 - (dataaddr & 3)))) & 0xff);
-	  return tmp;
-	}
     }
   else
     {				/* No, we didn't. */
-      int minlru = config.dc.ustates - 1;
-      int minway = 0;
+      int minway = dc_pick_way (base, 0);
 
       dc_stats.readmiss++;
 
-      for (i = 0; i < config.dc.nways; i++)
-	{
-	  if (dc[set].way[i].lru < minlru)
-	    {
-	      minway = i;
-	      minlru = dc[set].way[i].lru;
-	    }
-	}
+      line = &dc.lines[(base + minway) << dc.line_words_log2];
 
-      for (i = 0; i < (config.dc.blocksize); i += 4)
+      if (!dc_refill (dataaddr, line, 1))
 	{
-	  /* FIXME: What is the virtual address meant to be? (ie. What happens if
-	   * we read out of memory while refilling a cache line?) */
-	  tmp =
-	    evalsim_mem32 ((dataaddr & ~(config.dc.blocksize - 1)) +
-			   (((dataaddr & ~ADDR_C (3)) +
-			     i) & (config.dc.blocksize - 1)), 0);
-
-	  dc[set].way[minway].
-	    line[((dataaddr + i) & (config.dc.blocksize - 1)) >> 2] = tmp;
-	  if (!cur_area)
-	    {
-	      dc[set].way[minway].tagaddr = -1;
-	      dc[set].way[minway].lru = 0;
-	      return 0;
-	    }
-	  else if (cur_area->log)
-	    fprintf (cur_area->log, "[%" PRIxADDR "] -> read %08" PRIx32 "\n",
-		     dataaddr, tmp);
+	  dc_kill_way (base, set, minway);
+	  return 0;
 	}
 
-      dc[set].way[minway].tagaddr = tagaddr;
-      for (i = 0; i < config.dc.nways; i++)
-	if (dc[set].way[i].lru)
-	  dc[set].way[i].lru--;
-      dc[set].way[minway].lru = config.dc.ustates - 1;
+      dc.tags[base + minway] = tagaddr;
+      dc_fill_way (base, set, minway);
       runtime.sim.mem_cycles += config.dc.load_missdelay;
 
       if (config.pcu.enabled)
 	pcu_count_event(SPR_PCMR_DCM);
 
-
-      tmp =
-	dc[set].way[minway].line[(dataaddr & (config.dc.blocksize - 1)) >> 2];
-      if (width == 4)
-	return tmp;
-      else if (width == 2)
-	{
-	  tmp = (tmp >> ((dataaddr & 2) ? 0 : 16)) & 0xffff;
-	  return tmp;
-	}
-      else if (width == 1)
-	{
-	  tmp = (tmp >> (8 * (3 - (dataaddr & 3)))) & 0xff;
-	  return tmp;
-	}
+      way = minway;
     }
+
+  line = &dc.lines[(base + way) << dc.line_words_log2];
+  tmp = line[(dataaddr & dc.block_offset_mask) >> 2];
+
+  if (width == 4)
+    return tmp;
+  else if (width == 2)
+    return (tmp >> ((dataaddr & 2) ? 0 : 16)) & 0xffff;
+  else if (width == 1)
+    return (tmp >> (8 * (3 - (dataaddr & 3)))) & 0xff;
+
   return 0;
 }
 
@@ -222,9 +476,10 @@ void
 dc_simulate_write (oraddr_t dataaddr, oraddr_t virt_addr, uint32_t data,
 		   int width)
 {
-  int set, way = -1;
-  int i;
+  unsigned int set, base;
+  int way;
   oraddr_t tagaddr;
+  uint32_t *line;
   uint32_t tmp;
 
   if (width == 4)
@@ -235,31 +490,33 @@ dc_simulate_write (oraddr_t dataaddr, oraddr_t virt_addr, uint32_t data,
     setsim_mem8 (dataaddr, virt_addr, data);
 
   if (!(cpu_state.sprs[SPR_UPR] & SPR_UPR_DCP) ||
-      !(cpu_state.sprs[SPR_SR] & SPR_SR_DCE) || data_ci || !cur_area)
+      !(cpu_state.sprs[SPR_SR] & SPR_SR_DCE) || data_ci || !cur_area ||
+      !dc.tags)
     return;
 
+  if (config.dc.stats_only)
+    {
+      dc_stats_access (dataaddr, 1);
+      return;
+    }
+
   /* Which set to check out? */
-  set = (dataaddr / config.dc.blocksize) % config.dc.nsets;
-  tagaddr = (dataaddr / config.dc.blocksize) / config.dc.nsets;
+  set = (dataaddr >> dc.blocksize_log2) & dc.set_mask;
+  tagaddr = dataaddr >> dc.tag_shift;
+  base = set << dc.ways_log2;
 
-  /* Scan all ways and try to find a matching way. */
-  for (i = 0; i < config.dc.nways; i++)
-    if (dc[set].way[i].tagaddr == tagaddr)
-      way = i;
+  way = dc_find_way (base, set, tagaddr);
 
   /* Did we find our cached data? */
   if (way >= 0)
     {				/* Yes, we did. */
       dc_stats.writehit++;
 
-      for (i = 0; i < config.dc.nways; i++)
-	if (dc[set].way[i].lru > dc[set].way[way].lru)
-	  dc[set].way[i].lru--;
-      dc[set].way[way].lru = config.dc.ustates - 1;
+      dc_touch_way (base, set, way);
       runtime.sim.mem_cycles += config.dc.store_hitdelay;
 
-      tmp =
-	dc[set].way[way].line[(dataaddr & (config.dc.blocksize - 1)) >> 2];
+      line = &dc.lines[(base + way) << dc.line_words_log2];
+      tmp = line[(dataaddr & dc.block_offset_mask) >> 2];
       if (width == 4)
 	tmp = data;
       else if (width == 2)
@@ -272,41 +529,25 @@ dc_simulate_write (oraddr_t dataaddr, oraddr_t virt_addr, uint32_t data,
 	  tmp &= ~(0xff << (8 * (3 - (dataaddr & 3))));
 	  tmp |= (data & 0xff) << (8 * (3 - (dataaddr & 3)));
 	}
-      dc[set].way[way].line[(dataaddr & (config.dc.blocksize - 1)) >> 2] =
-	tmp;
+      line[(dataaddr & dc.block_offset_mask) >> 2] = tmp;
     }
   else
     {				/* No, we didn't. */
-      int minlru = config.dc.ustates - 1;
-      int minway = 0;
+      int minway = dc_pick_way (base, 1);
 
       dc_stats.writemiss++;
 
-      for (i = 0; i < config.dc.nways; i++)
-	if (dc[set].way[i].lru < minlru)
-	  minway = i;
+      line = &dc.lines[(base + minway) << dc.line_words_log2];
 
-      for (i = 0; i < (config.dc.blocksize); i += 4)
+      /* FIXME: Same comment as in dc_simulate_read */
+      if (!dc_refill (dataaddr, line, 0))
 	{
-	  dc[set].way[minway].
-	    line[((dataaddr + i) & (config.dc.blocksize - 1)) >> 2] =
-	    /* FIXME: Same comment as in dc_simulate_read */
-	    evalsim_mem32 ((dataaddr & ~(config.dc.blocksize - 1)) +
-			   (((dataaddr & ~3ul) + i) & (config.dc.blocksize -
-						       1)), 0);
-	  if (!cur_area)
-	    {
-	      dc[set].way[minway].tagaddr = -1;
-	      dc[set].way[minway].lru = 0;
-	      return;
-	    }
+	  dc_kill_way (base, set, minway);
+	  return;
 	}
 
-      dc[set].way[minway].tagaddr = tagaddr;
-      for (i = 0; i < config.dc.nways; i++)
-	if (dc[set].way[i].lru)
-	  dc[set].way[i].lru--;
-      dc[set].way[minway].lru = config.dc.ustates - 1;
+      dc.tags[base + minway] = tagaddr;
+      dc_fill_way (base, set, minway);
       runtime.sim.mem_cycles += config.dc.store_missdelay;
       
       if (config.pcu.enabled)
@@ -323,41 +564,60 @@ dc_simulate_write (oraddr_t dataaddr, oraddr_t virt_addr, uint32_t data,
 void
 dc_inv (oraddr_t dataaddr)
 {
-  int set, way = -1;
+  unsigned int set, base;
+  int way;
   int i;
   oraddr_t tagaddr;
 
-  if (!(cpu_state.sprs[SPR_UPR] & SPR_UPR_DCP))
+  if (!(cpu_state.sprs[SPR_UPR] & SPR_UPR_DCP) || !dc.tags)
     return;
 
   /* Which set to check out? */
-  set = (dataaddr / config.dc.blocksize) % config.dc.nsets;
-  tagaddr = (dataaddr / config.dc.blocksize) / config.dc.nsets;
+  set = (dataaddr >> dc.blocksize_log2) & dc.set_mask;
+  tagaddr = dataaddr >> dc.tag_shift;
+  base = set << dc.ways_log2;
 
   if (!(cpu_state.sprs[SPR_SR] & SPR_SR_DCE))
     {
       for (i = 0; i < config.dc.nways; i++)
-	{
-	  dc[set].way[i].tagaddr = -1;
-	  dc[set].way[i].lru = 0;
-	}
+	dc_kill_way (base, set, i);
       return;
     }
-  /* Scan all ways and try to find a matching way. */
-  for (i = 0; i < config.dc.nways; i++)
-    if (dc[set].way[i].tagaddr == tagaddr)
-      way = i;
 
   /* Did we find our cached data? */
+  way = dc_find_way (base, set, tagaddr);
   if (way >= 0)
-    {				/* Yes, we did. */
-      dc[set].way[way].tagaddr = -1;
-      dc[set].way[way].lru = 0;
-    }
+    dc_kill_way (base, set, way);
 }
 
 /*-----------------------------------------------------[ DC configuration ]---*/
 
+/*---------------------------------------------------------------------------*/
+/*!Check the shape of the data cache may still be changed
+
+   The arrays are sized by dc_end_sec (), so once they exist the number of
+   sets and ways, the block size and stats_only are fixed. If not, issue a
+   warning.
+
+   @param[in] name  The name of the parameter being set
+
+   @return  Non-zero if the parameter may be set                             */
+/*---------------------------------------------------------------------------*/
+static int
+dc_shape_open (const char *name)
+{
+  if (NULL != dc.tags)
+    {
+      fprintf (stderr, "Warning: data cache %s cannot be changed once the "
+	       "cache is configured: ignored\n", name);
+      return  0;
+    }
+
+  return  1;
+
+}	/* dc_shape_open() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Enable or disable the data cache
 
@@ -387,8 +647,10 @@ dc_enabled (union param_val  val,
 /*---------------------------------------------------------------------------*/
 /*!Set the number of data cache sets
 
-   Value must be a power of 2 <= MAX_DC_SETS. If not issue a warning and
-   ignore. Set the relevant field in the data cache config register
+   Value must be a power of 2 <= MAX_DC_STATS_SETS. If not issue a warning
+   and ignore. Set the relevant field in the data cache config register. The
+   MAX_DC_SETS limit for a full cache is checked in dc_end_sec (), since
+   stats_only may follow.
 
    @param[in] val  The value to use
    @param[in] dat  The config data structure (not used here)                 */
@@ -397,19 +659,26 @@ static void
 dc_nsets (union param_val  val,
 	  void            *dat)
 {
-  if (is_power2 (val.int_val) && (val.int_val <= MAX_DC_SETS))
+  if (!dc_shape_open ("nsets"))
+    {
+      return;
+    }
+
+  if (is_power2 (val.int_val) && (val.int_val <= MAX_DC_STATS_SETS))
     {
       int  set_bits = log2_int (val.int_val);
+      int  max_bits = SPR_DCCFGR_NCS >> SPR_DCCFGR_NCS_OFF;
 
       config.dc.nsets = val.int_val;
 
       cpu_state.sprs[SPR_DCCFGR] &= ~SPR_DCCFGR_NCS;
-      cpu_state.sprs[SPR_DCCFGR] |= set_bits << SPR_DCCFGR_NCS_OFF;
+      cpu_state.sprs[SPR_DCCFGR] |=
+	((set_bits > max_bits) ? max_bits : set_bits) << SPR_DCCFGR_NCS_OFF;
     }
   else
     {
       fprintf (stderr, "Warning: data cache nsets not a power of 2 <= %d: "
-	       "ignored\n", MAX_DC_SETS);
+	       "ignored\n", MAX_DC_STATS_SETS);
     }
 }	/* dc_nsets() */
 
@@ -417,8 +686,9 @@ dc_nsets (union param_val  val,
 /*---------------------------------------------------------------------------*/
 /*!Set the number of data cache ways
 
-   Value must be a power of 2 <= MAX_DC_WAYS. If not issue a warning and
-   ignore. Set the relevant field in the data cache config register
+   Value must be a power of 2 <= MAX_DC_STATS_WAYS. If not issue a warning
+   and ignore. Set the relevant field in the data cache config register. The
+   MAX_DC_WAYS limit for a full cache is checked in dc_end_sec ().
 
    @param[in] val  The value to use
    @param[in] dat  The config data structure (not used here)                 */
@@ -427,7 +697,12 @@ static void
 dc_nways (union param_val  val,
 	  void            *dat)
 {
-  if (is_power2 (val.int_val) && (val.int_val <= MAX_DC_WAYS))
+  if (!dc_shape_open ("nways"))
+    {
+      return;
+    }
+
+  if (is_power2 (val.int_val) && (val.int_val <= MAX_DC_STATS_WAYS))
     {
       int  way_bits = log2_int (val.int_val);
 
@@ -439,7 +714,7 @@ dc_nways (union param_val  val,
   else
     {
       fprintf (stderr, "Warning: data cache nways not a power of 2 <= %d: "
-	       "ignored\n", MAX_DC_WAYS);
+	       "ignored\n", MAX_DC_STATS_WAYS);
     }
 }	 /* dc_nways() */
 
@@ -457,6 +732,11 @@ static void
 dc_blocksize (union param_val  val,
 	      void            *dat)
 {
+  if (!dc_shape_open ("blocksize"))
+    {
+      return;
+    }
+
   switch (val.int_val)
     {
     case MIN_DC_BLOCK_SIZE:
@@ -492,6 +772,7 @@ dc_ustates (union param_val  val,
   if ((val.int_val >= 2) && (val.int_val <= 4))
     {
       config.dc.ustates = val.int_val;
+      dc.ustates_reload = val.int_val - 1;
     }
   else
     {
@@ -525,10 +806,166 @@ dc_store_missdelay (union param_val val, void *dat)
   config.dc.store_missdelay = val.int_val;
 }
 
+
+/*---------------------------------------------------------------------------*/
+/*!Keep only data cache statistics
+
+   If set, tags and usage states are tracked to give hit and miss counts and
+   timings, but no line data is held and all data comes from memory.
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure (not used here)                 */
+/*---------------------------------------------------------------------------*/
+static void
+dc_stats_only (union param_val  val,
+	       void            *dat)
+{
+  if (!dc_shape_open ("stats_only"))
+    {
+      return;
+    }
+
+  config.dc.stats_only = val.int_val;
+
+}	/* dc_stats_only() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the data cache as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_dc_state ()
+{
+  reg_sim_state (&dc, sizeof (dc));
+
+}	/* reg_dc_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the data cache's contents for checkpoints                       */
+/*---------------------------------------------------------------------------*/
+void
+reg_dc_checkpoint ()
+{
+  unsigned int  nlines = config.dc.nsets * config.dc.nways;
+
+  if (NULL == dc.tags)
+    {
+      return;			/* Never configured */
+    }
+
+  REG_CHECKPOINT (dc.tags, nlines * sizeof (oraddr_t));
+  REG_CHECKPOINT (dc.lrus, nlines * sizeof (int));
+  REG_CHECKPOINT (dc.mru, config.dc.nsets);
+
+  if (NULL != dc.lines)
+    {
+      REG_CHECKPOINT (dc.lines,
+		      (nlines << dc.line_words_log2) * sizeof (uint32_t));
+    }
+}	/* reg_dc_checkpoint() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Start the data cache configuration
+
+   Any arrays from an earlier dc section are freed, so the shape of the cache
+   may be given afresh.
+
+   @return  The config data structure (not used here)                        */
+/*---------------------------------------------------------------------------*/
+static void *
+dc_start_sec ()
+{
+  free (dc.tags);
+  free (dc.lrus);
+  free (dc.mru);
+  free (dc.lines);
+
+  dc.tags  = NULL;
+  dc.lrus  = NULL;
+  dc.mru   = NULL;
+  dc.lines = NULL;
+
+  return  NULL;
+
+}	/* dc_start_sec() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Complete the data cache configuration
+
+   A cache holding line data is limited to MAX_DC_SETS sets of MAX_DC_WAYS
+   ways.  If larger, warn and reduce it.
+
+   Work out the shifts and masks used on every access and allocate the tag,
+   usage state, MRU and (unless stats_only) line arrays.  All tags start out
+   invalid.
+
+   @param[in] dat  The config data structure (not used here)                 */
+/*---------------------------------------------------------------------------*/
+static void
+dc_end_sec (void *dat)
+{
+  unsigned int  nlines;
+  unsigned int  words  =
+    (config.dc.blocksize < 4) ? 1 : config.dc.blocksize / 4;
+
+  if (!config.dc.stats_only && (config.dc.nsets > MAX_DC_SETS))
+    {
+      fprintf (stderr, "Warning: data cache nsets > %d needs stats_only: "
+	       "reduced to %d\n", MAX_DC_SETS, MAX_DC_SETS);
+      config.dc.nsets = MAX_DC_SETS;
+      cpu_state.sprs[SPR_DCCFGR] &= ~SPR_DCCFGR_NCS;
+      cpu_state.sprs[SPR_DCCFGR] |=
+	log2_int (MAX_DC_SETS) << SPR_DCCFGR_NCS_OFF;
+    }
+
+  if (!config.dc.stats_only && (config.dc.nways > MAX_DC_WAYS))
+    {
+      fprintf (stderr, "Warning: data cache nways > %d needs stats_only: "
+	       "reduced to %d\n", MAX_DC_WAYS, MAX_DC_WAYS);
+      config.dc.nways = MAX_DC_WAYS;
+      cpu_state.sprs[SPR_DCCFGR] &= ~SPR_DCCFGR_NCW;
+      cpu_state.sprs[SPR_DCCFGR] |=
+	log2_int (MAX_DC_WAYS) << SPR_DCCFGR_NCW_OFF;
+    }
+
+  nlines = config.dc.nsets * config.dc.nways;
+
+  dc.ways_log2         = log2_int (config.dc.nways);
+  dc.blocksize_log2    = log2_int (config.dc.blocksize);
+  dc.tag_shift         = dc.blocksize_log2 + log2_int (config.dc.nsets);
+  dc.line_words_log2   = log2_int (words);
+  dc.set_mask          = config.dc.nsets - 1;
+  dc.block_offset_mask = config.dc.blocksize - 1;
+  dc.ustates_reload    = config.dc.ustates - 1;
+
+  dc.tags  = malloc (nlines * sizeof (oraddr_t));
+  dc.lrus  = calloc (nlines, sizeof (int));
+  dc.mru   = malloc (config.dc.nsets);
+  dc.lines = NULL;
+
+  if (!config.dc.stats_only)
+    dc.lines = calloc (nlines * words, sizeof (uint32_t));
+
+  if (!dc.tags || !dc.lrus || !dc.mru ||
+      (!config.dc.stats_only && !dc.lines))
+    {
+      fprintf (stderr, "OOM\n");
+      exit (1);
+    }
+
+  memset (dc.tags, -1, nlines * sizeof (oraddr_t));
+  memset (dc.mru, DC_NO_MRU, config.dc.nsets);
+
+}	/* dc_end_sec() */
+
+
 void
 reg_dc_sec (void)
 {
-  struct config_section *sec = reg_config_sec ("dc", NULL, NULL);
+  struct config_section *sec = reg_config_sec ("dc", dc_start_sec, dc_end_sec);
 
   reg_config_param (sec, "enabled",         PARAMT_INT, dc_enabled);
   reg_config_param (sec, "nsets",           PARAMT_INT, dc_nsets);
@@ -539,4 +976,5 @@ reg_dc_sec (void)
   reg_config_param (sec, "load_missdelay",  PARAMT_INT, dc_load_missdelay);
   reg_config_param (sec, "store_hitdelay",  PARAMT_INT, dc_store_hitdelay);
   reg_config_param (sec, "store_missdelay", PARAMT_INT, dc_store_missdelay);
+  reg_config_param (sec, "stats_only",      PARAMT_INT, dc_stats_only);
 }
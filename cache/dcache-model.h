@@ -36,6 +36,11 @@
 #define MIN_DC_BLOCK_SIZE    16
 #define MAX_DC_BLOCK_SIZE    32
 
+/* Limits when only statistics are kept.  DCCFGR can only describe up to
+   32768 sets, so beyond that the field is left at its maximum. */
+#define MAX_DC_STATS_SETS  (1 << 20)
+#define MAX_DC_STATS_WAYS   128
+
 /* Prototypes for external use */
 
 extern uint32_t  dc_simulate_read (oraddr_t  dataaddr,
@@ -48,5 +53,7 @@ extern void      dc_simulate_write (oraddr_t  dataaddr,
 extern void      dc_info ();
 extern void      dc_inv (oraddr_t dataaddr);
 extern void      reg_dc_sec ();
+extern void      reg_dc_state ();
+extern void      reg_dc_checkpoint ();
 
 #endif	/* DCACHE_MODEL__H */
@@ -46,12 +46,17 @@
 #include "stats.h"
 #include "sim-cmd.h"
 #include "pcu.h"
+#include "checkpoint.h"
 
 #define MAX_IC_SETS        1024
 #define MAX_IC_WAYS          32
 #define MIN_IC_BLOCK_SIZE    16
 #define MAX_IC_BLOCK_SIZE    32
 
+/* Limits when only statistics are kept */
+#define MAX_IC_STATS_SETS  (1 << 20)
+#define MAX_IC_STATS_WAYS   128
+
 
 struct ic *ic_state = NULL;
 
@@ -71,6 +76,70 @@ ic_info (void *dat)
 	  ic->blocksize);
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Account a fetch when only statistics are kept
+
+   Update the tags, usage states and statistics, and charge the hit or miss
+   delay.  A miss also costs the memory reads a refill would have made.  The
+   caller has already fetched the instruction, so cur_area is valid.
+
+   @param[in] ic         The instruction cache
+   @param[in] fetchaddr  The physical address fetched                        */
+/*---------------------------------------------------------------------------*/
+static void
+ic_stats_access (struct ic *ic,
+		 oraddr_t   fetchaddr)
+{
+  oraddr_t      set     = (fetchaddr & ic->set_mask) >> ic->blocksize_log2;
+  oraddr_t      tagaddr = fetchaddr & ic->tagaddr_mask;
+  oraddr_t      way;
+  oraddr_t      lru_way;
+  unsigned int  minlru;
+
+  for (way = set; way < ic->last_way; way += ic->nsets)
+    {
+      if (ic->tags[way] == tagaddr)
+	{
+	  ic_stats.readhit++;
+
+	  for (lru_way = set; lru_way < ic->last_way; lru_way += ic->nsets)
+	    if (ic->lrus[lru_way] > ic->lrus[way])
+	      ic->lrus[lru_way]--;
+	  ic->lrus[way] = ic->ustates_reload;
+	  runtime.sim.mem_cycles += ic->hitdelay;
+	  return;
+	}
+    }
+
+  minlru = ic->ustates_reload;
+  way = set;
+
+  ic_stats.readmiss++;
+
+  for (lru_way = set; lru_way < ic->last_way; lru_way += ic->nsets)
+    {
+      if (ic->lrus[lru_way] < minlru)
+	{
+	  way = lru_way;
+	  minlru = ic->lrus[lru_way];
+	}
+    }
+
+  ic->tags[way] = tagaddr;
+  for (lru_way = set; lru_way < ic->last_way; lru_way += ic->nsets)
+    if (ic->lrus[lru_way])
+      ic->lrus[lru_way]--;
+  ic->lrus[way] = ic->ustates_reload;
+
+  runtime.sim.mem_cycles += ic->missdelay +
+    cur_area->ops.delayr * (int) (ic->blocksize / 4);
+
+  if (config.pcu.enabled)
+    pcu_count_event(SPR_PCMR_ICM);
+
+}	/* ic_stats_access() */
+
+
 /* First check if instruction is already in the cache and if it is:
     - increment IC read hit stats,
     - set 'lru' at this way to ic->ustates - 1 and
@@ -108,6 +177,26 @@ ic_simulate_fetch (oraddr_t fetchaddr, oraddr_t virt_addr)
       return tmp;
     }
 
+  if (ic->stats_only)
+    {
+      /* Fetch from memory directly, the cache model supplies the timing */
+      int  mem_cycles = runtime.sim.mem_cycles;
+
+      tmp = evalsim_mem32 (fetchaddr, virt_addr);
+      runtime.sim.mem_cycles = mem_cycles;
+
+      if (cur_area)
+	{
+	  if (cur_area->log)
+	    fprintf (cur_area->log, "[%" PRIxADDR "] -> read %08" PRIx32 "\n",
+		     fetchaddr, tmp);
+
+	  ic_stats_access (ic, fetchaddr);
+	}
+
+      return tmp;
+    }
+
   /* Which set to check out? */
   set = (fetchaddr & ic->set_mask) >> ic->blocksize_log2;
   tagaddr = fetchaddr & ic->tagaddr_mask;
@@ -269,19 +358,21 @@ ic_nsets (union param_val  val,
 {
   struct ic *ic = dat;
 
-  if (is_power2 (val.int_val) && (val.int_val <= MAX_IC_SETS))
+  if (is_power2 (val.int_val) && (val.int_val <= MAX_IC_STATS_SETS))
     {
       int  set_bits = log2_int (val.int_val);
+      int  max_bits = SPR_ICCFGR_NCS >> SPR_ICCFGR_NCS_OFF;
 
       ic->nsets = val.int_val;
 
       cpu_state.sprs[SPR_ICCFGR] &= ~SPR_ICCFGR_NCS;
-      cpu_state.sprs[SPR_ICCFGR] |= set_bits << SPR_ICCFGR_NCS_OFF;
+      cpu_state.sprs[SPR_ICCFGR] |=
+	((set_bits > max_bits) ? max_bits : set_bits) << SPR_ICCFGR_NCS_OFF;
     }
   else
     {
       fprintf (stderr, "Warning: instruction cache nsets not a power of "
-	       "2 <= %d: ignored\n", MAX_IC_SETS);
+	       "2 <= %d: ignored\n", MAX_IC_STATS_SETS);
     }
 }	/* ic_nsets() */
 
@@ -300,7 +391,7 @@ ic_nways (union param_val  val,
 {
   struct ic *ic = dat;
 
-  if (is_power2 (val.int_val) && (val.int_val <= MAX_IC_WAYS))
+  if (is_power2 (val.int_val) && (val.int_val <= MAX_IC_STATS_WAYS))
     {
       int  way_bits = log2_int (val.int_val);
 
@@ -312,7 +403,7 @@ ic_nways (union param_val  val,
   else
     {
       fprintf (stderr, "Warning: instruction cache nways not a power of "
-	       "2 <= %d: ignored\n", MAX_IC_WAYS);
+	       "2 <= %d: ignored\n", MAX_IC_STATS_WAYS);
     }
 }	/* ic_nways() */
 
@@ -396,6 +487,25 @@ ic_missdelay (union param_val  val,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/*!Keep only instruction cache statistics
+
+   If set, tags and usage states are tracked to give hit and miss counts and
+   timings, but no line data is held and all fetches come from memory.
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure                                 */
+/*---------------------------------------------------------------------------*/
+static void
+ic_stats_only (union param_val  val,
+	       void            *dat)
+{
+  struct ic *ic = dat;
+  ic->stats_only = val.int_val;
+
+}	/* ic_stats_only() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize a new instruction cache configuration
 
@@ -424,6 +534,7 @@ ic_start_sec ()
   ic->ustates   = 2;
   ic->hitdelay  = 1;
   ic->missdelay = 1;
+  ic->stats_only = 0;
 
   ic->mem       = NULL;		/* Internal configuration */
   ic->lrus      = NULL;
@@ -467,11 +578,34 @@ static void
 ic_end_sec (void *dat)
 {
   struct ic *ic = dat;
-  unsigned int size = ic->nways * ic->nsets * ic->blocksize;
+  unsigned int size;
 
-  if (size)
+  /* A cache holding line data has tighter limits */
+  if (!ic->stats_only && (ic->nsets > MAX_IC_SETS))
     {
-      if (!(ic->mem = malloc (size)))
+      fprintf (stderr, "Warning: instruction cache nsets > %d needs "
+	       "stats_only: reduced to %d\n", MAX_IC_SETS, MAX_IC_SETS);
+      ic->nsets = MAX_IC_SETS;
+      cpu_state.sprs[SPR_ICCFGR] &= ~SPR_ICCFGR_NCS;
+      cpu_state.sprs[SPR_ICCFGR] |=
+	log2_int (MAX_IC_SETS) << SPR_ICCFGR_NCS_OFF;
+    }
+
+  if (!ic->stats_only && (ic->nways > MAX_IC_WAYS))
+    {
+      fprintf (stderr, "Warning: instruction cache nways > %d needs "
+	       "stats_only: reduced to %d\n", MAX_IC_WAYS, MAX_IC_WAYS);
+      ic->nways = MAX_IC_WAYS;
+      cpu_state.sprs[SPR_ICCFGR] &= ~SPR_ICCFGR_NCW;
+      cpu_state.sprs[SPR_ICCFGR] |=
+	log2_int (MAX_IC_WAYS) << SPR_ICCFGR_NCW_OFF;
+    }
+
+  size = ic->nways * ic->nsets * (ic->stats_only ? 0 : ic->blocksize);
+
+  if (ic->nways && ic->nsets)
+    {
+      if (size && !(ic->mem = malloc (size)))
 	{
 	  fprintf (stderr, "OOM\n");
 	  exit (1);
@@ -490,7 +624,8 @@ ic_end_sec (void *dat)
 
       /* Clear the cache data. John Alfredo's fix for using 0 (which is a
 	 valid tag), so we now use -1 */
-      memset (ic->mem,  0, size);
+      if (size)
+	memset (ic->mem,  0, size);
       memset (ic->lrus, 0, ic->nsets * ic->nways * sizeof (unsigned int));
       memset (ic->tags, -1, ic->nsets * ic->nways * sizeof (oraddr_t));
     }
@@ -511,17 +646,44 @@ ic_end_sec (void *dat)
     reg_sim_stat (ic_info, dat);
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Register the instruction cache's contents for checkpoints                */
+/*---------------------------------------------------------------------------*/
+void
+reg_ic_checkpoint ()
+{
+  struct ic    *ic = ic_state;
+  unsigned int  nlines;
+
+  if ((NULL == ic) || (NULL == ic->tags))
+    {
+      return;			/* Never configured, or no ways or sets */
+    }
+
+  nlines = ic->nsets * ic->nways;
+
+  REG_CHECKPOINT (ic->tags, nlines * sizeof (oraddr_t));
+  REG_CHECKPOINT (ic->lrus, nlines * sizeof (unsigned int));
+
+  if (NULL != ic->mem)
+    {
+      REG_CHECKPOINT (ic->mem, nlines * ic->blocksize);
+    }
+}	/* reg_ic_checkpoint() */
+
+
 void
 reg_ic_sec (void)
 {
   struct config_section *sec =
     reg_config_sec ("ic", ic_start_sec, ic_end_sec);
 
-  reg_config_param (sec, "enabled",   PARAMT_INT, ic_enabled);
-  reg_config_param (sec, "nsets",     PARAMT_INT, ic_nsets);
-  reg_config_param (sec, "nways",     PARAMT_INT, ic_nways);
-  reg_config_param (sec, "blocksize", PARAMT_INT, ic_blocksize);
-  reg_config_param (sec, "ustates",   PARAMT_INT, ic_ustates);
-  reg_config_param (sec, "missdelay", PARAMT_INT, ic_missdelay);
-  reg_config_param (sec, "hitdelay" , PARAMT_INT, ic_hitdelay);
+  reg_config_param (sec, "enabled",    PARAMT_INT, ic_enabled);
+  reg_config_param (sec, "nsets",      PARAMT_INT, ic_nsets);
+  reg_config_param (sec, "nways",      PARAMT_INT, ic_nways);
+  reg_config_param (sec, "blocksize",  PARAMT_INT, ic_blocksize);
+  reg_config_param (sec, "ustates",    PARAMT_INT, ic_ustates);
+  reg_config_param (sec, "missdelay",  PARAMT_INT, ic_missdelay);
+  reg_config_param (sec, "hitdelay",   PARAMT_INT, ic_hitdelay);
+  reg_config_param (sec, "stats_only", PARAMT_INT, ic_stats_only);
 }
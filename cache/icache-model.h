@@ -47,6 +47,7 @@ struct ic
   unsigned int  ustates;	    /* number of IC usage states */
   int           missdelay;	    /* How much cycles does the miss cost */
   int           hitdelay;	    /* How much cycles does the hit cost */
+  int           stats_only;	    /* Track tags only, hold no line data */
   unsigned int  blocksize_log2;	    /* log2(blocksize) */
   oraddr_t      set_mask;	    /* Mask to get set number */
   oraddr_t      tagaddr_mask;	    /* Mask to get tag address */
@@ -64,5 +65,6 @@ extern uint32_t  ic_simulate_fetch (oraddr_t fetchaddr,
 				    oraddr_t virt_addr);
 extern void      ic_inv (oraddr_t dataaddr);
 extern void      reg_ic_sec ();
+extern void      reg_ic_checkpoint ();
 
 #endif	/* ICACHE_MODEL__H */
@@ -246,6 +246,35 @@ cpu_hardfloat (union param_val val, void *dat)
   config.cpu.hardfloat = val.int_val;
   cpu_state.sprs[SPR_CPUCFGR] |= SPR_CPUCFGR_OF32S;
 }
+
+static void
+cpu_cores (union param_val val, void *dat)
+{
+  if (val.int_val < 1)
+    {
+      config.cpu.cores = 1;
+      WARNING ("cores less than one; one used.");
+    }
+  else if (val.int_val > MAX_CORES)
+    {
+      config.cpu.cores = MAX_CORES;
+      WARNING ("cores too large; truncated.");
+    }
+  else
+    config.cpu.cores = val.int_val;
+}
+
+static void
+cpu_core_quantum (union param_val val, void *dat)
+{
+  if (val.int_val < 1)
+    {
+      config.cpu.core_quantum = 1;
+      WARNING ("core_quantum less than one; one used.");
+    }
+  else
+    config.cpu.core_quantum = val.int_val;
+}
 /*---------------------------------------------------------------------------*/
 /*!Register the functions to handle a section cpu
 
@@ -271,5 +300,7 @@ reg_cpu_sec ()
   reg_config_param (sec, "dependstats", PARAMT_INT, cpu_dependstats);
   reg_config_param (sec, "sbuf_len",    PARAMT_INT, cpu_sbuf_len);
   reg_config_param (sec, "hardfloat",   PARAMT_INT, cpu_hardfloat);
+  reg_config_param (sec, "cores",       PARAMT_INT, cpu_cores);
+  reg_config_param (sec, "core_quantum", PARAMT_INT, cpu_core_quantum);
 
 }	/* reg_cpu_sec() */
@@ -48,6 +48,8 @@
 #include "immu.h"
 #include "execute.h"
 #include "pcu.h"
+#include "toplevel-support.h"
+#include "checkpoint.h"
 
 /*! Global temporary variable to increase speed.  */
 struct dev_memarea *cur_area;
@@ -67,6 +69,46 @@ static struct dev_memarea *mc_area = NULL;
 /* Virtual address of current access. */
 static oraddr_t cur_vadd;
 
+/* Direct mapped cache of physical pages held in plain host RAM, so CPU loads
+   and stores to memory need neither verify_memoryarea () nor a call through
+   the read/write functions.  Pages which can't be accessed directly are
+   cached with a NULL host pointer, so they go straight to the slow path. */
+#define MEM_PAGE_BITS   13
+#define MEM_PAGE_SIZE   (1 << MEM_PAGE_BITS)
+#define MEM_PAGE_MASK   (MEM_PAGE_SIZE - 1)
+#define MEM_PAGES       1024
+#define MEM_PAGE_EMPTY  1		/* Never a page address */
+
+struct mem_page
+{
+  oraddr_t            addr;		/* Physical address of the page */
+  struct dev_memarea *mem;		/* Area holding it */
+  uint8_t            *host;		/* Host copy of the page, or NULL */
+};
+
+static struct mem_page mem_pages[MEM_PAGES];
+
+/* Two level map from physical address to the memory areas which might hold
+   it, so verify_memoryarea () need not walk dev_list.  Each 4MB chunk of the
+   address space has a NULL terminated list of the areas overlapping it, in
+   dev_list order.  Where more than one area overlaps a chunk, the chunk is
+   split into 4kB pages, each with its own list.  The map is rebuilt lazily
+   whenever an area is registered or moved. */
+#define AREA_CHUNK_BITS  22
+#define AREA_PAGE_BITS   12
+#define AREA_CHUNKS      (1 << (32 - AREA_CHUNK_BITS))
+#define AREA_PAGES       (1 << (AREA_CHUNK_BITS - AREA_PAGE_BITS))
+
+struct area_chunk
+{
+  struct dev_memarea  **areas;		/* Areas overlapping the chunk */
+  struct dev_memarea ***pages;		/* Per page lists, or NULL */
+};
+
+static struct area_chunk   area_map[AREA_CHUNKS];
+static struct dev_memarea *no_areas[1] = { NULL };
+static int                 area_map_dirty = 1;
+
 /* Forward declarations */
 static uint32_t eval_mem_32_inv (oraddr_t, void *);
 static uint16_t eval_mem_16_inv (oraddr_t, void *);
@@ -80,6 +122,7 @@ static void     set_mem_8_inv (oraddr_t, uint8_t, void *);
 static void     set_mem_32_inv_direct (oraddr_t, uint32_t, void *);
 static void     set_mem_16_inv_direct (oraddr_t, uint16_t, void *);
 static void     set_mem_8_inv_direct (oraddr_t, uint8_t, void *);
+static void     mem_pages_flush ();
 
 /* Calculates bit mask to fit the data */
 static unsigned int
@@ -146,6 +189,9 @@ register_memoryarea_mask (oraddr_t addr_mask,
   (*pptmp)->valid = 1;
   (*pptmp)->next = NULL;
 
+  area_map_dirty = 1;
+  mem_pages_flush ();
+
   return *pptmp;
 }
 
@@ -227,14 +273,115 @@ reg_mem_area (oraddr_t addr, uint32_t size, unsigned mc_dev,
 		ops->log);
     }
 
+  /* Where the area is, whether it is valid and its delays may all be changed
+     by a memory controller. */
+  REG_CHECKPOINT (&mem->addr_mask, offsetof (struct dev_memarea, log) -
+		  offsetof (struct dev_memarea, addr_mask));
+  REG_CHECKPOINT (&mem->ops.delayr, offsetof (struct mem_ops, log) -
+		  offsetof (struct mem_ops, delayr));
+
   return mem;
 }
 
+/* Make a NULL terminated list, in dev_list order, of the areas which match
+   any address differing from base only in the bits of span_mask. */
+static struct dev_memarea **
+area_list (oraddr_t base, oraddr_t span_mask)
+{
+  struct dev_memarea  *ptmp;
+  struct dev_memarea **list;
+  int                  n = 0;
+
+  for (ptmp = dev_list; ptmp; ptmp = ptmp->next)
+    if (!((base ^ ptmp->addr_compare) & ptmp->addr_mask & ~span_mask))
+      n++;
+
+  if (0 == n)
+    return no_areas;
+
+  if (!(list = malloc ((n + 1) * sizeof (struct dev_memarea *))))
+    {
+      fprintf (stderr, "Out-of-memory\n");
+      exit (1);
+    }
+
+  n = 0;
+
+  for (ptmp = dev_list; ptmp; ptmp = ptmp->next)
+    if (!((base ^ ptmp->addr_compare) & ptmp->addr_mask & ~span_mask))
+      list[n++] = ptmp;
+
+  list[n] = NULL;
+  return list;
+}
+
+/* Free the area map */
+static void
+area_map_free ()
+{
+  int c;
+  int p;
+
+  for (c = 0; c < AREA_CHUNKS; c++)
+    {
+      if (area_map[c].pages)
+	{
+	  for (p = 0; p < AREA_PAGES; p++)
+	    if (area_map[c].pages[p] != no_areas)
+	      free (area_map[c].pages[p]);
+
+	  free (area_map[c].pages);
+	  area_map[c].pages = NULL;
+	}
+
+      if (area_map[c].areas && (area_map[c].areas != no_areas))
+	free (area_map[c].areas);
+
+      area_map[c].areas = no_areas;
+    }
+}
+
+/* Rebuild the area map from dev_list */
+static void
+area_map_build ()
+{
+  int      c;
+  int      p;
+  oraddr_t base;
+
+  area_map_free ();
+
+  for (c = 0; c < AREA_CHUNKS; c++)
+    {
+      base = (oraddr_t) c << AREA_CHUNK_BITS;
+      area_map[c].areas = area_list (base, (1 << AREA_CHUNK_BITS) - 1);
+
+      if (area_map[c].areas[0] && area_map[c].areas[1])
+	{
+	  area_map[c].pages = malloc (AREA_PAGES *
+				      sizeof (struct dev_memarea **));
+	  if (!area_map[c].pages)
+	    {
+	      fprintf (stderr, "Out-of-memory\n");
+	      exit (1);
+	    }
+
+	  for (p = 0; p < AREA_PAGES; p++)
+	    area_map[c].pages[p] = area_list (base | (p << AREA_PAGE_BITS),
+					      (1 << AREA_PAGE_BITS) - 1);
+	}
+    }
+
+  area_map_dirty = 0;
+}
+
 /* Check if access is to registered area of memory. */
 struct dev_memarea *
 verify_memoryarea (oraddr_t addr)
 {
-  struct dev_memarea *ptmp;
+  struct dev_memarea  *ptmp;
+  struct dev_memarea **list;
+  struct area_chunk   *chunk;
 
   /* Check memory controller space first */
   if (mc_area
@@ -254,8 +401,15 @@ verify_memoryarea (oraddr_t addr)
 
   /* When mc is enabled, we must check valid also, otherwise we assume it is
      nonzero */
-  /* Check list of registered devices. */
-  for (ptmp = dev_list; ptmp; ptmp = ptmp->next)
+  /* Check the registered devices which might hold this address. */
+  if (area_map_dirty)
+    area_map_build ();
+
+  chunk = &area_map[addr >> AREA_CHUNK_BITS];
+  list = chunk->pages ?
+    chunk->pages[(addr >> AREA_PAGE_BITS) & (AREA_PAGES - 1)] : chunk->areas;
+
+  for (; (ptmp = *list); list++)
     {
       if ((addr & ptmp->addr_mask) == (ptmp->addr_compare & ptmp->addr_mask)
 	  && ptmp->valid)
@@ -267,11 +421,84 @@ verify_memoryarea (oraddr_t addr)
   return cur_area = NULL;
 }
 
-/* Sets the valid bit (Used only by memory controllers) */
+/* Forget all the direct mapped pages.  Must be called whenever the memory
+   map changes. */
+static void
+mem_pages_flush ()
+{
+  int i;
+
+  for (i = 0; i < MEM_PAGES; i++)
+    mem_pages[i].addr = MEM_PAGE_EMPTY;
+}
+
+/* Fill in the page cache entry for a physical address.  The page is only
+   accessed directly if it lies wholly within a valid area of host RAM, which
+   is not logged and which no other area overlaps, so that verify_memoryarea
+   () would always return that area for it. */
+static struct mem_page *
+mem_page_fill (struct mem_page *pg, oraddr_t memaddr)
+{
+  struct dev_memarea *mem;
+  struct dev_memarea *ptmp;
+
+  pg->addr = memaddr & ~MEM_PAGE_MASK;
+  pg->mem = NULL;
+  pg->host = NULL;
+
+  mem = verify_memoryarea (memaddr);
+
+  if (!mem || !mem->valid || mem->log || !mem->ops.host_mem ||
+      (mem->size_mask & MEM_PAGE_MASK) != MEM_PAGE_MASK ||
+      (mem->addr_mask & MEM_PAGE_MASK))
+    return pg;
+
+  for (ptmp = dev_list; ptmp; ptmp = ptmp->next)
+    if (ptmp != mem &&
+	!((pg->addr ^ ptmp->addr_compare) & ptmp->addr_mask & ~MEM_PAGE_MASK))
+      return pg;
+
+  if (mem->ops.host_touch)
+    mem->ops.host_touch (pg->addr & mem->size_mask, MEM_PAGE_SIZE,
+			 mem->ops.host_touch_dat);
+
+  pg->mem = mem;
+  pg->host = (uint8_t *) mem->ops.host_mem + (pg->addr & mem->size_mask);
+
+  return pg;
+}
+
+/* Look up the page cache entry for a physical address. */
+static inline struct mem_page *
+mem_page_lookup (oraddr_t memaddr)
+{
+  struct mem_page *pg = &mem_pages[(memaddr >> MEM_PAGE_BITS) &
+				   (MEM_PAGES - 1)];
+
+  if (pg->addr == (memaddr & ~MEM_PAGE_MASK))
+    return pg;
+
+  return mem_page_fill (pg, memaddr);
+}
+
+/* Sets the valid bit (Used only by memory controllers).  Anything decoded
+   from the old memory map is thrown away. */
 void
 set_mem_valid (struct dev_memarea *mem, int valid)
 {
   mem->valid = valid;
+  mem_map_changed ();		/* The MC may have moved the area */
+}
+
+/* The memory areas have been changed behind our back (by restoring a
+   checkpoint, or resetting memory filled on first access).  Anything decoded
+   from the old memory map is thrown away. */
+void
+mem_map_changed ()
+{
+  area_map_dirty = 1;
+  mem_pages_flush ();
+  decode_cache_flush ();
 }
 
 /* Adjusts the read and write delays for the memory area pointed to by mem. */
@@ -387,6 +614,14 @@ uint32_t
 evalsim_mem32 (oraddr_t memaddr, oraddr_t vaddr)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayr;
+      return *(uint32_t *) (pg->host + (memaddr & MEM_PAGE_MASK));
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
@@ -417,6 +652,18 @@ uint16_t
 evalsim_mem16 (oraddr_t memaddr, oraddr_t vaddr)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayr;
+#ifdef WORDS_BIGENDIAN
+      return *(uint16_t *) (pg->host + (memaddr & MEM_PAGE_MASK));
+#else
+      return *(uint16_t *) (pg->host + ((memaddr & MEM_PAGE_MASK) ^ 2));
+#endif
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
@@ -447,6 +694,18 @@ uint8_t
 evalsim_mem8 (oraddr_t memaddr, oraddr_t vaddr)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayr;
+#ifdef WORDS_BIGENDIAN
+      return pg->host[memaddr & MEM_PAGE_MASK];
+#else
+      return pg->host[(memaddr & MEM_PAGE_MASK) ^ 3];
+#endif
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
@@ -551,7 +810,7 @@ eval_direct32 (oraddr_t memaddr, int through_mmu, int through_dc)
  * STATISTICS OK (only used for cpu_access, that is architectural access)
  */
 uint32_t
-eval_insn (oraddr_t memaddr, int *breakpoint)
+eval_insn (oraddr_t memaddr, oraddr_t *phys_memaddr_ret, int *breakpoint)
 {
   uint32_t temp;
   oraddr_t phys_memaddr;
@@ -561,6 +820,7 @@ eval_insn (oraddr_t memaddr, int *breakpoint)
 
   phys_memaddr = memaddr;
   phys_memaddr = immu_translate (memaddr);
+  *phys_memaddr_ret = phys_memaddr;
 
   if (except_pending)
     return 0;
@@ -730,11 +990,22 @@ void
 setsim_mem32 (oraddr_t memaddr, oraddr_t vaddr, uint32_t value)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
+      *(uint32_t *) (pg->host + (memaddr & MEM_PAGE_MASK)) = value;
+      return;
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
       cur_vadd = vaddr;
       runtime.sim.mem_cycles += mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
       mem->ops.writefunc32 (memaddr & mem->size_mask, value,
 			    mem->ops.write_dat32);
     }
@@ -759,11 +1030,26 @@ void
 setsim_mem16 (oraddr_t memaddr, oraddr_t vaddr, uint16_t value)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
+#ifdef WORDS_BIGENDIAN
+      *(uint16_t *) (pg->host + (memaddr & MEM_PAGE_MASK)) = value;
+#else
+      *(uint16_t *) (pg->host + ((memaddr & MEM_PAGE_MASK) ^ 2)) = value;
+#endif
+      return;
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
       cur_vadd = vaddr;
       runtime.sim.mem_cycles += mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
       mem->ops.writefunc16 (memaddr & mem->size_mask, value,
 			    mem->ops.write_dat16);
     }
@@ -788,11 +1074,26 @@ void
 setsim_mem8 (oraddr_t memaddr, oraddr_t vaddr, uint8_t value)
 {
   struct dev_memarea *mem;
+  struct mem_page *pg = mem_page_lookup (memaddr);
+
+  if (pg->host)
+    {
+      cur_area = pg->mem;
+      runtime.sim.mem_cycles += pg->mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
+#ifdef WORDS_BIGENDIAN
+      pg->host[memaddr & MEM_PAGE_MASK] = value;
+#else
+      pg->host[(memaddr & MEM_PAGE_MASK) ^ 3] = value;
+#endif
+      return;
+    }
 
   if ((mem = verify_memoryarea (memaddr)))
     {
       cur_vadd = vaddr;
       runtime.sim.mem_cycles += mem->ops.delayw;
+      decode_cache_invalidate (memaddr);
       mem->ops.writefunc8 (memaddr & mem->size_mask, value,
 			   mem->ops.write_dat8);
     }
@@ -834,6 +1135,9 @@ set_mem32 (oraddr_t memaddr, uint32_t value, int *breakpoint)
   if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
     cpu_state.loadlock_active = 0;
 
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
   /* If we produced exception don't set anything */
   if (except_pending)
     return;
@@ -888,8 +1192,11 @@ set_direct32 (oraddr_t memaddr, uint32_t value, int through_mmu,
   else
     {
       if ((mem = verify_memoryarea (phys_memaddr)))
-	mem->direct_ops.writefunc32 (phys_memaddr & mem->size_mask, value,
-				     mem->direct_ops.write_dat32);
+	{
+	  decode_cache_invalidate (phys_memaddr);
+	  mem->direct_ops.writefunc32 (phys_memaddr & mem->size_mask, value,
+				       mem->direct_ops.write_dat32);
+	}
       else
 	fprintf (stderr, "ERR: 32-bit write out of memory area: %" PRIxADDR
 		" (physical: %" PRIxADDR ")\n", memaddr, phys_memaddr);
@@ -922,6 +1229,9 @@ set_mem16 (oraddr_t memaddr, uint16_t value, int *breakpoint)
   if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
     cpu_state.loadlock_active = 0;
 
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
   /* If we produced exception don't set anything */
   if (except_pending)
     return;
@@ -976,8 +1286,11 @@ set_direct16 (oraddr_t memaddr, uint16_t value, int through_mmu,
   else
     {
       if ((mem = verify_memoryarea (phys_memaddr)))
-	mem->direct_ops.writefunc16 (phys_memaddr & mem->size_mask, value,
-				     mem->direct_ops.write_dat16);
+	{
+	  decode_cache_invalidate (phys_memaddr);
+	  mem->direct_ops.writefunc16 (phys_memaddr & mem->size_mask, value,
+				       mem->direct_ops.write_dat16);
+	}
       else
 	fprintf (stderr, "ERR: 16-bit write out of memory area: %" PRIxADDR
 		 " (physical: %" PRIxADDR "\n", memaddr, phys_memaddr);
@@ -1002,6 +1315,9 @@ set_mem8 (oraddr_t memaddr, uint8_t value, int *breakpoint)
   if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
     cpu_state.loadlock_active = 0;
 
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
   /* If we produced exception don't set anything */
   if (except_pending)
     return;
@@ -1048,8 +1364,11 @@ set_direct8 (oraddr_t memaddr, uint8_t value, int through_mmu, int through_dc)
   else
     {
       if ((mem = verify_memoryarea (phys_memaddr)))
-	mem->direct_ops.writefunc8 (phys_memaddr & mem->size_mask, value,
-				    mem->direct_ops.write_dat8);
+	{
+	  decode_cache_invalidate (phys_memaddr);
+	  mem->direct_ops.writefunc8 (phys_memaddr & mem->size_mask, value,
+				      mem->direct_ops.write_dat8);
+	}
       else
 	fprintf (stderr, "ERR: 8-bit write out of memory area: %" PRIxADDR
 		 " (physical: %" PRIxADDR "\n", memaddr, phys_memaddr);
@@ -1061,6 +1380,164 @@ set_direct8 (oraddr_t memaddr, uint8_t value, int through_mmu, int through_dc)
 }
 
 
+/* Plain versions of the CPU accessors above, for when there is no memory
+ * profiling, PCU, debug unit or data cache to tell about the access.  They
+ * are called only from the handlers generate.c specialises for this case
+ * (see exec_select_handlers), so must otherwise behave exactly as
+ * eval_mem32 etc. do.
+ *
+ * STATISTICS OK (only used for cpu_access, that is architectural access)
+ */
+uint32_t
+eval_mem32_plain (oraddr_t memaddr, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  if (memaddr & 3)
+    {
+      except_handle (EXCEPT_ALIGN, memaddr);
+      return 0;
+    }
+
+  phys_memaddr = dmmu_translate (memaddr, 0);
+  if (except_pending)
+    return 0;
+
+  return evalsim_mem32 (phys_memaddr, memaddr);
+}
+
+uint16_t
+eval_mem16_plain (oraddr_t memaddr, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  if (memaddr & 1)
+    {
+      except_handle (EXCEPT_ALIGN, memaddr);
+      return 0;
+    }
+
+  phys_memaddr = dmmu_translate (memaddr, 0);
+  if (except_pending)
+    return 0;
+
+  return evalsim_mem16 (phys_memaddr, memaddr);
+}
+
+uint8_t
+eval_mem8_plain (oraddr_t memaddr, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  phys_memaddr = dmmu_translate (memaddr, 0);
+  if (except_pending)
+    return 0;
+
+  return evalsim_mem8 (phys_memaddr, memaddr);
+}
+
+/* Instruction fetch without the memory profiling, debug unit, PCU or
+ * instruction cache. */
+uint32_t
+eval_insn_plain (oraddr_t memaddr, oraddr_t *phys_memaddr_ret,
+		 int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  phys_memaddr = immu_translate (memaddr);
+  *phys_memaddr_ret = phys_memaddr;
+
+  if (except_pending)
+    return 0;
+
+  return evalsim_mem32 (phys_memaddr, memaddr);
+}
+
+void
+set_mem32_plain (oraddr_t memaddr, uint32_t value, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  if (memaddr & 3)
+    {
+      except_handle (EXCEPT_ALIGN, memaddr);
+      return;
+    }
+
+  phys_memaddr = dmmu_translate (memaddr, 1);
+
+  if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
+    cpu_state.loadlock_active = 0;
+
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
+  /* If we produced exception don't set anything */
+  if (except_pending)
+    return;
+
+  setsim_mem32 (phys_memaddr, memaddr, value);
+
+  if (cur_area && cur_area->log)
+    fprintf (cur_area->log, "[%" PRIxADDR "] -> write %08" PRIx32 "\n",
+	     memaddr, value);
+}
+
+void
+set_mem16_plain (oraddr_t memaddr, uint16_t value, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  if (memaddr & 1)
+    {
+      except_handle (EXCEPT_ALIGN, memaddr);
+      return;
+    }
+
+  phys_memaddr = dmmu_translate (memaddr, 1);
+
+  if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
+    cpu_state.loadlock_active = 0;
+
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
+  /* If we produced exception don't set anything */
+  if (except_pending)
+    return;
+
+  setsim_mem16 (phys_memaddr, memaddr, value);
+
+  if (cur_area && cur_area->log)
+    fprintf (cur_area->log, "[%" PRIxADDR "] -> write %04" PRIx16 "\n",
+	     memaddr, value);
+}
+
+void
+set_mem8_plain (oraddr_t memaddr, uint8_t value, int *breakpoint)
+{
+  oraddr_t phys_memaddr;
+
+  phys_memaddr = dmmu_translate (memaddr, 1);
+
+  if ((phys_memaddr & ~3) == cpu_state.loadlock_addr)
+    cpu_state.loadlock_active = 0;
+
+  if (config.cpu.cores > 1)
+    smp_store (phys_memaddr);
+
+  /* If we produced exception don't set anything */
+  if (except_pending)
+    return;
+
+  setsim_mem8 (phys_memaddr, memaddr, value);
+
+  if (cur_area && cur_area->log)
+    fprintf (cur_area->log, "[%" PRIxADDR "] -> write %02" PRIx8 "\n",
+	     memaddr, value);
+}
+
+
 /* set_program32 - same as set_direct32, but it also writes to memory that is
  *                 non-writeable to the rest of the sim.  Used to do program
  *                 loading.
@@ -1078,6 +1555,7 @@ set_program32 (oraddr_t memaddr, uint32_t value)
 
   if ((mem = verify_memoryarea (memaddr)))
     {
+      decode_cache_invalidate (memaddr);
       mem->ops.writeprog32 (memaddr & mem->size_mask, value,
 			    mem->ops.writeprog32_dat);
     }
@@ -1097,6 +1575,7 @@ set_program8 (oraddr_t memaddr, uint8_t value)
 
   if ((mem = verify_memoryarea (memaddr)))
     {
+      decode_cache_invalidate (memaddr);
       mem->ops.writeprog8 (memaddr & mem->size_mask, value,
 			   mem->ops.writeprog8_dat);
     }
@@ -1106,6 +1585,71 @@ set_program8 (oraddr_t memaddr, uint8_t value)
 }
 
 
+/* set_program_block - same as set_program8 for each of a block of bytes (or
+ *                     zeros, if buf is NULL), in target (big endian) order.
+ *                     Whole words in areas with prog_mem set are copied
+ *                     straight into the host memory.  Used to do program
+ *                     loading.
+ */
+void
+set_program_block (oraddr_t memaddr, const uint8_t *buf, size_t len)
+{
+  int copied = 0;
+
+  while (len > 0)
+    {
+      struct dev_memarea *mem = verify_memoryarea (memaddr);
+      uint32_t *host;
+      size_t words;
+
+      if (!mem || !mem->ops.prog_mem || (memaddr & 3) || (len < 4))
+	{
+	  set_program8 (memaddr, buf ? *buf++ : 0);
+	  memaddr++;
+	  len--;
+	  continue;
+	}
+
+      /* As many whole words as fit in the area */
+      words = (mem->size - (memaddr & mem->size_mask)) / 4;
+      words = (words < len / 4) ? words : len / 4;
+      host = (uint32_t *) ((uint8_t *) mem->ops.prog_mem +
+			   (memaddr & mem->size_mask));
+
+      if (mem->ops.host_touch)
+	mem->ops.host_touch (memaddr & mem->size_mask, words * 4,
+			     mem->ops.host_touch_dat);
+
+      if (!buf)
+	memset (host, 0, words * 4);
+      else
+	{
+#ifdef WORDS_BIGENDIAN
+	  memcpy (host, buf, words * 4);
+#else
+	  size_t i;
+
+	  /* A simple loop, which the compiler turns into byte swapping
+	     vector instructions where it can. */
+	  for (i = 0; i < words; i++)
+	    host[i] = ((uint32_t) buf[4 * i] << 24) |
+	              ((uint32_t) buf[4 * i + 1] << 16) |
+	              ((uint32_t) buf[4 * i + 2] << 8) |
+	              (uint32_t) buf[4 * i + 3];
+#endif
+	  buf += words * 4;
+	}
+
+      memaddr += words * 4;
+      len -= words * 4;
+      copied = 1;
+    }
+
+  /* Cheaper than invalidating each word copied */
+  if (copied)
+    decode_cache_flush ();
+}
+
 /*---------------------------------------------------------------------------*/
 /*!Dump memory to the current output
 
@@ -1357,6 +1901,9 @@ done_memory_table ()
       if (ptmp->log)
 	fclose (ptmp->log);
     }
+
+  area_map_free ();
+  area_map_dirty = 1;
 }
 
 /* Displays current memory configuration */
@@ -1407,3 +1954,22 @@ generate_time_pretty (char *dest, long time_ps)
   sprintf (dest, "%li%cs", time_ps, "pnum"[exp3]);
   return dest;
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the memory map as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_memory_state ()
+{
+  reg_sim_state (&cur_area, sizeof (cur_area));
+  reg_sim_state (&data_ci, sizeof (data_ci));
+  reg_sim_state (&insn_ci, sizeof (insn_ci));
+  reg_sim_state (&dev_list, sizeof (dev_list));
+  reg_sim_state (&mc_area, sizeof (mc_area));
+  reg_sim_state (&cur_vadd, sizeof (cur_vadd));
+  reg_sim_state (&mem_pages, sizeof (mem_pages));
+  reg_sim_state (&area_map, sizeof (area_map));
+  reg_sim_state (&area_map_dirty, sizeof (area_map_dirty));
+
+}	/* reg_memory_state() */
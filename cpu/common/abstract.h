@@ -114,6 +114,22 @@ struct mem_ops
 
   /* Name of log file */
   const char *log;
+
+  /* Host memory holding the area, if it is plain RAM read and written with
+     the simmem functions, so the CPU may access it directly.  Otherwise
+     NULL. */
+  void       *host_mem;
+
+  /* Host memory holding the area as 32-bit words in host byte order, if a
+     program may be loaded by copying straight into it (even if the CPU may
+     not write it).  Otherwise NULL. */
+  void       *prog_mem;
+
+  /* Called with the offset and length of a part of host_mem or prog_mem
+     before it is accessed directly, if the area fills its pages on first
+     access.  Otherwise NULL. */
+  void        (*host_touch) (uint32_t, uint32_t, void *);
+  void       *host_touch_dat;
 };
 
 /*! Memory regions assigned to devices */
@@ -168,10 +184,18 @@ extern void                adjust_rw_delay (struct dev_memarea *mem,
 					    int                 delayw);
 extern void                set_mem_valid (struct dev_memarea *mem,
 					  int                 valid);
+extern void                mem_map_changed ();
 extern struct dev_memarea *verify_memoryarea (oraddr_t addr);
 extern char               *generate_time_pretty (char *dest,
 						 long  time_ps);
-extern uint32_t            eval_insn (oraddr_t, int *);
+extern uint32_t            eval_insn (oraddr_t, oraddr_t *, int *);
+extern uint32_t            eval_insn_plain (oraddr_t, oraddr_t *, int *);
+extern uint32_t            eval_mem32_plain (oraddr_t, int *);
+extern uint16_t            eval_mem16_plain (oraddr_t, int *);
+extern uint8_t             eval_mem8_plain (oraddr_t, int *);
+extern void                set_mem32_plain (oraddr_t, uint32_t, int *);
+extern void                set_mem16_plain (oraddr_t, uint16_t, int *);
+extern void                set_mem8_plain (oraddr_t, uint8_t, int *);
 extern uint32_t            eval_direct32 (oraddr_t  addr,
 					  int       through_mmu,
 					  int       through_dc);
@@ -188,5 +212,9 @@ extern void                set_program32 (oraddr_t  memaddr,
 					  uint32_t  value);
 extern void                set_program8 (oraddr_t  memaddr,
 					 uint8_t   value);
+extern void                set_program_block (oraddr_t       memaddr,
+					      const uint8_t *buf,
+					      size_t         len);
+extern void                reg_memory_state ();
 
 #endif /*  ABSTRACT__H */
@@ -92,6 +92,14 @@ extern void      analysis (struct iqueue_entry *current);
 extern void      cpu_reset ();
 extern int       cpu_clock ();
 extern void      exec_main ();
+extern void      exec_select_handlers ();
+extern void      skip_idle_loop (long long int  max_cycles);
+extern int       cpu_dozing ();
+extern int       cpu_quantum (long long int  end_cycles);
 extern int       depend_operands (struct iqueue_entry *prev,
 				  struct iqueue_entry *next);
+extern void      decode_cache_invalidate (oraddr_t  addr);
+extern void      decode_cache_flush ();
+extern void      reg_exec_state ();
+extern void      reg_exec_checkpoint ();
 #endif  /* EXECUTE__H */
@@ -33,67 +33,379 @@
 
 /* System includes */
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 /* Package includes */
 #include "labels.h"
+#include "execute.h"
+#include "toplevel-support.h"
 
-#define LABELS_HASH_SIZE 119
+/*! Size of each block of the string arena holding the label names */
+#define LABELS_ARENA_SIZE  65536
+
+/*! One block of the string arena. Names are never freed individually, so
+    they are just packed one after the other. */
+struct label_arena
+{
+  struct label_arena *next;
+  size_t              used;
+  size_t              size;
+  char                data[];
+};
+
+/*! The symbol store. Labels are appended to a growable array in the order
+    they are loaded. Sorted address and name hash indexes are built over the
+    array on the first lookup after a load, so loading is linear and lookups
+    are logarithmic (by address) or constant (by name). */
+static struct
+{
+  struct label_entry *entries;		/*!< All labels in load order */
+  unsigned int        num;		/*!< Number of labels */
+  unsigned int        max;		/*!< Allocated size of entries */
+  struct label_arena *arena;		/*!< Current string arena block */
+  unsigned int       *by_addr;		/*!< Entry indexes sorted by address */
+  unsigned int       *by_name;		/*!< Name hash of entry index + 1 */
+  unsigned int        name_mask;	/*!< Name hash size - 1 */
+  int                 dirty;		/*!< Indexes need rebuilding */
+} labels;
+
+/*! Number of hash chains for the breakpoint pages (a power of 2) */
+#define BREAK_HASH_SIZE  64
+
+/*! One bit for each word of a page with breakpoints */
+struct breakpoint_page
+{
+  oraddr_t                page;			/*!< Page number */
+  uint32_t                bits[BREAK_PAGE_WORDS / 32];
+  int                     count;		/*!< Breakpoints in the page */
+  struct breakpoint_page *next;			/*!< Next in hash chain */
+};
 
 /* Globally visible list of breakpoints */
 struct breakpoint_entry *breakpoints;
 
-/* Local list of labels (symbols) */
-static struct label_entry *label_hash[LABELS_HASH_SIZE];
+/* Globally visible union of the page bitmaps of all breakpoint pages */
+uint32_t  breakpoint_offsets[BREAK_PAGE_WORDS / 32];
+
+/* Local hash of the pages with breakpoints, by page number */
+static struct breakpoint_page *breakpoint_pages[BREAK_HASH_SIZE];
+
+
+/*---------------------------------------------------------------------------*/
+/*!Hash a label name
+
+   FNV-1a, which is cheap and spreads typical symbol names well.
+
+   @param[in] name  The name to hash
+
+   @return  The hash value                                                   */
+/*---------------------------------------------------------------------------*/
+static unsigned int
+label_name_hash (const char *name)
+{
+  unsigned int  h = 2166136261u;
+
+  for (; *name; name++)
+    {
+      h = (h ^ (unsigned char) *name) * 16777619u;
+    }
+
+  return h;
+
+}	/* label_name_hash() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Copy a label name into the string arena
+
+   @param[in] name  The name to copy
+
+   @return  The copy of the name                                             */
+/*---------------------------------------------------------------------------*/
+static char *
+label_strdup (const char *name)
+{
+  size_t  len = strlen (name) + 1;
+  char   *res;
+
+  if ((NULL == labels.arena) ||
+      (labels.arena->used + len > labels.arena->size))
+    {
+      size_t              size = (len > LABELS_ARENA_SIZE) ? len
+	                                                   : LABELS_ARENA_SIZE;
+      struct label_arena *blk  = malloc (sizeof (*blk) + size);
+
+      if (NULL == blk)
+	{
+	  fprintf (stderr, "ERROR: Out of memory for labels\n");
+	  exit (1);
+	}
+
+      blk->next    = labels.arena;
+      blk->used    = 0;
+      blk->size    = size;
+      labels.arena = blk;
+    }
+
+  res = labels.arena->data + labels.arena->used;
+  labels.arena->used += len;
+  memcpy (res, name, len);
+
+  return res;
+
+}	/* label_strdup() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Compare two entry indexes by label address
+
+   Ties are broken by load order, so the first label loaded for an address
+   is the one reported for it, as it was with the original hash chains.
+
+   @param[in] a  Pointer to the first index
+   @param[in] b  Pointer to the second index
+
+   @return  Negative, zero or positive as for qsort                          */
+/*---------------------------------------------------------------------------*/
+static int
+label_addr_cmp (const void *a,
+		const void *b)
+{
+  unsigned int  ia = *(const unsigned int *) a;
+  unsigned int  ib = *(const unsigned int *) b;
+  oraddr_t      aa = labels.entries[ia].addr;
+  oraddr_t      ab = labels.entries[ib].addr;
+
+  if (aa != ab)
+    {
+      return (aa < ab) ? -1 : 1;
+    }
+
+  return (ia < ib) ? -1 : (ia > ib);
+
+}	/* label_addr_cmp() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Build the address and name indexes
+
+   Called on the first lookup after labels have been added. Where several
+   labels share a name, the name index keeps the first one loaded.           */
+/*---------------------------------------------------------------------------*/
+static void
+build_label_indexes ()
+{
+  unsigned int  size;
+  unsigned int  i;
+
+  free (labels.by_addr);
+  free (labels.by_name);
+
+  for (size = 16; size < 2 * labels.num; size *= 2)
+    ;
+
+  labels.by_addr = malloc ((labels.num + 1) * sizeof (*labels.by_addr));
+  labels.by_name = calloc (size, sizeof (*labels.by_name));
+
+  if ((NULL == labels.by_addr) || (NULL == labels.by_name))
+    {
+      fprintf (stderr, "ERROR: Out of memory for labels\n");
+      exit (1);
+    }
+
+  labels.name_mask = size - 1;
+
+  for (i = 0; i < labels.num; i++)
+    {
+      unsigned int  h = label_name_hash (labels.entries[i].name);
+
+      labels.by_addr[i] = i;
+
+      for (h &= labels.name_mask; labels.by_name[h];
+	   h = (h + 1) & labels.name_mask)
+	{
+	  if (0 == strcmp (labels.entries[labels.by_name[h] - 1].name,
+			   labels.entries[i].name))
+	    {
+	      break;
+	    }
+	}
+
+      if (!labels.by_name[h])
+	{
+	  labels.by_name[h] = i + 1;
+	}
+    }
+
+  qsort (labels.by_addr, labels.num, sizeof (*labels.by_addr),
+	 label_addr_cmp);
+
+  labels.dirty = 0;
+
+}	/* build_label_indexes() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Find the first sorted position with an address greater than addr
+
+   @param[in] addr  The address to look for
+
+   @return  Index into by_addr of the first label after addr                 */
+/*---------------------------------------------------------------------------*/
+static unsigned int
+label_upper_bound (oraddr_t addr)
+{
+  unsigned int  lo = 0;
+  unsigned int  hi = labels.num;
+
+  if (labels.dirty)
+    {
+      build_label_indexes ();
+    }
+
+  while (lo < hi)
+    {
+      unsigned int  mid = lo + (hi - lo) / 2;
+
+      if (labels.entries[labels.by_addr[mid]].addr <= addr)
+	{
+	  lo = mid + 1;
+	}
+      else
+	{
+	  hi = mid;
+	}
+    }
+
+  return lo;
+
+}	/* label_upper_bound() */
 
 
 void
 init_labels ()
 {
-  int i;
-  for (i = 0; i < LABELS_HASH_SIZE; i++)
-    label_hash[i] = NULL;
+  memset (&labels, 0, sizeof (labels));
 }
 
 void
 add_label (oraddr_t addr, char *name)
 {
-  struct label_entry **tmp;
-  tmp = &(label_hash[addr % LABELS_HASH_SIZE]);
-  for (; *tmp; tmp = &((*tmp)->next)); // Find the next NULL label entry pointer (loop while the pointer de-refernce is non-NULL)
-  *tmp = malloc (sizeof (**tmp)); // allocate space for the pointer to the hash entry pointer
-  (*tmp)->name = malloc (strlen (name) + 1); // now allocate space for the name string
-  (*tmp)->addr = addr;
-  strcpy ((*tmp)->name, name);
-  (*tmp)->next = NULL;
+  if (labels.num == labels.max)
+    {
+      labels.max     = labels.max ? 2 * labels.max : 1024;
+      labels.entries = realloc (labels.entries,
+				labels.max * sizeof (*labels.entries));
+
+      if (NULL == labels.entries)
+	{
+	  fprintf (stderr, "ERROR: Out of memory for labels\n");
+	  exit (1);
+	}
+    }
+
+  labels.entries[labels.num].name = label_strdup (name);
+  labels.entries[labels.num].addr = addr;
+  labels.num++;
+  labels.dirty = 1;
 }
 
 struct label_entry *
 get_label (oraddr_t addr)
 {
-  struct label_entry *tmp = label_hash[addr % LABELS_HASH_SIZE];
-  while (tmp)
+  struct label_entry *entry = get_label_containing (addr);
+
+  return (entry && (entry->addr == addr)) ? entry : NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/*!Find the label at or immediately before an address
+
+   This is the label of the function (or object) containing the address,
+   assuming the symbols cover the code.
+
+   @param[in] addr  The address to look up
+
+   @return  The label with the greatest address not above addr, or NULL if
+            there is none                                                    */
+/*---------------------------------------------------------------------------*/
+struct label_entry *
+get_label_containing (oraddr_t addr)
+{
+  unsigned int  pos = label_upper_bound (addr);
+  oraddr_t      found;
+
+  if (0 == pos)
     {
-      if (tmp->addr == addr)
-	return tmp;
-      tmp = tmp->next;
+      return NULL;
     }
-  return NULL;
-}
+
+  /* Step back to the first label loaded for this address */
+  found = labels.entries[labels.by_addr[pos - 1]].addr;
+
+  while ((pos > 1) && (labels.entries[labels.by_addr[pos - 2]].addr == found))
+    {
+      pos--;
+    }
+
+  return &(labels.entries[labels.by_addr[pos - 1]]);
+
+}	/* get_label_containing() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Print an address as the label containing it
+
+   Printed as the name of the label, followed by the offset from the label in
+   decimal if there is one, as eval_label () reads it.
+
+   @param[in] f      The file to print to
+   @param[in] entry  The label containing the address
+   @param[in] addr   The address                                             */
+/*---------------------------------------------------------------------------*/
+void
+fprint_label (FILE               *f,
+	      struct label_entry *entry,
+	      oraddr_t            addr)
+{
+  if (entry->addr == addr)
+    {
+      fprintf (f, "%s", entry->name);
+    }
+  else
+    {
+      fprintf (f, "%s+%lu", entry->name,
+	       (unsigned long int) (addr - entry->addr));
+    }
+}	/* fprint_label() */
 
 struct label_entry *
 find_label (char *name)
 {
-  int i;
-  for (i = 0; i < LABELS_HASH_SIZE; i++)
+  unsigned int  h;
+
+  if (labels.dirty)
+    {
+      build_label_indexes ();
+    }
+
+  if (0 == labels.num)
     {
-      struct label_entry *tmp = label_hash[i % LABELS_HASH_SIZE];
-      while (tmp)
+      return NULL;
+    }
+
+  for (h = label_name_hash (name) & labels.name_mask; labels.by_name[h];
+       h = (h + 1) & labels.name_mask)
+    {
+      struct label_entry *entry = &(labels.entries[labels.by_name[h] - 1]);
+
+      if (0 == strcmp (entry->name, name))
 	{
-	  if (strcmp (tmp->name, name) == 0)
-	    return tmp;
-	  tmp = tmp->next;
+	  return entry;
 	}
     }
+
   return NULL;
 }
 
@@ -126,26 +438,84 @@ eval_label (char *name)
   return le->addr + positive_offset - negative_offset;
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Find the bitmap for the page holding an address
+
+   @param[in] addr  The address
+
+   @return  Pointer to the link to the page, which is NULL if the page has no
+            breakpoints                                                      */
+/*---------------------------------------------------------------------------*/
+static struct breakpoint_page **
+find_breakpoint_page (oraddr_t addr)
+{
+  oraddr_t                 page = addr >> BREAK_PAGE_BITS;
+  struct breakpoint_page **bp   =
+    &(breakpoint_pages[page & (BREAK_HASH_SIZE - 1)]);
+
+  while ((NULL != *bp) && ((*bp)->page != page))
+    {
+      bp = &((*bp)->next);
+    }
+
+  return bp;
+
+}	/* find_breakpoint_page() */
+
+
 void
 init_breakpoints ()
 {
   breakpoints = 0;
+  memset (breakpoint_offsets, 0, sizeof (breakpoint_offsets));
+  memset (breakpoint_pages, 0, sizeof (breakpoint_pages));
 }
 
 void
 add_breakpoint (oraddr_t addr)
 {
-  struct breakpoint_entry *tmp;
+  struct breakpoint_entry  *tmp;
+  struct breakpoint_page  **bp = find_breakpoint_page (addr);
+  unsigned int              off = BREAK_OFFSET (addr);
+
   tmp = (struct breakpoint_entry *) malloc (sizeof (struct breakpoint_entry));
   tmp->next = breakpoints;
   tmp->addr = addr;
   breakpoints = tmp;
+
+  if (NULL == *bp)
+    {
+      *bp = calloc (1, sizeof (**bp));
+
+      if (NULL == *bp)
+	{
+	  fprintf (stderr, "ERROR: Out of memory for breakpoints\n");
+	  exit (1);
+	}
+
+      (*bp)->page = addr >> BREAK_PAGE_BITS;
+    }
+
+  if (!((*bp)->bits[off / 32] & (UINT32_C (1) << (off % 32))))
+    {
+      (*bp)->bits[off / 32] |= UINT32_C (1) << (off % 32);
+      (*bp)->count++;
+    }
+
+  breakpoint_offsets[off / 32] |= UINT32_C (1) << (off % 32);
+
+  /* Translated blocks must not hold the breakpoint */
+  decode_cache_flush ();
 }
 
 void
 remove_breakpoint (oraddr_t addr)
 {
   struct breakpoint_entry **tmp = &breakpoints;
+  struct breakpoint_page  **bp  = find_breakpoint_page (addr);
+  unsigned int              off = BREAK_OFFSET (addr);
+  int                       i;
+
   while (*tmp)
     {
       if ((*tmp)->addr == addr)
@@ -157,6 +527,37 @@ remove_breakpoint (oraddr_t addr)
       else
 	tmp = &((*tmp)->next);
     }
+
+  if ((NULL == *bp) || !((*bp)->bits[off / 32] & (UINT32_C (1) << (off % 32))))
+    {
+      return;
+    }
+
+  (*bp)->bits[off / 32] &= ~(UINT32_C (1) << (off % 32));
+
+  if (0 == --(*bp)->count)
+    {
+      struct breakpoint_page *t = *bp;
+
+      *bp = t->next;
+      free (t);
+    }
+
+  /* The offset stays in the filter if another page uses it */
+  breakpoint_offsets[off / 32] &= ~(UINT32_C (1) << (off % 32));
+
+  for (i = 0; i < BREAK_HASH_SIZE; i++)
+    {
+      struct breakpoint_page *p;
+
+      for (p = breakpoint_pages[i]; NULL != p; p = p->next)
+	{
+	  breakpoint_offsets[off / 32] |= p->bits[off / 32] &
+	    (UINT32_C (1) << (off % 32));
+	}
+    }
+
+  decode_cache_flush ();
 }
 
 void
@@ -173,15 +574,41 @@ print_breakpoints ()
   printf ("---[breakpoints end]--------------\n");
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Is there a breakpoint at an address?
+
+   Just a test of the offset filter and then of the page's bitmap.
+
+   @param[in] addr  The (physical) address to check
+
+   @return  Non-zero if there is a breakpoint at addr                        */
+/*---------------------------------------------------------------------------*/
 int
 has_breakpoint (oraddr_t addr)
 {
-  struct breakpoint_entry *tmp = breakpoints;
-  while (tmp)
+  struct breakpoint_page *bp;
+  unsigned int            off = BREAK_OFFSET (addr);
+
+  if (!BREAK_OFFSET_SET (addr))
     {
-      if (tmp->addr == addr)
-	return 1;
-      tmp = tmp->next;
+      return 0;
     }
-  return 0;
-}
+
+  bp = *find_breakpoint_page (addr);
+
+  return (NULL != bp) && (bp->bits[off / 32] & (UINT32_C (1) << (off % 32)));
+
+}	/* has_breakpoint() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the labels and breakpoints as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_labels_state ()
+{
+  reg_sim_state (&breakpoints, sizeof (breakpoints));
+  reg_sim_state (&breakpoint_offsets, sizeof (breakpoint_offsets));
+  reg_sim_state (&breakpoint_pages, sizeof (breakpoint_pages));
+  reg_sim_state (&labels, sizeof (labels));
+}	/* reg_labels_state() */
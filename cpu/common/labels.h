@@ -35,7 +35,6 @@ struct label_entry
 {
   char               *name;
   oraddr_t            addr;
-  struct label_entry *next;
 };
 
 /*! Structure repesenting a breakpoint */
@@ -45,14 +44,34 @@ struct breakpoint_entry
   struct breakpoint_entry *next;
 };
 
+/*! Breakpoints are indexed by page. The page is the default MMU page size,
+    so a virtual address and its physical address usually have the same
+    offset in it. fetch() does not rely on this with smaller IMMU pages. */
+#define BREAK_PAGE_BITS   13
+#define BREAK_PAGE_WORDS  (1 << (BREAK_PAGE_BITS - 2))
+
+/*! Word offset of an address within its page */
+#define BREAK_OFFSET(addr)  (((addr) >> 2) & (BREAK_PAGE_WORDS - 1))
+
+/*! Non-zero if there is a breakpoint at the same page offset as addr in any
+    page. A cheap filter before translating and calling has_breakpoint(). */
+#define BREAK_OFFSET_SET(addr)						\
+  (breakpoint_offsets[BREAK_OFFSET (addr) / 32] &			\
+   (UINT32_C (1) << (BREAK_OFFSET (addr) % 32)))
+
 /* Globally visible variables */
 extern struct breakpoint_entry *breakpoints;
+extern uint32_t                 breakpoint_offsets[BREAK_PAGE_WORDS / 32];
 
 /* Function prototypes for external use */
 extern void                init_labels ();
 extern void                add_label (oraddr_t  addr,
 				      char     *name);
 extern struct label_entry *get_label (oraddr_t addr);
+extern struct label_entry *get_label_containing (oraddr_t addr);
+extern void                fprint_label (FILE               *f,
+					 struct label_entry *entry,
+					 oraddr_t            addr);
 extern struct label_entry *find_label (char *name);
 extern oraddr_t            eval_label (char *name);
 extern void                add_breakpoint (oraddr_t addr);
@@ -60,5 +79,6 @@ extern void                remove_breakpoint (oraddr_t addr);
 extern void                print_breakpoints ();
 extern int                 has_breakpoint (oraddr_t addr);
 extern void                init_breakpoints ();
+extern void                reg_labels_state ();
 
 #endif	/* LABELS__H_ */
@@ -40,6 +40,7 @@
 #include "coff.h"
 #include "elf.h"
 #include "labels.h"
+#include "toplevel-support.h"
 
 
 DECLARE_DEBUG_CHANNEL (coff)
@@ -301,6 +302,80 @@ addprogram (oraddr_t  address,
 }	/* addprogram () */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Add a block of the program at freemem
+
+   Normally the block is copied into memory in one go, by
+   set_program_block(). When the loader is translating addresses, each word
+   goes through addprogram() as before.
+
+   @param[in] buf  The block, in big endian format, or NULL for zeros
+   @param[in] len  The length of the block in bytes                          */
+/*---------------------------------------------------------------------------*/
+static void
+addblock (const uint8_t *buf,
+	  uint32_t       len)
+{
+  uint32_t  i;
+
+  if (transl_table)
+    {
+      for (i = 0; i < len; i += 4)
+	{
+	  addprogram (freemem, buf ? ((uint32_t) buf[i] << 24 |
+				      (uint32_t) buf[i + 1] << 16 |
+				      (uint32_t) buf[i + 2] << 8 |
+				      (uint32_t) buf[i + 3]) : 0);
+	}
+
+      return;
+    }
+
+  set_program_block (freemem, buf, len);
+
+#if IMM_STATS
+  for (i = 0; buf && (i + 4 <= len); i += 4)
+    {
+      check_insn ((uint32_t) buf[i] << 24 | (uint32_t) buf[i + 1] << 16 |
+		  (uint32_t) buf[i + 2] << 8 | (uint32_t) buf[i + 3]);
+    }
+#endif
+
+  freemem += (len + 3) & ~3;
+
+}	/* addblock () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Load a block of a file as part of the program at freemem
+
+   The whole block is read at once and added with addblock(). A block cut
+   short by the end of the file is loaded as far as it goes.
+
+   @param[in] inputfs  The file, positioned at the start of the block
+   @param[in] len      The length of the block in bytes
+
+   @return  0 on success, -1 if out of memory                                */
+/*---------------------------------------------------------------------------*/
+static int
+loadblock (FILE     *inputfs,
+	   uint32_t  len)
+{
+  /* Padded to whole words, for the translating loader */
+  uint8_t *buf = calloc ((len + 3) & ~3, 1);
+
+  if (NULL == buf)
+    {
+      return  -1;
+    }
+
+  addblock (buf, fread (buf, 1, len, inputfs));
+  free (buf);
+  return  0;
+
+}	/* loadblock () */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Load big-endian COFF file
 
@@ -312,12 +387,9 @@ readfile_coff (char  *filename,
 	       short  sections)
 {
   FILE *inputfs;
-  char inputbuf[4];
-  uint32_t insn;
   int32_t sectsize;
   COFF_AOUTHDR coffaouthdr;
   struct COFF_scnhdr coffscnhdr;
-  int len;
   int firstthree = 0;
 
   if (!(inputfs = fopen (filename, "r")))
@@ -374,18 +446,13 @@ readfile_coff (char  *filename,
 	  perror ("readfile_coff");
 	  exit (1);
 	}
-      while (sectsize > 0
-	     && (len = fread (&inputbuf, sizeof (inputbuf), 1, inputfs)))
+      /* All instructions are 4 bytes, so the section may be loaded in one
+	 go. */
+      if ((sectsize > 0) && loadblock (inputfs, sectsize))
 	{
-	  insn = COFF_LONG_H (inputbuf);
-	  len = or1ksim_insn_len (or1ksim_insn_decode (insn));
-	  if (len == 2)
-	    {
-	      fseek (inputfs, -2, SEEK_CUR);
-	    }
-
-	  addprogram (freemem, insn);
-	  sectsize -= len;
+	  fclose (inputfs);
+	  perror ("readfile_coff");
+	  exit (1);
 	}
     }
   if (firstthree < 3)
@@ -496,7 +563,7 @@ load_by_program_headers_elf (FILE *inputfs,
 			     struct elf32_phdr *elf_phdata)
 {
   int segments_loaded = 0;
-  int i, len;
+  int i;
 
   /* Iterate over prgram headers and load PT_LOAD segments.  */
   for (i = 0; i < ELF_SHORT_H (elfhdr->e_phnum); i++)
@@ -506,8 +573,8 @@ load_by_program_headers_elf (FILE *inputfs,
       if (ELF_LONG_H (ph->p_type) == PT_LOAD)
 	{
 	  uint32_t padd = ELF_LONG_H (ph->p_paddr);
-	  uint32_t inputbuf, insn;
-	  int segsize;
+	  uint32_t filesz = ELF_LONG_H (ph->p_filesz);
+	  uint32_t memsz = ELF_LONG_H (ph->p_memsz);
 
 	  PRINTFQ ("Program Header: PT_LOAD,");
 	  PRINTFQ (" vaddr: 0x%.8lx,", ELF_LONG_H (ph->p_vaddr));
@@ -517,21 +584,25 @@ load_by_program_headers_elf (FILE *inputfs,
 	  PRINTFQ (" memsz: 0x%.8lx\n", ELF_LONG_H (ph->p_memsz));
 
 	  freemem = padd;
-	  segsize = ELF_LONG_H (ph->p_filesz);
 
 	  if (fseek (inputfs, ELF_LONG_H (ph->p_offset), SEEK_SET) !=
 	      0)
 	    {
-	      perror ("laod_by_program_headers_elf");
+	      perror ("load_by_program_headers_elf");
 	      return -1;
 	    }
 
-	  while (segsize > 0
-		 && (len = fread (&inputbuf, sizeof (inputbuf), 1, inputfs)))
+	  if (loadblock (inputfs, filesz))
 	    {
-	      insn = ELF_LONG_H (inputbuf);
-	      addprogram (freemem, insn);
-	      segsize -= 4;
+	      perror ("load_by_program_headers_elf");
+	      return -1;
+	    }
+
+	  /* Clear the rest of the segment (the BSS) */
+	  if ((memsz > filesz) && !transl_table)
+	    {
+	      freemem = padd + filesz;
+	      addblock (NULL, memsz - filesz);
 	    }
 
 	  segments_loaded++;
@@ -549,7 +620,7 @@ load_by_section_headers_elf (FILE *inputfs,
   char *s_str = NULL;
   struct elf32_shdr *elf_spnt;
   int sections_loaded = 0;
-  int i, j, len;
+  int i, j;
 
   /* Load section name string table.  Used for printing section names.  */
   if (ELF_SHORT_H (elfhdr->e_shstrndx) != SHN_UNDEF)
@@ -584,8 +655,6 @@ load_by_section_headers_elf (FILE *inputfs,
 	  && (ELF_LONG_H (elf_spnt->sh_flags) & SHF_ALLOC))
 	{
 	  uint32_t padd;
-	  uint32_t inputbuf, insn;
-	  int sectsize;
 
 	  padd = ELF_LONG_H (elf_spnt->sh_addr);
 	  /* Search if section is within program header segment, if
@@ -620,7 +689,6 @@ load_by_section_headers_elf (FILE *inputfs,
 	  PRINTFQ (" size: 0x%.8lx\n", ELF_LONG_H (elf_spnt->sh_size));
 
 	  freemem = padd;
-	  sectsize = ELF_LONG_H (elf_spnt->sh_size);
 
 	  if (fseek (inputfs, ELF_LONG_H (elf_spnt->sh_offset), SEEK_SET) !=
 	      0)
@@ -629,12 +697,10 @@ load_by_section_headers_elf (FILE *inputfs,
 	      exit (1);
 	    }
 
-	  while (sectsize > 0
-		 && (len = fread (&inputbuf, sizeof (inputbuf), 1, inputfs)))
+	  if (loadblock (inputfs, ELF_LONG_H (elf_spnt->sh_size)))
 	    {
-	      insn = ELF_LONG_H (inputbuf);
-	      addprogram (freemem, insn);
-	      sectsize -= 4;
+	      perror ("load_by_section_headers_elf");
+	      exit (1);
 	    }
 
 	  sections_loaded++;
@@ -963,3 +1029,16 @@ loadcode (char *filename, oraddr_t startaddr, oraddr_t virtphy_transl)
     return translate (freemem);
 
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the program loader's state as simulator state                   */
+/*---------------------------------------------------------------------------*/
+void
+reg_parse_state ()
+{
+  reg_sim_state (&freemem, sizeof (freemem));
+  reg_sim_state (&transl_table, sizeof (transl_table));
+  reg_sim_state (&transl_error, sizeof (transl_error));
+
+}	/* reg_parse_state() */
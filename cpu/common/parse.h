@@ -37,5 +37,6 @@ char     *strstrip (char       *dst,
 uint32_t  loadcode (char     *filename,
 		    oraddr_t  startaddr,
 		    oraddr_t  virtphy_transl);
+void      reg_parse_state ();
 
 #endif	/* PARSE__H */
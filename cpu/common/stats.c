@@ -34,6 +34,7 @@
 #include "icache-model.h"
 #include "spr-defs.h"
 #include "execute.h"
+#include "toplevel-support.h"
 
 
 #define DSTATS_LEN	3000
@@ -291,6 +292,10 @@ printotherstats (int which)
 	      (immu_stats.fetch_tlbhit * 100) / SD (immu_stats.fetch_tlbhit +
 						    immu_stats.fetch_tlbmiss),
 	      immu_stats.fetch_tlbmiss);
+
+      if (immu_stats.walks)
+	PRINTF ("IMMU walks: %d, no entry %d\n", immu_stats.walks,
+		immu_stats.walk_misses);
     }
   else
     PRINTF ("No IMMU. Set UPR[IMP]\n");
@@ -301,6 +306,10 @@ printotherstats (int which)
 	      (dmmu_stats.loads_tlbhit * 100) / SD (dmmu_stats.loads_tlbhit +
 						    dmmu_stats.loads_tlbmiss),
 	      dmmu_stats.loads_tlbmiss);
+
+      if (dmmu_stats.walks)
+	PRINTF ("DMMU walks: %d, no entry %d\n", dmmu_stats.walks,
+		dmmu_stats.walk_misses);
     }
   else
     PRINTF ("No DMMU. Set UPR[DMP]\n");
@@ -425,3 +434,22 @@ printstats (int which)
       break;
     }
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the statistics as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_stats_state ()
+{
+  reg_sim_state (&or1k_mstats, sizeof (or1k_mstats));
+  reg_sim_state (&ic_stats, sizeof (ic_stats));
+  reg_sim_state (&dc_stats, sizeof (dc_stats));
+  reg_sim_state (&immu_stats, sizeof (immu_stats));
+  reg_sim_state (&dmmu_stats, sizeof (dmmu_stats));
+  reg_sim_state (&raw_stats, sizeof (raw_stats));
+  reg_sim_state (&dstats, sizeof (dstats));
+  reg_sim_state (&sstats, sizeof (sstats));
+  reg_sim_state (&fstats, sizeof (fstats));
+
+}	/* reg_stats_state() */
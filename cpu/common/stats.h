@@ -68,6 +68,8 @@ struct immustats_entry
   int fetch_tlbhit;
   int fetch_tlbmiss;
   int fetch_pagefaults;
+  int walks;			/* Page table walks on ITLB misses */
+  int walk_misses;		/* Walks which found no valid entry */
 };				/*!< IMMU stats */
 
 struct dmmustats_entry
@@ -78,6 +80,8 @@ struct dmmustats_entry
   int stores_tlbhit;
   int stores_tlbmiss;
   int stores_pagefaults;
+  int walks;			/* Page table walks on DTLB misses */
+  int walk_misses;		/* Walks which found no valid entry */
 };				/*!< DMMU stats */
 
 struct raw_stats
@@ -101,5 +105,6 @@ extern void addfstats (enum insn_type item1, enum insn_type item2,
 		       int cnt_dynamic, int depend);
 extern void initstats ();
 extern void printstats ();
+extern void reg_stats_state ();
 
 #endif	/*  STATS__H */
@@ -53,7 +53,7 @@
 #define OR32_R_FLAG   (4)
 
 #if defined(HAVE_EXECUTION)
-# if SIMPLE_EXECUTION
+# if SIMPLE_EXECUTION || BLOCK_EXECUTION
 #  include "simpl32-defs.h"
 # endif
 #endif
@@ -106,9 +106,9 @@ struct or32_opcode {
   char *encoding;
 
 #ifdef HAVE_EXECUTION
-# if COMPLEX_EXECUTION
+# if COMPLEX_EXECUTION || defined (OR32_GENERATE)
   char *function_name;
-# elif SIMPLE_EXECUTION
+# elif SIMPLE_EXECUTION || BLOCK_EXECUTION
   void (*exec)(struct iqueue_entry *);
 # endif
 #else  /* HAVE_EXECUTION */
@@ -153,6 +153,21 @@ struct temp_insn_struct
   int in_pass;
 };
 
+/* Decode tables generated at build time by generate.c, in decodegen.c.  The
+   primary opcode indexes the primary table, whose entry says which field of
+   the instruction indexes the secondary table.  */
+struct insn_decode_primary
+{
+  unsigned int shift;
+  unsigned int mask;
+  unsigned int base;
+};
+
+struct insn_decode_match
+{
+  unsigned long insn;
+  unsigned long insn_mask;
+};
   
 extern unsigned long *or1ksim_automata;
 extern struct temp_insn_struct *or1ksim_ti;
@@ -181,7 +196,8 @@ extern void or1ksim_build_automata PARAMS ((int  quiet));
 /* MM: Destructs FSM.  */ 
 extern void or1ksim_destruct_automata PARAMS ((void));
 
-/* MM: Decodes instruction using FSM.  Call or1ksim_build_automata first.  */
+/* MM: Decodes instruction using the generated decode tables (using FSM in
+   generate itself).  Call or1ksim_build_automata first.  */
 extern int or1ksim_insn_decode PARAMS((unsigned int insn));
 
 /* Disassemble one instruction from insn to disassemble.
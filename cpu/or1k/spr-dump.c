@@ -230,6 +230,8 @@ static const struct spr_def spr_sys_group[] = {
  /* 020-02f */ { 0x020, 0x02f, "SPR_EPCR(%i)", spr_one_val  },
  /* 030-03f */ { 0x030, 0x03f, "SPR_EEAR(%i)", spr_one_val  },
  /* 040-04f */ { 0x040, 0x04f, "SPR_ESR(%i)",  spr_sr       },
+ /* 080-080 */ { 0x080, 0x080, "SPR_COREID",   spr_one_val  },
+ /* 081-081 */ { 0x081, 0x081, "SPR_NUMCORES", spr_one_val  },
  /* 400-41f */ { 0x400, 0x41f, "GPR(%i)",      spr_one_val  },
  /* ------- */ { -1,    -1,    NULL,           NULL         } };
 
@@ -240,6 +242,7 @@ static const struct spr_bit_def spr_dmmucr[] = {
  { "DMMUCR_P1S", SPR_DMMUCR_P1S },
  { "DMMUCR_VADDR_WIDTH", SPR_DMMUCR_VADDR_WIDTH },
  { "DMMUCR_PADDR_WIDTH", SPR_DMMUCR_PADDR_WIDTH },
+ { "DMMUCR_PTBP", SPR_DMMUCR_PTBP },
  { NULL, 0 } };
 
 /* dtlbmr register */
@@ -286,6 +289,7 @@ static const struct spr_bit_def spr_immucr[] = {
  { "IMMUCR_P1S", SPR_IMMUCR_P1S },
  { "IMMUCR_VADDR_WIDTH", SPR_IMMUCR_VADDR_WIDTH },
  { "IMMUCR_PADDR_WIDTH", SPR_IMMUCR_PADDR_WIDTH },
+ { "IMMUCR_PTBP", SPR_IMMUCR_PTBP },
  { NULL, 0 } };
 
 /* itlbmr register */
@@ -55,6 +55,14 @@ void mtspr(uint16_t regno, const uorreg_t value)
 {
   uorreg_t prev_val;
 
+  /* Cached translations depend on the TLBs. Any LRU updates still pending
+     must be made before the write. The SR need not flush them, since they are
+     kept per SR[SM] and SR[DME]/SR[IME] are checked before they are used. */
+  if ((regno >= SPR_DTLBMR_BASE(0)) && (regno <= SPR_DTLBTR_LAST(3)))
+    dmmu_flush_utlb();
+  if ((regno >= SPR_ITLBMR_BASE(0)) && (regno <= SPR_ITLBTR_LAST(3)))
+    immu_flush_utlb();
+
   prev_val = cpu_state.sprs[regno];
   cpu_state.sprs[regno] = value;
 
@@ -204,6 +212,12 @@ uorreg_t mfspr(const uint16_t regno)
 {
   uorreg_t ret;
 
+  /* Make sure the LRU bits are up to date */
+  if ((regno >= SPR_DTLBMR_BASE(0)) && (regno <= SPR_DTLBTR_LAST(3)))
+    dmmu_sync_lru();
+  if ((regno >= SPR_ITLBMR_BASE(0)) && (regno <= SPR_ITLBTR_LAST(3)))
+    immu_sync_lru();
+
   ret = cpu_state.sprs[regno];
 
   switch (regno) {
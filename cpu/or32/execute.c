@@ -29,7 +29,8 @@
 
 /* Most of the OR1K simulation is done in here.
 
-   When SIMPLE_EXECUTION is defined below a file insnset.c is included!
+   When SIMPLE_EXECUTION or BLOCK_EXECUTION is defined below a file insnset.c
+   is included!
 */
 
 /* Autoconf and/or portability configuration */
@@ -38,10 +39,13 @@
 
 /* System includes */
 #include <stdlib.h>
+#include <float.h>
+#include <math.h>
 
 /* Package includes */
 #include "execute.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "except.h"
 #include "labels.h"
 #include "sched.h"
@@ -56,19 +60,136 @@
 #include "sprs.h"
 #include "rsp-server.h"
 #include "softfloat.h"
+#include "icache-model.h"
 
-/* Includes and macros for simple execution */
-#if SIMPLE_EXECUTION
+/* Includes and macros for simple and basic block execution */
+#if SIMPLE_EXECUTION || BLOCK_EXECUTION
 
-#define SET_PARAM0(val) set_operand(0, val, current->insn_index, current->insn)
+#define SET_PARAM0(val) set_operand (&cur_decoded->op[0], val)
+#define REG_PARAM0      (cur_decoded->op[0].reg)
 
-#define PARAM0 eval_operand(0, current->insn_index, current->insn)
-#define PARAM1 eval_operand(1, current->insn_index, current->insn)
-#define PARAM2 eval_operand(2, current->insn_index, current->insn)
+#define PARAM0 eval_operand (&cur_decoded->op[0])
+#define PARAM1 eval_operand (&cur_decoded->op[1])
+#define PARAM2 eval_operand (&cur_decoded->op[2])
 
 #define INSTRUCTION(name) void name (struct iqueue_entry *current)
 
-#endif	/* SIMPLE_EXECUTION */
+/*! Number of entries in the decoded instruction cache (a power of 2) */
+#define DECODE_CACHE_SIZE   16384
+#define DECODE_CACHE_MASK   (DECODE_CACHE_SIZE - 1)
+
+/*! Tag of an empty cache entry. Never matches a word aligned address */
+#define DECODE_CACHE_EMPTY  1
+
+/*! The most operands any instruction has */
+#define MAX_DECODED_OPS  4
+
+/*! The kinds of predecoded operand */
+enum decoded_op_type
+{
+  DOP_NONE,			/*!< No such operand */
+  DOP_IMM,			/*!< Immediate */
+  DOP_REG,			/*!< Register direct */
+  DOP_DIS			/*!< Displacement plus base register */
+};
+
+/*! A predecoded operand */
+struct decoded_op
+{
+  enum decoded_op_type  type;
+  unsigned int          reg;	/*!< Register number, if any */
+  uorreg_t              imm;	/*!< Sign extended immediate, if any */
+};
+
+#if BLOCK_EXECUTION
+/*! Common pairs of instructions, which a block runs as one. See
+    exec_block_pair(). */
+enum fused_pair
+{
+  FUSE_NONE,			/*!< Not the first of a fused pair */
+  FUSE_MOVHI_ORI		/*!< l.movhi rD,K; l.ori rD2,rD,K2 */
+};
+#endif
+
+/*! An entry in the decoded instruction cache */
+struct decoded_insn
+{
+  oraddr_t           addr;	/*!< Physical address of the instruction */
+  uint32_t           insn;	/*!< The instruction itself */
+  int                insn_index;	/*!< Index into or1ksim_or32_opcodes */
+  void             (*exec) (struct iqueue_entry *);	/*!< Handler */
+  struct decoded_op  op[MAX_DECODED_OPS];	/*!< Extracted operands */
+#if BLOCK_EXECUTION
+  enum fused_pair    fuse;	/*!< Pair this starts, if any */
+#endif
+};
+
+/*! The entry for the instruction being executed, used by PARAMx */
+static struct decoded_insn *cur_decoded;
+
+#endif	/* SIMPLE_EXECUTION || BLOCK_EXECUTION */
+
+#if BLOCK_EXECUTION
+
+/*! Most instructions in a basic block */
+#define MAX_BLOCK_INSNS  32
+
+/*! Number of hash chains for looking up blocks (a power of 2) */
+#define BLOCK_HASH_SIZE  16384
+#define BLOCK_HASH_MASK  (BLOCK_HASH_SIZE - 1)
+
+/*! Blocks never cross a code page. Writes to a page holding blocks cause the
+    blocks overlapping the address written to be discarded. */
+#define CODE_PAGE_BITS   10
+#define CODE_PAGE_SIZE   (1 << CODE_PAGE_BITS)
+
+/*! Translated blocks held before they are all discarded */
+#define MAX_BLOCKS       65536
+
+/*! A basic block of predecoded instructions */
+struct block
+{
+  oraddr_t             addr;	/*!< Physical address of first instruction */
+  int                  ninsns;	/*!< Number of instructions */
+  int                  valid;	/*!< Cleared when the block is discarded */
+  struct dev_memarea  *mem;	/*!< Memory area the block was fetched from */
+  struct decoded_insn *insns;	/*!< The instructions with their handlers */
+  struct block        *next;	/*!< Next in hash chain or dead list */
+  int                  breakpoint;	/*!< Holds a breakpoint */
+#if HAVE_JIT
+  int                  execs;	/*!< Times run before translation */
+  int                (*code) (void);	/*!< Host code, or NULL */
+  int                  code_immu;	/*!< IMMU enabled when translated */
+  int                  code_cost;	/*!< Fetch cycles per insn assumed */
+#endif
+};
+
+#endif	/* BLOCK_EXECUTION */
+
+#if SIMPLE_EXECUTION || BLOCK_EXECUTION
+/*! The decoded instructions and translated blocks of a machine. They only
+    depend on its memory, so the cores of a multi-core machine share them,
+    while each library instance has its own and keeps it when another instance
+    runs. Allocated by decode_cache_flush() at reset. */
+struct decode_state
+{
+  struct decoded_insn  cache[DECODE_CACHE_SIZE];	/*!< By physical addr */
+#if BLOCK_EXECUTION
+  struct block        *block_hash[BLOCK_HASH_SIZE];	/*!< Hashed blocks */
+  struct block        *dead_blocks;	/*!< Discarded, waiting to be freed */
+  int                  num_blocks;	/*!< Number of blocks in block_hash */
+  unsigned char        code_pages[1 << (32 - CODE_PAGE_BITS - 3)];
+					/*!< Bit set per page with blocks */
+#endif
+#if HAVE_JIT
+  unsigned char       *jit_code;	/*!< The buffer for host code */
+  size_t               jit_code_used;	/*!< Bytes of jit_code used */
+#endif
+};
+
+/*! The current machine's decode state, registered as simulator state */
+static struct decode_state *dstate = NULL;
+#endif	/* SIMPLE_EXECUTION || BLOCK_EXECUTION */
 
 
 /*! Current cpu state. Globally available. */
@@ -103,11 +224,40 @@ static int  sbuf_buf[MAX_SBUF_LEN] = { 0 };
 static int sbuf_prev_cycles = 0;
 
 /* Variables used throughout this file to share information */
-static int  breakpoint;
-static int  next_delay_insn;
+static int       breakpoint;
+static int       next_delay_insn;
+static oraddr_t  insn_paddr;
+
+/* Set when nothing needs to hear about each memory access, so the plain
+   fetch (and with the generated decoder, the plain instruction handlers) can
+   be used. See exec_select_handlers(). */
+static int       plain_handlers;
+
+/* Guest idle loop detection. Trips round the loop are only skipped once it has
+   been round IDLE_LOOP_TRIPS times at the same cost, by when any caches and
+   TLB LRU state will have settled. The ITLB and instruction cache hits of a
+   trip are counted, so skipped trips can be added to their statistics. */
+#define IDLE_LOOP_TRIPS  4
+#define IDLE_PC_NONE     1		/* Never an instruction address */
+
+static oraddr_t       idle_pc = IDLE_PC_NONE;
+static long long int  idle_cycles;
+static long long int  idle_insns;
+static long long int  idle_trip;
+static int            idle_trips;
+static int            idle_itlb_hits;		/* At the start of the trip */
+static int            idle_ic_hits;
+static int            idle_trip_itlb_hits;	/* In one trip */
+static int            idle_trip_ic_hits;
 
 /* Forward declaration of static functions */
 static void decode_execute (struct iqueue_entry *current);
+#if COMPLEX_EXECUTION
+static void decode_execute_plain (struct iqueue_entry *current);
+#endif
+#if BLOCK_EXECUTION
+static int  exec_block ();
+#endif
 
 /*---------------------------------------------------------------------------*/
 /*!Get an actual value of a specific register
@@ -341,6 +491,10 @@ check_depend (struct iqueue_entry *prev,
 }	/* check_depend() */
 
 
+/*! Set when fetch() stops at a breakpoint, so the next fetch from the same
+    address goes ahead */
+static int  break_just_hit = 0;
+
 /*---------------------------------------------------------------------------*/
 /*!Should instruction NOT be executed?
 
@@ -351,15 +505,21 @@ check_depend (struct iqueue_entry *prev,
 static int
 fetch ()
 {
-  static int break_just_hit = 0;
-
   if (NULL != breakpoints)
     {
       /* MM: Check for breakpoint.  This has to be done in fetch cycle,
          because of peripheria.  
          MM1709: if we cannot access the memory entry, we could not set the
-         breakpoint earlier, so just check the breakpoint list.  */
-      if (has_breakpoint (peek_into_itlb (cpu_state.pc)) && !break_just_hit)
+         breakpoint earlier, so just check the breakpoint list.
+
+	 Translation preserves the page offset, so the ITLB need only be
+	 looked at when some page has a breakpoint at this offset. IMMU pages
+	 smaller than those of the filter do not preserve all of its offset,
+	 so then it is always looked at. */
+      if ((BREAK_OFFSET_SET (cpu_state.pc) ||
+	   ((NULL != immu_state) &&
+	    (immu_state->pagesize < (1 << BREAK_PAGE_BITS)))) &&
+	  has_breakpoint (peek_into_itlb (cpu_state.pc)) && !break_just_hit)
 	{
 	  break_just_hit = 1;
 	  return 1;		/* Breakpoint set. */
@@ -369,7 +529,9 @@ fetch ()
 
   breakpoint                 = 0;
   cpu_state.iqueue.insn_addr = cpu_state.pc;
-  cpu_state.iqueue.insn      = eval_insn (cpu_state.pc, &breakpoint);
+  cpu_state.iqueue.insn      = plain_handlers ?
+    eval_insn_plain (cpu_state.pc, &insn_paddr, &breakpoint) :
+    eval_insn (cpu_state.pc, &insn_paddr, &breakpoint);
 
   /* Fetch instruction. */
   if (!except_pending)
@@ -635,11 +797,19 @@ dump_exe_log ()
 	  or1ksim_disassemble_index (cpu_state.iqueue.insn,
 			     cpu_state.iqueue.insn_index);
 
-	  entry = get_label (insn_addr);
-	  if (entry)
+	  /* Name the function at its start, and wherever the log moves into
+	     it from elsewhere, such as on returning from a call */
+	  entry = get_label_containing (insn_addr);
+	  if (entry && ((entry->addr == insn_addr) ||
+			!runtime.sim.exe_log_labelled ||
+			(entry->addr != runtime.sim.exe_log_label)))
 	    {
-	      fprintf (runtime.sim.fexe_log, "%s:\n", entry->name);
+	      fprint_label (runtime.sim.fexe_log, entry, insn_addr);
+	      fprintf (runtime.sim.fexe_log, ":\n");
 	    }
+
+	  runtime.sim.exe_log_labelled = (NULL != entry);
+	  runtime.sim.exe_log_label    = entry ? entry->addr : 0;
 	  
 	  if (config.sim.exe_log_type == EXE_LOG_SOFTWARE)
 	    {
@@ -823,7 +993,16 @@ decode_execute_wrapper (struct iqueue_entry *current)
 #error HAVE_EXECUTION has to be defined in order to execute programs.
 #endif
 
-  decode_execute (current);
+#if COMPLEX_EXECUTION
+  if (plain_handlers)
+    {
+      decode_execute_plain (current);
+    }
+  else
+#endif
+    {
+      decode_execute (current);
+    }
 
   if (breakpoint)
     {
@@ -856,6 +1035,10 @@ cpu_reset ()
   memset (&cpu_state.iqueue,   0, sizeof (cpu_state.iqueue));
   memset (&cpu_state.icomplet, 0, sizeof (cpu_state.icomplet));
 
+  decode_cache_flush ();
+
+  idle_pc          = IDLE_PC_NONE;
+
   sbuf_head        = 0;
   sbuf_tail        = 0;
   sbuf_count       = 0;
@@ -912,9 +1095,33 @@ cpu_reset ()
   cpu_state.pc   = cpu_state.sprs[SPR_SR] & SPR_SR_EPH ?
     0xf0000000 + EXCEPT_RESET : EXCEPT_RESET;
 
+  exec_select_handlers ();
+
 }	/* cpu_reset() */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Choose the instruction handlers to suit the configuration
+
+   generate.c emits two decoders: the full one, and a plain one for a purely
+   functional simulation, whose handlers (and memory accessors) leave out
+   statistics, memory profiling, the PCU, the debug unit, the data cache and
+   the store buffer altogether. The plain fetch likewise leaves out the
+   instruction cache.
+
+   Called at reset, and whenever the configuration may have been changed, for
+   instance by the "set" command.                                            */
+/*---------------------------------------------------------------------------*/
+void
+exec_select_handlers ()
+{
+  plain_handlers = !do_stats && !config.sim.mprofile && !config.pcu.enabled &&
+    !config.debug.enabled && !config.dc.enabled && !config.cpu.sbuf_len &&
+    !((NULL != ic_state) && ic_state->enabled);
+
+}	/* exec_select_handlers() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Simulates one CPU clock cycle
  
@@ -955,20 +1162,225 @@ cpu_clock ()
 
 
 /*---------------------------------------------------------------------------*/
-/*!If decoding cannot be found, call this function                           */
+/*!If decoding cannot be found, call this function
+
+   The same signature is used for all execution styles, so the instruction
+   bodies in insnset.c can call it directly.
+
+   @param[in] current  The instruction being executed                        */
 /*---------------------------------------------------------------------------*/
-#if SIMPLE_EXECUTION
 void
 l_invalid (struct iqueue_entry *current)
 {
-#else
+  except_handle (EXCEPT_ILLEGAL, current->insn_addr);
+
+}	/* l_invalid() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Does anything need to see each instruction as it is executed?
+
+   Tracing, statistics, the debug unit, memory profiling, the PCU and VAPI
+   all do. Breakpoints are checked when fetching, and translated blocks never
+   hold one, so they need not be seen here.
+
+   @return  Non-zero if every instruction must go through cpu_clock()        */
+/*---------------------------------------------------------------------------*/
+static int
+insn_observed ()
+{
+  return  !runtime.sim.hush || do_stats ||
+    config.debug.enabled || config.sim.mprofile || config.pcu.enabled ||
+    (config.vapi.enabled && runtime.vapi.enabled);
+
+}	/* insn_observed() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Skip round a guest idle loop
+
+   A guest with nothing to do may spin on "l.j 0; l.nop" (just "l.j 0"
+   without delay slots), waiting for an interrupt. Nothing changes from one
+   trip round such a loop to the next except the cycle and instruction
+   counts. So once trips have settled to a steady cost, as many whole trips as
+   fit before the next scheduled job are added in one go. The job (which may
+   well be the awaited interrupt) then runs on exactly the same cycle as it
+   would otherwise.
+
+   Called at the start of each instruction. Only done if the idle_skip
+   parameter of section sim is set.
+
+   @param[in] max_cycles  The most cycles to skip, or negative for no limit  */
+/*---------------------------------------------------------------------------*/
 void
-l_invalid ()
+skip_idle_loop (long long int  max_cycles)
+{
+  oraddr_t       pc = cpu_state.pc;
+  int            nd = cpu_state.sprs[SPR_CPUCFGR] & SPR_CPUCFGR_ND;
+  oraddr_t       paddr;
+  long long int  trips;
+  int            itlb_hits;
+  int            ic_hits;
+
+  if (!config.sim.idle_skip)
+    {
+      return;
+    }
+
+  /* Cheap check that we have just come back round "l.j 0; l.nop", or "l.j 0"
+     without delay slots. */
+  if (nd ? ((0x00000000 != cpu_state.iqueue.insn) ||
+	    (cpu_state.iqueue.insn_addr != pc)) :
+      ((0x15000000 != cpu_state.iqueue.insn) ||
+       (cpu_state.iqueue.insn_addr != pc + 4)))
+    {
+      return;
+    }
+
+  if (cpu_state.delay_insn || insn_observed () || (NULL != breakpoints))
+    {
+      idle_pc = IDLE_PC_NONE;
+      return;
+    }
+
+  /* A steady trip is exactly the loop's instructions, at the same cost and
+     with the same ITLB and instruction cache hits as last time. */
+  itlb_hits = immu_stats.fetch_tlbhit - idle_itlb_hits;
+  ic_hits   = ic_stats.readhit - idle_ic_hits;
+
+  if ((pc == idle_pc) &&
+      ((runtime.cpu.instructions - idle_insns) == (nd ? 1 : 2)) &&
+      ((runtime.sim.cycles - idle_cycles) == idle_trip) &&
+      (itlb_hits == idle_trip_itlb_hits) && (ic_hits == idle_trip_ic_hits))
+    {
+      idle_trips++;
+    }
+  else
+    {
+      paddr = peek_into_itlb (pc);
+
+      if ((0 == paddr) || (0x00000000 != eval_direct32 (paddr, 0, 0)))
+	{
+	  idle_pc = IDLE_PC_NONE;
+	  return;
+	}
+
+      idle_trip           = (pc == idle_pc) ?
+	runtime.sim.cycles - idle_cycles : 0;
+      idle_trip_itlb_hits = (pc == idle_pc) ? itlb_hits : 0;
+      idle_trip_ic_hits   = (pc == idle_pc) ? ic_hits : 0;
+      idle_trips          = 0;
+    }
+
+  idle_pc        = pc;
+  idle_cycles    = runtime.sim.cycles;
+  idle_insns     = runtime.cpu.instructions;
+  idle_itlb_hits = immu_stats.fetch_tlbhit;
+  idle_ic_hits   = ic_stats.readhit;
+
+  if ((idle_trips < IDLE_LOOP_TRIPS) || (idle_trip <= 0))
+    {
+      return;
+    }
+
+  /* Leave the scheduler time positive, so the job runs after the last trip
+     as usual. */
+  trips = (scheduler.job_queue->time - 1) / idle_trip;
+
+  if ((max_cycles >= 0) && (trips > max_cycles / idle_trip))
+    {
+      trips = max_cycles / idle_trip;
+    }
+
+  if (trips > 0)
+    {
+      runtime.sim.cycles        += trips * idle_trip;
+      runtime.cpu.instructions  += trips * (nd ? 1 : 2);
+      scheduler.job_queue->time -= trips * idle_trip;
+
+      /* Every fetch of a steady trip hits, leaving the LRU state as it was,
+	 so only the hit counts move on. */
+      immu_stats.fetch_tlbhit   += trips * idle_trip_itlb_hits;
+      ic_stats.readhit          += trips * idle_trip_ic_hits;
+
+      idle_cycles    = runtime.sim.cycles;
+      idle_insns     = runtime.cpu.instructions;
+      idle_itlb_hits = immu_stats.fetch_tlbhit;
+      idle_ic_hits   = ic_stats.readhit;
+    }
+}	/* skip_idle_loop() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Is the CPU dozing or sleeping?
+
+   @return  Non-zero if power management has stopped the CPU clock           */
+/*---------------------------------------------------------------------------*/
+int
+cpu_dozing ()
+{
+  return  config.pm.enabled &&
+    (cpu_state.sprs[SPR_PMR] & (SPR_PMR_DME | SPR_PMR_SME));
+
+}	/* cpu_dozing() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Run a batch of instructions
+
+   Runs up to config.sim.quantum instructions, doing the cycle accounting for
+   each, but without any of the main loop's per instruction work. The batch
+   ends as soon as a scheduled job is due, an external interrupt is raised or
+   cleared, the CPU stalls, dozes or is single stepped, or the end cycle is
+   reached, so the main loop sees all of these exactly when it would have
+   done.
+
+   If anything needs to see each instruction, just one is run.
+
+   @param[in] end_cycles  Cycle at which to stop, or negative for no limit
+
+   @return  Non-zero if a breakpoint is hit, zero otherwise.                  */
+/*---------------------------------------------------------------------------*/
+int
+cpu_quantum (long long int  end_cycles)
 {
+  long long int  insn_end = runtime.cpu.instructions + config.sim.quantum;
+  int            single   = insn_observed ();
+
+  do
+    {
+      if (!single)
+	{
+	  skip_idle_loop ((end_cycles < 0) ? -1 :
+			  end_cycles - runtime.sim.cycles);
+	}
+
+#if BLOCK_EXECUTION
+      if (single || !exec_block ())
 #endif
-  except_handle (EXCEPT_ILLEGAL, cpu_state.iqueue.insn_addr);
+	{
+	  runtime.sim.mem_cycles = 0;
 
-}	/* l_invalid() */
+	  if (cpu_clock ())
+	    {
+	      return  1;
+	    }
+
+	  runtime.sim.cycles        += runtime.sim.mem_cycles;
+	  scheduler.job_queue->time -= runtime.sim.mem_cycles;
+	  runtime.sim.mem_cycles     = 0;
+	}
+    }
+  while (!single && (runtime.cpu.instructions < insn_end) &&
+	 (scheduler.job_queue->time > 0) &&
+	 (0 == (runtime.sim.ext_int_set | runtime.sim.ext_int_clr)) &&
+	 !runtime.cpu.stalled && !cpu_dozing () &&
+	 !(cpu_state.sprs[SPR_DMR1] & SPR_DMR1_ST) &&
+	 ((end_cycles < 0) || (runtime.sim.cycles < end_cycles)));
+
+  return  0;
+
+}	/* cpu_quantum() */
 
 
 /*---------------------------------------------------------------------------*/
@@ -978,9 +1390,21 @@ void
 exec_main ()
 {
   long long time_start;
+  long long smp_left;
 
   while (1)
     {
+      /* With several cores, each only runs to the end of its turn */
+      smp_left = -1;
+
+      if (config.cpu.cores > 1)
+	{
+	  smp_left = (smp_switch_cycles > runtime.sim.cycles) ?
+	    smp_switch_cycles - runtime.sim.cycles : 0;
+	}
+
+      skip_idle_loop (smp_left);
+
       time_start = runtime.sim.cycles;
       if (config.debug.enabled)
 	{
@@ -1009,11 +1433,49 @@ exec_main ()
          performed inbetween. */
       runtime.sim.mem_cycles = 0;
 
-      if (!config.pm.enabled ||
-	  !(config.pm.enabled &
-	    (cpu_state.sprs[SPR_PMR] & (SPR_PMR_DME | SPR_PMR_SME))))
+      if (cpu_dozing ())
 	{
-	  if (cpu_clock ())
+	  /* Nothing happens until the next scheduled job, which may be the
+	     interrupt to wake us up. */
+	  runtime.sim.mem_cycles = scheduler.job_queue->time;
+
+	  if ((smp_left >= 0) && (runtime.sim.mem_cycles > smp_left))
+	    {
+	      runtime.sim.mem_cycles = (smp_left > 0) ? smp_left : 1;
+	    }
+	}
+      else
+	{
+	  if (config.sim.quantum > 0)
+	    {
+	      /* The batch does its own cycle accounting */
+	      if (cpu_quantum ((smp_left < 0) ? -1 : smp_switch_cycles))
+		{
+		  handle_sim_command ();
+		}
+
+	      time_start = runtime.sim.cycles;
+	    }
+#if BLOCK_EXECUTION
+	  /* A whole block does its own cycle accounting, and is only run when
+	     there is no tracing, VAPI or debug work to do after it. */
+	  else if (exec_block ())
+	    {
+	      if (scheduler.job_queue->time <= 0)
+		{
+		  do_scheduler ();
+		}
+
+	      if ((config.cpu.cores > 1) &&
+		  (runtime.sim.cycles >= smp_switch_cycles))
+		{
+		  smp_next_core ();
+		}
+
+	      continue;
+	    }
+#endif
+	  else if (cpu_clock ())
 	    {
 	      /* A breakpoint has been hit, drop to interactive mode */
 	      handle_sim_command ();
@@ -1051,6 +1513,11 @@ exec_main ()
 	{
 	  do_scheduler ();
 	}
+
+      if ((config.cpu.cores > 1) && (runtime.sim.cycles >= smp_switch_cycles))
+	{
+	  smp_next_core ();
+	}
     }
 }	/* exec_main() */
 
@@ -1122,151 +1589,1065 @@ float_set_flags ()
   
 }
 
-#if COMPLEX_EXECUTION
 
-/* Include generated/built in decode_execute function */
-#include "execgen.c"
+/*! Single precision operations with a host FPU fast path */
+enum float_op
+{
+  FLOAT_ADD,
+  FLOAT_SUB,
+  FLOAT_MUL,
+  FLOAT_DIV
+};
+
+/*! Single precision comparisons with a host FPU fast path */
+enum float_cmp
+{
+  FLOAT_EQ,
+  FLOAT_NE,
+  FLOAT_GT,
+  FLOAT_GE,
+  FLOAT_LT,
+  FLOAT_LE
+};
+
+/*! The bits of a single precision value, seen as a host float */
+union float_bits
+{
+  float     fval;
+  uint32_t  hval;
+};
 
-#elif SIMPLE_EXECUTION
+/*! Is a single precision value a NaN? */
+#define FLOAT_IS_NAN(x)     (((x) & 0x7fffffff) > 0x7f800000)
 
+/*! Is a single precision value a NaN or denormal? */
+#define FLOAT_IS_ODD(x)     (FLOAT_IS_NAN (x) ||				\
+			     ((((x) & 0x7fffffff) - 1) < 0x007fffff))
 
 /*---------------------------------------------------------------------------*/
-/*!Evaluates source operand
+/*!Single precision arithmetic, on the host FPU where possible
 
-   Implementation specific.
+   With round to nearest, ordinary operands are worked on in host double
+   precision and rounded to single, with the inexact flag found exactly.
+   Results that are not normal numbers are left to softfloat, as are the
+   other rounding modes, so FPCSR is always exactly as softfloat would have
+   set it.
 
-   @param[in] op_no       The operand
-   @param[in] insn_index  Address of the instruction
-   @param[in] insn        The instruction
+   @param[in] op  The operation
+   @param[in] a   The first operand
+   @param[in] b   The second operand
 
-   @return  The value of the operand                                         */
+   @return  The result                                                       */
 /*---------------------------------------------------------------------------*/
 static uorreg_t
-eval_operand (int            op_no,
-	      unsigned long  insn_index,
-	      uint32_t       insn)
+float_arith (enum float_op  op,
+	     uorreg_t       a,
+	     uorreg_t       b)
 {
-  struct insn_op_struct *opd = or1ksim_op_start[insn_index];
-  uorreg_t               ret;
+  uorreg_t  res;
 
-  while (op_no)
+#if defined (FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+  if (((cpu_state.sprs[SPR_FPCSR] & SPR_FPCSR_RM) == FPCSR_RM_RN) &&
+      !FLOAT_IS_ODD (a) && !FLOAT_IS_ODD (b) &&
+      !((FLOAT_DIV == op) && (0 == (b & 0x7fffffff))))
     {
-      if (opd->type & OPTYPE_LAST)
+      union float_bits  fa = { .hval = a };
+      union float_bits  fb = { .hval = b };
+      union float_bits  fr;
+      double            da = fa.fval;
+      double            db = fb.fval;
+      double            dr;
+      int               inexact;
+
+      /* Double has more than twice the precision of single, so rounding the
+	 double result again gives the correctly rounded single result. */
+      switch (op)
 	{
-	  fprintf (stderr,
-		   "Instruction requested more operands than it has\n");
-	  exit (1);
+	case FLOAT_SUB: db = -db;	/* Fall through */
+	case FLOAT_ADD: dr = da + db; break;
+	case FLOAT_MUL: dr = da * db; break;
+	case FLOAT_DIV: dr = da / db; break;
+	default:        dr = 0.0;     break;
 	}
 
-      if ((opd->type & OPTYPE_OP) && !(opd->type & OPTYPE_DIS))
-	{
-	  op_no--;
-	}
+      fr.fval = (float) dr;
 
-      opd++;
-    }
+      /* Products of singles are exact in double, so exactness of the single
+	 result is checked by multiplying back. For sums the double rounding
+	 error is found exactly with Fast2Sum. */
+      switch (op)
+	{
+	case FLOAT_ADD:
+	case FLOAT_SUB:
+	  inexact = (fr.fval != dr) ||
+	    ((fabs (da) >= fabs (db)) ? (db != dr - da) : (da != dr - db));
+	  break;
 
-  if (opd->type & OPTYPE_DIS)
-    {
-      ret = eval_operand_val (insn, opd);
+	case FLOAT_MUL: inexact = ((double) fr.fval != da * db); break;
+	case FLOAT_DIV: inexact = ((double) fr.fval * db != da); break;
+	default:        inexact = 1;                             break;
+	}
 
-      while (!(opd->type & OPTYPE_OP))
+      /* Infinities, NaNs and anything near underflow go to softfloat, which
+	 knows the right NaN and when to flag overflow and underflow. */
+      if (((fr.hval & 0x7fffffff) > 0x00800000) &&
+	  ((fr.hval & 0x7fffffff) < 0x7f800000))
 	{
-	  opd++;
+	  float_exception_flags = inexact ? float_flag_inexact : 0;
+	  float_set_flags ();
+	  return  fr.hval;
+	}
+      else if ((0 == (fr.hval & 0x7fffffff)) && !inexact)
+	{
+	  /* Exact zero, e.g. x - x */
+	  float_exception_flags = 0;
+	  float_set_flags ();
+	  return  fr.hval;
 	}
-
-      opd++;
-      ret               += evalsim_reg (eval_operand_val (insn, opd));
-      cpu_state.insn_ea  = ret;
-
-      return  ret;
     }
+#endif
 
-  if (opd->type & OPTYPE_REG)
+  float_set_rm ();
+
+  switch (op)
     {
-      return  evalsim_reg (eval_operand_val (insn, opd));
+    case FLOAT_ADD: res = float32_add (a, b); break;
+    case FLOAT_SUB: res = float32_sub (a, b); break;
+    case FLOAT_MUL: res = float32_mul (a, b); break;
+    case FLOAT_DIV: res = float32_div (a, b); break;
+    default:        res = 0;                  break;
     }
 
-  return  eval_operand_val (insn, opd);
+  float_set_flags ();
+  return  res;
 
-}	/* eval_operand() */
+}	/* float_arith() */
 
 
 /*---------------------------------------------------------------------------*/
-/*!Set destination operand (register direct) with value.
+/*!Single precision comparison, on the host FPU where possible
 
-   Implementation specific.
+   Comparisons only set flags for NaNs, so any other operands are compared on
+   the host, whatever the rounding mode.
+
+   @param[in] cmp  The comparison
+   @param[in] a    The first operand
+   @param[in] b    The second operand
 
-   @param[in] op_no       The operand
-   @param[in] value       The value to set
-   @param[in] insn_index  Address of the instruction
-   @param[in] insn        The instruction                                    */
+   @return  Non-zero if the comparison is true                               */
 /*---------------------------------------------------------------------------*/
-static void
-set_operand (int            op_no,
-	     orreg_t        value,
-	     unsigned long  insn_index,
-	     uint32_t       insn)
+static int
+float_compare (enum float_cmp  cmp,
+	       uorreg_t        a,
+	       uorreg_t        b)
 {
-  struct insn_op_struct *opd = or1ksim_op_start[insn_index];
+  union float_bits  fa = { .hval = a };
+  union float_bits  fb = { .hval = b };
+  int               res;
 
-  while (op_no)
+  if (!FLOAT_IS_NAN (a) && !FLOAT_IS_NAN (b))
     {
-      if (opd->type & OPTYPE_LAST)
+      switch (cmp)
 	{
-	  fprintf (stderr,
-		   "Instruction requested more operands than it has\n");
-	  exit (1);
+	case FLOAT_EQ: res = fa.fval == fb.fval; break;
+	case FLOAT_NE: res = fa.fval != fb.fval; break;
+	case FLOAT_GT: res = fa.fval >  fb.fval; break;
+	case FLOAT_GE: res = fa.fval >= fb.fval; break;
+	case FLOAT_LT: res = fa.fval <  fb.fval; break;
+	case FLOAT_LE: res = fa.fval <= fb.fval; break;
+	default:       res = 0;                  break;
 	}
 
-      if ((opd->type & OPTYPE_OP) && !(opd->type & OPTYPE_DIS))
-	{
-	  op_no--;
-	}
+      float_exception_flags = 0;
+      float_set_flags ();
+      return  res;
+    }
 
-      opd++;
+  float_set_rm ();
+
+  switch (cmp)
+    {
+    case FLOAT_EQ: res =  float32_eq (a, b); break;
+    case FLOAT_NE: res = !float32_eq (a, b); break;
+    case FLOAT_GT: res = !float32_le (a, b); break;
+    case FLOAT_GE: res = !float32_lt (a, b); break;
+    case FLOAT_LT: res =  float32_lt (a, b); break;
+    case FLOAT_LE: res =  float32_le (a, b); break;
+    default:       res = 0;                  break;
     }
 
-  if (!(opd->type & OPTYPE_REG))
+  /* Apart from l.sfne, NaNs compare false */
+  if ((FLOAT_NE != cmp) && (FLOAT_EQ != cmp) &&
+      (float32_is_nan (a) || float32_is_nan (b)))
     {
-      fprintf (stderr, "Trying to set a non-register operand\n");
-      exit (1);
+      res = 0;
     }
 
-  setsim_reg (eval_operand_val (insn, opd), value);
+  float_set_flags ();
+  return  res;
 
-}	/* set_operand() */
+}	/* float_compare() */
+
+#if COMPLEX_EXECUTION
+
+/* Include generated/built in decode_execute function */
+#include "execgen.c"
 
 
 /*---------------------------------------------------------------------------*/
-/*!Simple and rather slow decoding function
+/*!Invalidate any decoded instruction cache entry for an address
 
-   Based on built automata.
+   The generated decoder extracts operands inline, so there is no decoded
+   instruction cache to maintain.
 
-   @param[in] current  The current instruction to execute                    */
+   @param[in] addr  The physical address written                             */
 /*---------------------------------------------------------------------------*/
-static void
-decode_execute (struct iqueue_entry *current)
+void
+decode_cache_invalidate (oraddr_t  addr)
 {
-  int insn_index;
+}	/* decode_cache_invalidate() */
 
-  current->insn_index = insn_index = or1ksim_insn_decode (current->insn);
 
-  if (insn_index < 0)
-    {
-      l_invalid (current);
-    }
-  else
+/*---------------------------------------------------------------------------*/
+/*!Empty the decoded instruction cache
+
+   Nothing to do for the generated decoder.                                  */
+/*---------------------------------------------------------------------------*/
+void
+decode_cache_flush ()
+{
+}	/* decode_cache_flush() */
+
+#elif SIMPLE_EXECUTION || BLOCK_EXECUTION
+
+
+/*---------------------------------------------------------------------------*/
+/*!Evaluates a predecoded source operand
+
+   Implementation specific.
+
+   @param[in] op  The predecoded operand
+
+   @return  The value of the operand                                         */
+/*---------------------------------------------------------------------------*/
+static uorreg_t
+eval_operand (struct decoded_op *op)
+{
+  uorreg_t  ret;
+
+  switch (op->type)
     {
-      or1ksim_or32_opcodes[insn_index].exec (current);
+    case DOP_IMM:
+      return  op->imm;
+
+    case DOP_REG:
+      return  evalsim_reg (op->reg);
+
+    case DOP_DIS:
+      ret               = op->imm + evalsim_reg (op->reg);
+      cpu_state.insn_ea = ret;
+      return  ret;
+
+    default:
+      fprintf (stderr, "Instruction requested more operands than it has\n");
+      exit (1);
     }
+}	/* eval_operand() */
 
-  if (do_stats)
-    analysis (&cpu_state.iqueue);
-}
 
-#include "insnset.c"
+/*---------------------------------------------------------------------------*/
+/*!Set a predecoded destination operand (register direct) with value.
+
+   Implementation specific.
+
+   @param[in] op     The predecoded operand
+   @param[in] value  The value to set                                        */
+/*---------------------------------------------------------------------------*/
+static void
+set_operand (struct decoded_op *op,
+	     orreg_t            value)
+{
+  if (DOP_REG != op->type)
+    {
+      fprintf (stderr, "Trying to set a non-register operand\n");
+      exit (1);
+    }
+
+  setsim_reg (op->reg, value);
+
+}	/* set_operand() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Decode an instruction into a decoded instruction cache entry
+
+   Runs the decode automaton once and extracts all the operands, so that
+   later executions of the same instruction need do neither.
+
+   @param[out] d     The cache entry to fill in
+   @param[in]  addr  The physical address of the instruction
+   @param[in]  insn  The instruction                                         */
+/*---------------------------------------------------------------------------*/
+static void
+predecode (struct decoded_insn *d,
+	   oraddr_t             addr,
+	   uint32_t             insn)
+{
+  struct insn_op_struct *opd;
+  int                    op_no;
+
+  d->addr       = addr;
+  d->insn       = insn;
+  d->insn_index = or1ksim_insn_decode (insn);
+
+  for (op_no = 0; op_no < MAX_DECODED_OPS; op_no++)
+    {
+      d->op[op_no].type = DOP_NONE;
+    }
+
+  if (d->insn_index < 0)
+    {
+      d->exec = l_invalid;
+      return;
+    }
+
+  d->exec = or1ksim_or32_opcodes[d->insn_index].exec;
+  opd     = or1ksim_op_start[d->insn_index];
+
+  for (op_no = 0; op_no < MAX_DECODED_OPS; op_no++)
+    {
+      struct decoded_op *op = &(d->op[op_no]);
+
+      if (opd->type & OPTYPE_DIS)
+	{
+	  /* Displacement and base register are treated as one operand */
+	  op->type = DOP_DIS;
+	  op->imm  = eval_operand_val (insn, opd);
+
+	  while (!(opd->type & OPTYPE_OP))
+	    {
+	      opd++;
+	    }
+
+	  opd++;
+	  op->reg = eval_operand_val (insn, opd);
+	}
+      else if (opd->type & OPTYPE_REG)
+	{
+	  op->type = DOP_REG;
+	  op->reg  = eval_operand_val (insn, opd);
+	}
+      else
+	{
+	  op->type = DOP_IMM;
+	  op->imm  = eval_operand_val (insn, opd);
+	}
+
+      while (!(opd->type & OPTYPE_OP))
+	{
+	  opd++;
+	}
+
+      if (opd->type & OPTYPE_LAST)
+	{
+	  break;
+	}
+
+      opd++;
+    }
+}	/* predecode() */
+
+
+#if BLOCK_EXECUTION
+
+/*---------------------------------------------------------------------------*/
+/*!Discard a translated block
+
+   The block may be the one being executed (when it stores to its own code),
+   so it is only marked invalid and put on a list to be freed before the next
+   block is run. The caller must already have removed it from its hash chain.
+
+   @param[in] blk  The block to discard                                      */
+/*---------------------------------------------------------------------------*/
+static void
+discard_block (struct block *blk)
+{
+  blk->valid          = 0;
+  blk->next           = dstate->dead_blocks;
+  dstate->dead_blocks = blk;
+  dstate->num_blocks--;
+
+}	/* discard_block() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Free all the blocks which have been discarded                             */
+/*---------------------------------------------------------------------------*/
+static void
+free_dead_blocks ()
+{
+  while (NULL != dstate->dead_blocks)
+    {
+      struct block *blk = dstate->dead_blocks;
+
+      dstate->dead_blocks = blk->next;
+      free (blk->insns);
+      free (blk);
+    }
+}	/* free_dead_blocks() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Discard all blocks containing an address
+
+   Blocks never cross a code page and are at most MAX_BLOCK_INSNS long, so
+   only a few possible start addresses need to be looked up.
+
+   @param[in] addr  The physical address written                             */
+/*---------------------------------------------------------------------------*/
+static void
+invalidate_blocks (oraddr_t  addr)
+{
+  oraddr_t  first = addr & ~(CODE_PAGE_SIZE - 1);
+  oraddr_t  start;
+
+  if ((addr & ~3) - first >= MAX_BLOCK_INSNS * 4)
+    {
+      first = (addr & ~3) - (MAX_BLOCK_INSNS - 1) * 4;
+    }
+
+  for (start = first; start <= addr; start += 4)
+    {
+      struct block **bp =
+	&dstate->block_hash[(start >> 2) & BLOCK_HASH_MASK];
+
+      while (NULL != *bp)
+	{
+	  struct block *blk = *bp;
+
+	  if ((blk->addr == start) && (addr < start + blk->ninsns * 4))
+	    {
+	      *bp = blk->next;
+	      discard_block (blk);
+	    }
+	  else
+	    {
+	      bp = &(blk->next);
+	    }
+	}
+    }
+}	/* invalidate_blocks() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Does an instruction end a basic block?
+
+   Jumps and branches end a block (after their delay slot), as do
+   instructions which can change the SR, the MMUs or caches, or which always
+   take an exception. Simulator service l.nop instructions end a block, since
+   they may turn tracing on.
+
+   @param[in] d  The predecoded instruction
+
+   @return  Non-zero if the block should end                                 */
+/*---------------------------------------------------------------------------*/
+static int
+ends_block (struct decoded_insn *d)
+{
+  if (d->insn_index < 0)
+    {
+      return  1;
+    }
+
+  if ((or1ksim_or32_opcodes[d->insn_index].flags & OR32_IF_DELAY) ||
+      (it_exception == or1ksim_or32_opcodes[d->insn_index].func_unit))
+    {
+      return  1;
+    }
+
+  return  (l_mtspr == d->exec) || ((l_nop == d->exec) && (0 != d->op[0].imm));
+
+}	/* ends_block() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Find the pairs of instructions in a block to run as one
+
+   Only the first instruction of a pair is marked. Pairs do not overlap, and
+   since the delay slot of a jump or branch is always the last instruction of
+   a block, it is never the first of a pair.
+
+   @param[in] insns  The predecoded instructions of the block
+   @param[in] n      The number of instructions                              */
+/*---------------------------------------------------------------------------*/
+static void
+find_fused_pairs (struct decoded_insn *insns,
+		  int                  n)
+{
+  int  i;
+
+  for (i = 0; i < n; i++)
+    {
+      struct decoded_insn *d = &insns[i];
+
+      d->fuse = FUSE_NONE;
+
+      if ((i + 1 >= n) || (d->insn_index < 0) || (d[1].insn_index < 0))
+	{
+	  continue;
+	}
+
+      /* l.ori shares the handler of l.or */
+      if ((l_movhi == d->exec) && (l_or == d[1].exec) &&
+	  (DOP_IMM == d[1].op[2].type) && (d[1].op[1].reg == d->op[0].reg))
+	{
+	  d->fuse = FUSE_MOVHI_ORI;
+	}
+
+      if (FUSE_NONE != d->fuse)
+	{
+	  i++;
+	  d[1].fuse = FUSE_NONE;
+	}
+    }
+}	/* find_fused_pairs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Translate a basic block
+
+   Instructions are read directly (with no side effects) from the memory area
+   holding the start address and predecoded. The block ends at a jump or
+   branch and its delay slot, at an instruction for which ends_block() is
+   true, at the end of the code page or memory area, or at MAX_BLOCK_INSNS.
+
+   @param[in] paddr  Physical address of the first instruction
+
+   @return  The new block, or NULL if there is no memory at the address      */
+/*---------------------------------------------------------------------------*/
+static struct block *
+translate_block (oraddr_t  paddr)
+{
+  static struct decoded_insn  insns[MAX_BLOCK_INSNS];
+
+  struct dev_memarea *mem;
+  struct block       *blk;
+  oraddr_t            addr;
+  int                 n;
+  int                 in_delay_slot = 0;
+  int                 breakpoint    = 0;
+
+  if (NULL == (mem = verify_memoryarea (paddr)))
+    {
+      return  NULL;
+    }
+
+  if (dstate->num_blocks >= MAX_BLOCKS)
+    {
+      decode_cache_flush ();
+    }
+
+  for (n = 0, addr = paddr;
+       (n < MAX_BLOCK_INSNS) &&
+       ((addr >> CODE_PAGE_BITS) == (paddr >> CODE_PAGE_BITS));
+       addr += 4)
+    {
+      if (verify_memoryarea (addr) != mem)
+	{
+	  break;
+	}
+
+      predecode (&insns[n], addr,
+		 mem->direct_ops.readfunc32 (addr & mem->size_mask,
+					     mem->direct_ops.read_dat32));
+      breakpoint |= has_breakpoint (addr);
+      n++;
+
+      if (in_delay_slot)
+	{
+	  break;
+	}
+
+      if (ends_block (&insns[n - 1]))
+	{
+	  int  index = insns[n - 1].insn_index;
+
+	  if ((index < 0) ||
+	      !(or1ksim_or32_opcodes[index].flags & OR32_IF_DELAY) ||
+	      (cpu_state.sprs[SPR_CPUCFGR] & SPR_CPUCFGR_ND))
+	    {
+	      break;
+	    }
+
+	  in_delay_slot = 1;
+	}
+    }
+
+  blk = malloc (sizeof (struct block));
+
+  if (NULL != blk)
+    {
+      blk->insns = malloc (n * sizeof (struct decoded_insn));
+    }
+
+  if ((NULL == blk) || (NULL == blk->insns))
+    {
+      fprintf (stderr, "Out-of-memory\n");
+      exit (1);
+    }
+
+  find_fused_pairs (insns, n);
+  memcpy (blk->insns, insns, n * sizeof (struct decoded_insn));
+  blk->addr   = paddr;
+  blk->ninsns = n;
+  blk->valid  = 1;
+  blk->mem    = mem;
+  blk->breakpoint = breakpoint;
+#if HAVE_JIT
+  blk->execs  = 0;
+  blk->code   = NULL;
+#endif
+  blk->next   = dstate->block_hash[(paddr >> 2) & BLOCK_HASH_MASK];
+
+  dstate->block_hash[(paddr >> 2) & BLOCK_HASH_MASK] = blk;
+  dstate->num_blocks++;
+
+  dstate->code_pages[paddr >> (CODE_PAGE_BITS + 3)] |=
+    1 << ((paddr >> CODE_PAGE_BITS) & 7);
+
+  return  blk;
+
+}	/* translate_block() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Execute one instruction of a basic block
+
+   The instruction fetch is still accounted for (IMMU and memory delay), but
+   memory is not read.
+
+   @param[in] blk      The block being executed
+   @param[in] d        The instruction to execute
+   @param[in] immu_on  Non-zero if the IMMU is enabled
+
+   @return  Non-zero if the block should be left after this instruction     */
+/*---------------------------------------------------------------------------*/
+static int
+exec_block_insn (struct block        *blk,
+		 struct decoded_insn *d,
+		 int                  immu_on)
+{
+  except_pending         = 0;
+  next_delay_insn        = 0;
+  runtime.sim.mem_cycles = 0;
+
+  /* The fetch, as eval_insn() would do it */
+  if (immu_on)
+    {
+      immu_translate (cpu_state.pc);
+    }
+
+  if (!except_pending)
+    {
+      runtime.sim.mem_cycles += blk->mem->ops.delayr;
+      runtime.cpu.instructions++;
+
+      cpu_state.iqueue.insn_addr  = cpu_state.pc;
+      cpu_state.iqueue.insn       = d->insn;
+      cpu_state.iqueue.insn_index = d->insn_index;
+      cur_decoded                 = d;
+      d->exec (&cpu_state.iqueue);
+    }
+
+  update_pc ();
+
+  runtime.sim.cycles        += runtime.sim.mem_cycles;
+  scheduler.job_queue->time -= runtime.sim.mem_cycles;
+
+  return  except_pending || !blk->valid ||
+    (scheduler.job_queue->time <= 0) ||
+    (cpu_state.pc != cpu_state.iqueue.insn_addr + 4);
+
+}	/* exec_block_insn() */
+
+
+
+/*---------------------------------------------------------------------------*/
+/*!Execute a fused pair of instructions of a basic block
+
+   l.movhi with l.ori is done without calling either handler: the first
+   writes the high half of its result directly, and the second ORs in the low
+   half. Each instruction is still fetched, counted and costed separately,
+   and the pair is split wherever exec_block_insn() would leave the block
+   after the first (an exception, the block being discarded or a scheduled
+   job falling due), so the result is exactly that of running them one at a
+   time.
+
+   @param[in] blk      The block being executed
+   @param[in] d        The first instruction of the pair
+   @param[in] immu_on  Non-zero if the IMMU is enabled
+
+   @return  Non-zero if the block should be left after this pair             */
+/*---------------------------------------------------------------------------*/
+static int
+exec_block_pair (struct block        *blk,
+		 struct decoded_insn *d,
+		 int                  immu_on)
+{
+  oraddr_t  addr = cpu_state.pc;
+
+  except_pending         = 0;
+  next_delay_insn        = 0;
+  runtime.sim.mem_cycles = 0;
+
+  if (immu_on)
+    {
+      immu_translate (addr);
+    }
+
+  if (!except_pending)
+    {
+      runtime.sim.mem_cycles += blk->mem->ops.delayr;
+      runtime.cpu.instructions++;
+
+      cpu_state.iqueue.insn_addr  = addr;
+      cpu_state.iqueue.insn       = d->insn;
+      cpu_state.iqueue.insn_index = d->insn_index;
+      cur_decoded                 = d;
+
+      setsim_reg (d->op[0].reg, d->op[1].imm << 16);
+    }
+
+  update_pc ();
+
+  runtime.sim.cycles        += runtime.sim.mem_cycles;
+  scheduler.job_queue->time -= runtime.sim.mem_cycles;
+
+  if (except_pending || !blk->valid || (scheduler.job_queue->time <= 0) ||
+      (cpu_state.pc != addr + 4))
+    {
+      return  1;
+    }
+
+  /* The second instruction */
+  d++;
+  next_delay_insn        = 0;
+  runtime.sim.mem_cycles = 0;
+
+  if (immu_on)
+    {
+      immu_translate (addr + 4);
+    }
+
+  if (!except_pending)
+    {
+      runtime.sim.mem_cycles += blk->mem->ops.delayr;
+      runtime.cpu.instructions++;
+
+      cpu_state.iqueue.insn_addr  = addr + 4;
+      cpu_state.iqueue.insn       = d->insn;
+      cpu_state.iqueue.insn_index = d->insn_index;
+      cur_decoded                 = d;
+
+      setsim_reg (d->op[0].reg, evalsim_reg (d->op[1].reg) | d->op[2].imm);
+    }
+
+  update_pc ();
+
+  runtime.sim.cycles        += runtime.sim.mem_cycles;
+  scheduler.job_queue->time -= runtime.sim.mem_cycles;
+
+  return  except_pending || !blk->valid ||
+    (scheduler.job_queue->time <= 0) || (cpu_state.pc != addr + 8);
+
+}	/* exec_block_pair() */
+
+#if HAVE_JIT
+#include "jit-x86-64.c"
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+/*!Execute a basic block
+
+   The block for the current PC is looked up (and translated if necessary)
+   and its instructions run back to back through their predecoded handlers,
+   or as host code once the block is hot (if built with --enable-jit). The
+   main loop's per cycle checks are made once per block.
+
+   The block is left early after an exception, when the PC does not move on
+   to the next instruction, when a scheduled job is due, or when the block is
+   discarded because it wrote to its own code. So the scheduler runs at the
+   same cycle as it would when executing instruction by instruction.
+
+   Anything needing per instruction attention (tracing, statistics, debug
+   unit, profiling, PCU, VAPI, an active instruction cache model) is left to
+   cpu_clock(), as are blocks holding a breakpoint.
+
+   @return  Non-zero if a block was executed, zero if the caller should use
+            cpu_clock() instead.                                             */
+/*---------------------------------------------------------------------------*/
+static int
+exec_block ()
+{
+  struct block        *blk;
+  struct decoded_insn *d;
+  struct decoded_insn *end;
+  oraddr_t             paddr;
+  int                  immu_on;
+
+  if (insn_observed () ||
+      ((NULL != ic_state) && ic_state->enabled &&
+       (cpu_state.sprs[SPR_UPR] & SPR_UPR_ICP) &&
+       (cpu_state.sprs[SPR_SR] & SPR_SR_ICE)))
+    {
+      return  0;
+    }
+
+  free_dead_blocks ();
+
+  immu_on = (cpu_state.sprs[SPR_SR] & SPR_SR_IME) &&
+            (cpu_state.sprs[SPR_UPR] & SPR_UPR_IMP);
+  paddr   = peek_into_itlb (cpu_state.pc);
+
+  /* Misses, faults and odd cases are dealt with by cpu_clock() */
+  if ((immu_on && (0 == paddr)) || (paddr & 3))
+    {
+      return  0;
+    }
+
+  for (blk = dstate->block_hash[(paddr >> 2) & BLOCK_HASH_MASK];
+       (NULL != blk) && (blk->addr != paddr);
+       blk = blk->next)
+    ;
+
+  if ((NULL == blk) && (NULL == (blk = translate_block (paddr))))
+    {
+      return  0;
+    }
+
+  /* Blocks are discarded whenever breakpoints change. One holding a
+     breakpoint is left to cpu_clock(), which checks each fetch. Any other
+     block passes over a breakpoint just hit. */
+  if (blk->breakpoint)
+    {
+      return  0;
+    }
+
+  break_just_hit = 0;
+
+  d   = blk->insns;
+  end = blk->insns + blk->ninsns;
+
+#if HAVE_JIT
+  /* Host code runs as much of the block as it can, and says where to carry
+     on from. */
+  d += jit_exec_block (blk, immu_on);
+#endif
+
+  for (; d < end; d++)
+    {
+      if (FUSE_NONE != d->fuse)
+	{
+	  if (exec_block_pair (blk, d++, immu_on))
+	    {
+	      break;
+	    }
+	}
+      else if (exec_block_insn (blk, d, immu_on))
+	{
+	  break;
+	}
+    }
+
+  runtime.sim.mem_cycles = 0;
+  except_pending         = 0;
+
+  return  1;
+
+}	/* exec_block() */
+
+#endif	/* BLOCK_EXECUTION */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Invalidate any decoded instruction cache entry for an address
+
+   Called whenever simulated memory is written, so self modifying code,
+   program loading, debugger writes and DMA are all seen by the decoder.
+
+   @param[in] addr  The physical address written                             */
+/*---------------------------------------------------------------------------*/
+void
+decode_cache_invalidate (oraddr_t  addr)
+{
+  struct decoded_insn *d;
+
+  if (NULL == dstate)
+    {
+      return;			/* Nothing decoded before the first reset */
+    }
+
+  d = &dstate->cache[(addr >> 2) & DECODE_CACHE_MASK];
+
+  if (d->addr == (addr & ~3))
+    {
+      d->addr = DECODE_CACHE_EMPTY;
+    }
+
+#if BLOCK_EXECUTION
+  if (dstate->code_pages[addr >> (CODE_PAGE_BITS + 3)] &
+      (1 << ((addr >> CODE_PAGE_BITS) & 7)))
+    {
+      invalidate_blocks (addr);
+    }
+#endif
+}	/* decode_cache_invalidate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Empty the decoded instruction cache
+
+   With basic block execution, all the translated blocks are discarded as
+   well. The first call for a machine allocates its decode state.            */
+/*---------------------------------------------------------------------------*/
+void
+decode_cache_flush ()
+{
+  int  i;
+
+  if (NULL == dstate)
+    {
+      if (NULL == (dstate = calloc (1, sizeof (*dstate))))
+	{
+	  fprintf (stderr, "Out-of-memory for decoded instructions\n");
+	  exit (1);
+	}
+    }
+
+  for (i = 0; i < DECODE_CACHE_SIZE; i++)
+    {
+      dstate->cache[i].addr = DECODE_CACHE_EMPTY;
+    }
+
+#if BLOCK_EXECUTION
+  for (i = 0; i < BLOCK_HASH_SIZE; i++)
+    {
+      while (NULL != dstate->block_hash[i])
+	{
+	  struct block *blk = dstate->block_hash[i];
+
+	  dstate->block_hash[i] = blk->next;
+	  discard_block (blk);
+	}
+    }
+
+  memset (dstate->code_pages, 0, sizeof (dstate->code_pages));
+#endif
+}	/* decode_cache_flush() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Decode and execute an instruction via the decoded instruction cache
+
+   The cache is indexed by physical address, so it survives changes to the
+   MMU mapping. The fetched word is checked as well, since the instruction
+   cache model may still be returning an old copy of a line that has since
+   been written.
+
+   @param[in] current  The current instruction to execute                    */
+/*---------------------------------------------------------------------------*/
+static void
+decode_execute (struct iqueue_entry *current)
+{
+  struct decoded_insn *d;
+
+  d = &dstate->cache[(insn_paddr >> 2) & DECODE_CACHE_MASK];
+
+  if ((d->addr != insn_paddr) || (d->insn != current->insn))
+    {
+      predecode (d, insn_paddr, current->insn);
+    }
+
+  current->insn_index = d->insn_index;
+  cur_decoded         = d;
+  d->exec (current);
+
+  if (do_stats)
+    analysis (&cpu_state.iqueue);
+}
+
+#include "insnset.c"
 
 #else
-# error "Must define SIMPLE_EXECUTION, COMPLEX_EXECUTION"
+# error "Must define SIMPLE_EXECUTION, COMPLEX_EXECUTION or BLOCK_EXECUTION"
 #endif
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the CPU state as simulator state
+
+   The registers, store buffer, execution history and idle loop detection
+   belong to each core. Statistics and the decoded instructions are shared. */
+/*---------------------------------------------------------------------------*/
+void
+reg_exec_state ()
+{
+  reg_core_state (&cpu_state, sizeof (cpu_state));
+  reg_core_state (&pcnext, sizeof (pcnext));
+  reg_sim_state (&sbuf_wait_cyc, sizeof (sbuf_wait_cyc));
+  reg_sim_state (&sbuf_total_cyc, sizeof (sbuf_total_cyc));
+  reg_sim_state (&do_stats, sizeof (do_stats));
+  reg_core_state (&hist_exec_tail, sizeof (hist_exec_tail));
+  reg_sim_state (&multissue, sizeof (multissue));
+  reg_sim_state (&issued_per_cycle, sizeof (issued_per_cycle));
+  reg_core_state (&sbuf_head, sizeof (sbuf_head));
+  reg_core_state (&sbuf_tail, sizeof (sbuf_tail));
+  reg_core_state (&sbuf_count, sizeof (sbuf_count));
+  reg_core_state (&sbuf_buf, sizeof (sbuf_buf));
+  reg_core_state (&sbuf_prev_cycles, sizeof (sbuf_prev_cycles));
+  reg_core_state (&breakpoint, sizeof (breakpoint));
+  reg_core_state (&break_just_hit, sizeof (break_just_hit));
+  reg_core_state (&next_delay_insn, sizeof (next_delay_insn));
+  reg_core_state (&insn_paddr, sizeof (insn_paddr));
+  reg_sim_state (&plain_handlers, sizeof (plain_handlers));
+  reg_core_state (&idle_pc, sizeof (idle_pc));
+  reg_core_state (&idle_cycles, sizeof (idle_cycles));
+  reg_core_state (&idle_insns, sizeof (idle_insns));
+  reg_core_state (&idle_trip, sizeof (idle_trip));
+  reg_core_state (&idle_trips, sizeof (idle_trips));
+  reg_core_state (&idle_itlb_hits, sizeof (idle_itlb_hits));
+  reg_core_state (&idle_ic_hits, sizeof (idle_ic_hits));
+  reg_core_state (&idle_trip_itlb_hits, sizeof (idle_trip_itlb_hits));
+  reg_core_state (&idle_trip_ic_hits, sizeof (idle_trip_ic_hits));
+  reg_core_state (&float_rounding_mode, sizeof (float_rounding_mode));
+  reg_core_state (&float_exception_flags, sizeof (float_exception_flags));
+  reg_core_state (&float_detect_tininess, sizeof (float_detect_tininess));
+#if SIMPLE_EXECUTION || BLOCK_EXECUTION
+  reg_sim_state (&dstate, sizeof (dstate));
+#endif
+
+}	/* reg_exec_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the CPU's state for checkpoints
+
+   The registers and SPRs (and so the TLBs, PIC and tick timer registers),
+   together with the store buffer and softfloat state.                       */
+/*---------------------------------------------------------------------------*/
+void
+reg_exec_checkpoint ()
+{
+  REG_CHECKPOINT (&cpu_state, sizeof (cpu_state));
+  REG_CHECKPOINT (&pcnext, sizeof (pcnext));
+  REG_CHECKPOINT (&sbuf_head, sizeof (sbuf_head));
+  REG_CHECKPOINT (&sbuf_tail, sizeof (sbuf_tail));
+  REG_CHECKPOINT (&sbuf_count, sizeof (sbuf_count));
+  REG_CHECKPOINT (&sbuf_buf, sizeof (sbuf_buf));
+  REG_CHECKPOINT (&sbuf_prev_cycles, sizeof (sbuf_prev_cycles));
+  REG_CHECKPOINT (&float_rounding_mode, sizeof (float_rounding_mode));
+  REG_CHECKPOINT (&float_exception_flags, sizeof (float_exception_flags));
+  REG_CHECKPOINT (&float_detect_tininess, sizeof (float_detect_tininess));
+
+}	/* reg_exec_checkpoint() */
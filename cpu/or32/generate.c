@@ -1,4 +1,4 @@
-/* generate.c -- generates file execgen.c from instruction set
+/* generate.c -- generates files execgen.c and decodegen.c from instruction set
 
    Copyright (C) 1999 Damjan Lampret, lampret@opencores.org
    Copyright (C) 2005 Gyrgy `nog' Jeney, nog@sdf.lonestar.org
@@ -45,6 +45,24 @@ static int write_to_reg;
 
 static int out_lines = 0;
 
+/* Whether we are generating the plain decoder, for a simulation with no
+   statistics, profiling, PCU, debug unit, caches or store buffer (see
+   exec_select_handlers in execute.c) */
+static int plain = 0;
+
+/* What the plain decoder uses in place of each identifier in the instruction
+   bodies */
+static const char *plain_subst[][2] = {
+  { "eval_mem32",         "eval_mem32_plain" },
+  { "eval_mem16",         "eval_mem16_plain" },
+  { "eval_mem8",          "eval_mem8_plain" },
+  { "set_mem32",          "set_mem32_plain" },
+  { "set_mem16",          "set_mem16_plain" },
+  { "set_mem8",           "set_mem8_plain" },
+  { "config.cpu.sbuf_len", "0" },
+  { NULL,                 NULL }
+};
+
 static int shift_fprintf(int level, FILE *f, const char *fmt, ...)
 {
   va_list ap;
@@ -61,6 +79,41 @@ static int shift_fprintf(int level, FILE *f, const char *fmt, ...)
   return i + (level * 2);
 }
 
+/* Copies a line of an instruction body, making the plain decoder's
+   substitutions if need be */
+static void output_line (FILE *fo, int level, const char *line)
+{
+  char buf[20000], *d = buf;
+  const char *str = line;
+  int i;
+
+  if (!plain) {
+    shift_fprintf (level, fo, "%s", line);
+    return;
+  }
+
+  while (*str) {
+    for (i = 0; plain_subst[i][0]; i++) {
+      size_t len = strlen (plain_subst[i][0]);
+
+      if ((str == line || !(isalnum ((int)*(str - 1)) || *(str - 1) == '_'))
+          && strncmp (str, plain_subst[i][0], len) == 0
+          && !(isalnum ((int)str[len]) || str[len] == '_'))
+        break;
+    }
+
+    if (plain_subst[i][0]) {
+      strcpy (d, plain_subst[i][1]);
+      d += strlen (plain_subst[i][1]);
+      str += strlen (plain_subst[i][0]);
+    } else
+      *d++ = *str++;
+  }
+  *d = 0;
+
+  shift_fprintf (level, fo, "%s", buf);
+}
+
 /* Generates a execute sequence for one instruction */
 int output_function (FILE *fo, const char *func_name, int level)
 {
@@ -122,7 +175,7 @@ int output_function (FILE *fo, const char *func_name, int level)
             if (*str == '{') olevel++;
             else if (*str == '}') olevel--;
           }
-          shift_fprintf (level, fo, "%s", line);
+          output_line (fo, level, line);
         } while (olevel);
 	fclose(fi);
         /*shift_fprintf (level, fo, "#line %i \"%s\"\n", out_lines, out_file);*/
@@ -270,16 +323,19 @@ static int output_call (FILE *fo, int index, int level)
 
   fprintf (fo, "\n");
 
-  shift_fprintf (level++, fo, "if (do_stats) {\n");
+  /* The plain decoder is never used with statistics */
+  if (!plain) {
+    shift_fprintf (level++, fo, "if (do_stats) {\n");
 
-  if (dis_op >= 0)
-    shift_fprintf (level, fo, "cpu_state.insn_ea = %c;\n", 'a' + dis_op);
+    if (dis_op >= 0)
+      shift_fprintf (level, fo, "cpu_state.insn_ea = %c;\n", 'a' + dis_op);
 
-  shift_fprintf (level, fo, "current->insn_index = %i;   /* \"%s\" */\n", index,
-                 or1ksim_insn_name (index));
+    shift_fprintf (level, fo, "current->insn_index = %i;   /* \"%s\" */\n",
+                   index, or1ksim_insn_name (index));
 
-  shift_fprintf (level, fo, "analysis(current);\n");
-  shift_fprintf (--level, fo, "}\n");
+    shift_fprintf (level, fo, "analysis(current);\n");
+    shift_fprintf (--level, fo, "}\n");
+  }
 
   if (write_to_reg)
     shift_fprintf (level, fo, "cpu_state.reg[0] = 0; /* Repair in case we changed it */\n");
@@ -324,13 +380,21 @@ static int generate_header (FILE *fo)
   return 0;
 }
 
+/* Generates .c file FLOAT type */
+static int generate_types (FILE *fo)
+{
+  fprintf (fo, "typedef union {\n\tfloat fval;\n\tuint32_t hval;\n} FLOAT;\n\n");
+  out_lines +=4;
+  return 0;
+}
+
 /* Generates .c file decode function hedaer */
 static int generate_decode_function_header (FILE *fo)
 {
-  fprintf (fo, "typedef union {\n\tfloat fval;\n\tuint32_t hval;\n} FLOAT;\n\n");
-  fprintf (fo, "static void decode_execute (struct iqueue_entry *current)\n{\n");
+  fprintf (fo, "static void decode_execute%s (struct iqueue_entry *current)\n{\n",
+           plain ? "_plain" : "");
   fprintf (fo, "  uint32_t insn = current->insn;\n");
-  out_lines +=3;
+  out_lines +=2;
   return 0;
 }
 
@@ -355,7 +419,7 @@ static int generate_includes (FILE *fo)
 static int 
 generate_footer (FILE *fo)
 {
-  fprintf (fo, "}\n");
+  fprintf (fo, "}\n\n");
   return 0;
 }
 
@@ -427,16 +491,209 @@ generate_body (FILE *fo, unsigned long *a, unsigned long cur_mask, int level)
   return 0;
 }
       
+/* Are two instructions told apart by their fixed bits in the field of the
+   given width starting at bit lo? */
+static int distinct_in_field (int a, int b, int lo, int width)
+{
+  unsigned long field = ((1UL << width) - 1) << lo;
+  unsigned long both = or1ksim_ti[a].insn_mask & or1ksim_ti[b].insn_mask & field;
+
+  return ((or1ksim_ti[a].insn ^ or1ksim_ti[b].insn) & both) != 0;
+}
+
+/* Decodes an instruction with the tables being generated, just as
+   or1ksim_insn_decode in or32.c will */
+static int table_decode (struct insn_decode_primary *primary, int *secondary,
+                         unsigned long insn)
+{
+  struct insn_decode_primary *p = &primary[(insn >> 26) & 0x3f];
+  int i = secondary[p->base + ((insn >> p->shift) & p->mask)];
+
+  if (i >= 0 && (or1ksim_ti[i].insn_mask & insn) == or1ksim_ti[i].insn)
+    return i;
+  else
+    return -1;
+}
+
+/* Generates the two level decode tables.  The primary opcode selects an
+   entry in the primary table, which gives the narrowest field of the
+   instruction telling apart all the instructions with that opcode.  That
+   field indexes the secondary table, which holds the only instruction which
+   could match (or -1).  The tables are checked against the automaton for
+   every primary opcode and secondary field value. */
+static int generate_decode_tables (FILE *fo)
+{
+  struct insn_decode_primary primary[64];
+  int *secondary;
+  int num_secondary = 0;
+  int num_opcodes;
+  int cands[256];
+  int op, i, j;
+
+  for (num_opcodes = 0; or1ksim_or32_opcodes[num_opcodes].name[0];
+       num_opcodes++);
+
+  if (!(secondary = malloc (64 * 1024 * sizeof (int)))) {
+    fprintf (stderr, "Out-of-memory\n");
+    return 1;
+  }
+
+  for (op = 0; op < 64; op++) {
+    int ncands = 0;
+    int lo = 0, width = 0;
+    unsigned long v;
+
+    /* The instructions which may have this primary opcode */
+    for (i = 0; i < num_opcodes; i++)
+      if (((or1ksim_ti[i].insn ^ ((unsigned long)op << 26)) &
+           or1ksim_ti[i].insn_mask & 0xfc000000) == 0) {
+        if (ncands == 256) {
+          fprintf (stderr, "Too many instructions with opcode 0x%02x\n", op);
+          return 1;
+        }
+        cands[ncands++] = i;
+      }
+
+    /* The narrowest field telling them all apart */
+    if (ncands > 1) {
+      for (width = 1; width <= 26; width++) {
+        for (lo = 0; lo + width <= 26; lo++) {
+          int ok = 1;
+          for (i = 0; ok && i < ncands; i++)
+            for (j = i + 1; ok && j < ncands; j++)
+              ok = distinct_in_field (cands[i], cands[j], lo, width);
+          if (ok)
+            break;
+        }
+        if (lo + width <= 26)
+          break;
+      }
+      if (width > 16) {
+        fprintf (stderr, "Cannot tell apart instructions with opcode 0x%02x\n",
+                 op);
+        return 1;
+      }
+    }
+
+    primary[op].shift = lo;
+    primary[op].mask = (1UL << width) - 1;
+    primary[op].base = num_secondary;
+
+    for (v = 0; v <= primary[op].mask; v++) {
+      int match = -1;
+      unsigned long field = primary[op].mask << lo;
+
+      for (i = 0; i < ncands; i++)
+        if ((((v << lo) ^ or1ksim_ti[cands[i]].insn) &
+             or1ksim_ti[cands[i]].insn_mask & field) == 0)
+          match = cands[i];
+
+      if (num_secondary == 64 * 1024) {
+        fprintf (stderr, "Secondary decode table too large\n");
+        return 1;
+      }
+      secondary[num_secondary++] = match;
+    }
+  }
+
+  /* Check against the automaton */
+  for (op = 0; op < 64; op++) {
+    unsigned long v;
+
+    for (v = 0; v <= primary[op].mask; v++) {
+      unsigned long insn = ((unsigned long)op << 26) | (v << primary[op].shift);
+
+      if (table_decode (primary, secondary, insn) !=
+          or1ksim_insn_decode (insn)) {
+        fprintf (stderr, "Decode tables disagree with automaton for %08lx\n",
+                 insn);
+        return 1;
+      }
+    }
+  }
+
+  for (i = 0; i < num_opcodes; i++)
+    if (table_decode (primary, secondary, or1ksim_ti[i].insn) !=
+        or1ksim_insn_decode (or1ksim_ti[i].insn)) {
+      fprintf (stderr, "Decode tables disagree with automaton for %s\n",
+               or1ksim_or32_opcodes[i].name);
+      return 1;
+    }
+
+  fprintf (fo, "/* Primary decode table, indexed by opcode */\n");
+  fprintf (fo, "static const struct insn_decode_primary decode_primary[64] = {\n");
+  for (op = 0; op < 64; op++)
+    fprintf (fo, "  { %2u, 0x%04x, %5u },\t/* 0x%02x */\n", primary[op].shift,
+             primary[op].mask, primary[op].base, op);
+  fprintf (fo, "};\n\n");
+
+  fprintf (fo, "/* Secondary decode table, indexed by instruction field */\n");
+  fprintf (fo, "static const short decode_secondary[%i] = {", num_secondary);
+  for (i = 0; i < num_secondary; i++)
+    fprintf (fo, "%s%4i,", (i % 12) ? "" : "\n ", secondary[i]);
+  fprintf (fo, "\n};\n\n");
+
+  fprintf (fo, "/* Fixed bits of each instruction */\n");
+  fprintf (fo, "static const struct insn_decode_match decode_match[%i] = {\n",
+           num_opcodes);
+  for (i = 0; i < num_opcodes; i++)
+    fprintf (fo, "  { 0x%08lx, 0x%08lx },\t/* %s */\n", or1ksim_ti[i].insn,
+             or1ksim_ti[i].insn_mask, or1ksim_or32_opcodes[i].name);
+  fprintf (fo, "};\n");
+
+  free (secondary);
+  return 0;
+}
+
+/* Generates decodegen.c */
+static int generate_decode_file (const char *name)
+{
+  FILE *fo;
+
+  if (!(fo = fopen (name, "wt+"))) {
+    fprintf (stderr, "Cannot create '%s'.\n", name);
+    return 1;
+  }
+
+  fprintf (fo, "/* decodegen.c -- Automatically generated decode tables\n");
+  fprintf (fo, "\n");
+  fprintf (fo, "   This file is part of Or1ksim, the OpenRISC 1000 Architectural Simulator.\n");
+  fprintf (fo, "   It was automatically generated by generate (see cpu/or32/generate.c)\n");
+  fprintf (fo, "   from the instruction table in cpu/or32/or32.c.  */\n\n");
+
+  if (generate_decode_tables (fo)) {
+    fclose (fo);
+    remove (name);
+    return 1;
+  }
+
+  fclose (fo);
+  return 0;
+}
+
 /* Main function; it takes two parameters:
-   input_file(possibly insnset.c) output_file(possibly execgen.c)*/
+   input_file(possibly insnset.c) output_file(possibly execgen.c)
+   or
+   -d output_file(possibly decodegen.c) */
 int main (int argc, char *argv[])
 {
   FILE *fo;
  
   if (argc != 3) {
     fprintf (stderr, "USAGE: generate input_file(possibly insnset.c) output_file(possibly execgen.c)\n");
+    fprintf (stderr, "       generate -d output_file(possibly decodegen.c)\n");
     exit (-1);
   }
+
+  if (strcmp (argv[1], "-d") == 0) {
+    or1ksim_build_automata (1);
+    if (generate_decode_file (argv[2])) {
+      fprintf (stderr, "generate_decode_file\n");
+      return 1;
+    }
+    or1ksim_destruct_automata ();
+    return 0;
+  }
   
   in_file = argv[1];
   out_file = argv[2];
@@ -456,19 +713,27 @@ int main (int argc, char *argv[])
     return 1;
   }
 
-  if (generate_decode_function_header (fo)) {
-    fprintf (stderr, "generate_decode_function_header\n");
-    return 1;
-  }
-  
-  if (generate_body (fo, or1ksim_automata, 0, 1)) {
-    fprintf (stderr, "generate_body\n");
+  if (generate_types (fo)) {
+    fprintf (stderr, "generate_types\n");
     return 1;
   }
 
-  if (generate_footer (fo)) {
-    fprintf (stderr, "generate_footer\n");
-    return 1;
+  /* The full decoder, then the plain one */
+  for (plain = 0; plain < 2; plain++) {
+    if (generate_decode_function_header (fo)) {
+      fprintf (stderr, "generate_decode_function_header\n");
+      return 1;
+    }
+
+    if (generate_body (fo, or1ksim_automata, 0, 1)) {
+      fprintf (stderr, "generate_body\n");
+      return 1;
+    }
+
+    if (generate_footer (fo)) {
+      fprintf (stderr, "generate_footer\n");
+      return 1;
+    }
   }
 
   fclose (fo);
@@ -662,11 +662,12 @@ INSTRUCTION (l_jal) {
 
     if (config.sim.profile) {
       struct label_entry *tmp;
-      if (verify_memoryarea(pcnext) && (tmp = get_label (pcnext)))
-        fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" %s\n",
-                 runtime.sim.cycles, cpu_state.pc + 4, pcnext,
-                 tmp->name);
-      else
+      if (verify_memoryarea(pcnext) && (tmp = get_label_containing (pcnext))) {
+        fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" ",
+                 runtime.sim.cycles, cpu_state.pc + 4, pcnext);
+        fprint_label (runtime.sim.fprof, tmp, pcnext);
+        fprintf (runtime.sim.fprof, "\n");
+      } else
         fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" @%"PRIxADDR"\n",
                  runtime.sim.cycles, cpu_state.pc + 4, pcnext,
                  pcnext);
@@ -678,11 +679,12 @@ INSTRUCTION (l_jal) {
     next_delay_insn = 1;
     if (config.sim.profile) {
       struct label_entry *tmp;
-      if (verify_memoryarea(cpu_state.pc_delay) && (tmp = get_label (cpu_state.pc_delay)))
-        fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" %s\n",
-                 runtime.sim.cycles, cpu_state.pc + 8, cpu_state.pc_delay,
-                 tmp->name);
-      else
+      if (verify_memoryarea(cpu_state.pc_delay) && (tmp = get_label_containing (cpu_state.pc_delay))) {
+        fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" ",
+                 runtime.sim.cycles, cpu_state.pc + 8, cpu_state.pc_delay);
+        fprint_label (runtime.sim.fprof, tmp, cpu_state.pc_delay);
+        fprintf (runtime.sim.fprof, "\n");
+      } else
         fprintf (runtime.sim.fprof, "+%08llX %"PRIxADDR" %"PRIxADDR" @%"PRIxADDR"\n",
                  runtime.sim.cycles, cpu_state.pc + 8, cpu_state.pc_delay,
                  cpu_state.pc_delay);
@@ -747,6 +749,9 @@ INSTRUCTION (l_rfe) {
   pcnext = cpu_state.sprs[SPR_EPCR_BASE];
   mtspr(SPR_SR, cpu_state.sprs[SPR_ESR_BASE]);
 }
+INSTRUCTION (l_none) {
+  /* l.msync, l.psync and l.csync have no effect in the simulator */
+}
 INSTRUCTION (l_nop) {
   uint32_t k = PARAM0;
   switch (k)
@@ -770,6 +775,11 @@ INSTRUCTION (l_nop) {
 	}
       else
 	{
+	  if (runtime.sim.fork_index >= 0)
+	    {
+	      runtime.sim.exit_code = evalsim_reg (3);
+	    }
+
 	  sim_done();
 	}
       break;
@@ -806,6 +816,12 @@ INSTRUCTION (l_nop) {
     case NOP_OR1KSIM:
       cpu_state.reg[11] = 1;
       break;
+    case NOP_FORK:
+      if (runtime.sim.fork_children > 0)
+	{
+	  sim_fork ();
+	}
+      break;
     default:
       break;
   }
@@ -1094,31 +1110,27 @@ INSTRUCTION (l_fl1) {
 /* Single precision */
 INSTRUCTION (lf_add_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  SET_PARAM0(float32_add((unsigned int)PARAM1,(unsigned int)PARAM2));
-  float_set_flags();
-  } else l_invalid();
+  SET_PARAM0(float_arith(FLOAT_ADD, PARAM1, PARAM2));
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_div_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  SET_PARAM0(float32_div((unsigned int)PARAM1,(unsigned int)PARAM2));
-  float_set_flags();
-  } else l_invalid();
+  SET_PARAM0(float_arith(FLOAT_DIV, PARAM1, PARAM2));
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_ftoi_s) {
   if (config.cpu.hardfloat) {
   float_set_rm();
   SET_PARAM0(float32_to_int32((unsigned int)PARAM1));
   float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_itof_s) {
   if (config.cpu.hardfloat) {
   float_set_rm();
   SET_PARAM0(int32_to_float32((unsigned int)PARAM1));
   float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_madd_s) {
   if (config.cpu.hardfloat) {
@@ -1126,96 +1138,72 @@ INSTRUCTION (lf_madd_s) {
   SET_PARAM0(float32_add((unsigned int)PARAM0, float32_mul((unsigned int)PARAM1,(unsigned int)PARAM2)));
   // Note: this ignores flags from the multiply!
   float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_mul_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  SET_PARAM0(float32_mul((unsigned int)PARAM1,(unsigned int)PARAM2));
-  float_set_flags();
-  } else l_invalid();
+  SET_PARAM0(float_arith(FLOAT_MUL, PARAM1, PARAM2));
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_rem_s) {
   if (config.cpu.hardfloat) {
   float_set_rm();
   SET_PARAM0(float32_rem((unsigned int)PARAM1,(unsigned int)PARAM2));
   float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sfeq_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if(float32_eq((unsigned int)PARAM0, (unsigned int)PARAM1))
+  if(float_compare(FLOAT_EQ, PARAM0, PARAM1))
     cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sfge_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if((!float32_lt((unsigned int)PARAM0, (unsigned int)PARAM1) & 
-      !float32_is_nan( (unsigned int)PARAM0) &
-      !float32_is_nan( (unsigned int)PARAM1) ) )
-    cpu_state.sprs[SPR_SR] |= SPR_SR_F;  
+  if(float_compare(FLOAT_GE, PARAM0, PARAM1))
+    cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sfgt_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if((!float32_le((unsigned int)PARAM0, (unsigned int)PARAM1)  & 
-      !float32_is_nan( (unsigned int)PARAM0) &
-      !float32_is_nan( (unsigned int)PARAM1) ) )
+  if(float_compare(FLOAT_GT, PARAM0, PARAM1))
     cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sfle_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if((float32_le((unsigned int)PARAM0, (unsigned int)PARAM1) & 
-      !float32_is_nan( (unsigned int)PARAM0) &
-      !float32_is_nan( (unsigned int)PARAM1) ) )    
+  if(float_compare(FLOAT_LE, PARAM0, PARAM1))
     cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sflt_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if(( float32_lt((unsigned int)PARAM0, (unsigned int)PARAM1) & 
-       !float32_is_nan( (unsigned int)PARAM0) &
-       !float32_is_nan( (unsigned int)PARAM1) ) )
+  if(float_compare(FLOAT_LT, PARAM0, PARAM1))
     cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sfne_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  if(!float32_eq((unsigned int)PARAM0, (unsigned int)PARAM1))    
+  if(float_compare(FLOAT_NE, PARAM0, PARAM1))
     cpu_state.sprs[SPR_SR] |= SPR_SR_F;
   else
     cpu_state.sprs[SPR_SR] &= ~SPR_SR_F;
-  float_set_flags();
-  } else l_invalid();
+  } else l_invalid (current);
 }
 INSTRUCTION (lf_sub_s) {
   if (config.cpu.hardfloat) {
-  float_set_rm();
-  SET_PARAM0(float32_sub((unsigned int)PARAM1,(unsigned int)PARAM2));
-  float_set_flags();
-  } else l_invalid();
+  SET_PARAM0(float_arith(FLOAT_SUB, PARAM1, PARAM2));
+  } else l_invalid (current);
 }
 
 /******* Custom instructions *******/
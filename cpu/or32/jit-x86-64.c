@@ -0,0 +1,894 @@
+/* jit-x86-64.c -- Translation of basic blocks to x86-64 host code
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* This program is commented throughout in a fashion suitable for processing
+   with Doxygen. */
+
+
+/* This file is included by execute.c when built with --enable-jit, after the
+   basic block execution functions it builds on.
+
+   A block which has been run JIT_HOT_COUNT times is translated. Each run of
+   integer ALU instructions, which cannot take an exception, touch memory or
+   change the flow of control, becomes straight host code working on
+   cpu_state.reg and SR. The cycle, instruction and PC bookkeeping for the
+   whole run is done once at its end. Any other instruction (loads and stores,
+   jumps and branches, multiply and divide, floating point, l.mtspr etc.) is a
+   call to exec_block_insn(), which runs its usual handler, so memory accesses
+   go through the eval_mem and set_mem functions as before.
+
+   Before a run the scheduler is checked to be sure no job falls due in the
+   middle of it. If one would, the host code returns, and the rest of the block
+   is interpreted, so jobs still run on exactly the same cycle. Blocks are
+   discarded (along with their host code) when their code is written, as for
+   interpreted blocks. */
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+
+/*! Times a block is run before it is translated to host code */
+#define JIT_HOT_COUNT       16
+
+/*! Size of the buffer for host code. When full, all blocks are discarded */
+#define JIT_CODE_SIZE       (16 * 1024 * 1024)
+
+/*! Most host code a block of MAX_BLOCK_INSNS instructions can need */
+#define JIT_MAX_BLOCK_CODE  16384
+
+/* Host registers. EBX holds the address of cpu_state throughout. */
+#define X_EAX  0
+#define X_ECX  1
+#define X_EDX  2
+#define X_EBX  3
+
+/* Host condition codes */
+#define X_CC_O   0x0
+#define X_CC_B   0x2
+#define X_CC_AE  0x3
+#define X_CC_E   0x4
+#define X_CC_NE  0x5
+#define X_CC_BE  0x6
+#define X_CC_A   0x7
+#define X_CC_L   0xc
+#define X_CC_GE  0xd
+#define X_CC_LE  0xe
+#define X_CC_G   0xf
+
+/*! A host ALU operation, as the opcode with a memory source and the opcode
+    extension with an immediate source. */
+struct x_alu
+{
+  unsigned char  rm;
+  unsigned char  ext;
+};
+
+static const struct x_alu  x_add = { 0x03, 0 };
+static const struct x_alu  x_or  = { 0x0b, 1 };
+static const struct x_alu  x_adc = { 0x13, 2 };
+static const struct x_alu  x_and = { 0x23, 4 };
+static const struct x_alu  x_sub = { 0x2b, 5 };
+static const struct x_alu  x_xor = { 0x33, 6 };
+static const struct x_alu  x_cmp = { 0x3b, 7 };
+
+/* Offsets into cpu_state */
+#define CPU_REG_OFF(r)  (offsetof (struct cpu_state, reg) + 4 * (r))
+#define CPU_SPR_OFF(s)  (offsetof (struct cpu_state, sprs) + 4 * (s))
+#define CPU_IQ_OFF(f)   (offsetof (struct cpu_state, iqueue) + \
+			 offsetof (struct iqueue_entry, f))
+
+/*! Set if no buffer for host code could be had */
+static int  jit_unavailable = 0;
+
+/*! Where the next byte of host code goes */
+static unsigned char *jit_p;
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit bytes of host code                                                   */
+/*---------------------------------------------------------------------------*/
+static void
+emit8 (unsigned int  val)
+{
+  *jit_p++ = val;
+
+}	/* emit8() */
+
+
+static void
+emit32 (uint32_t  val)
+{
+  memcpy (jit_p, &val, 4);
+  jit_p += 4;
+
+}	/* emit32() */
+
+
+static void
+emit64 (uint64_t  val)
+{
+  memcpy (jit_p, &val, 8);
+  jit_p += 8;
+
+}	/* emit64() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Fill in a 32-bit value in host code already emitted
+
+   @param[in] p    Where the value goes
+   @param[in] val  The value                                                 */
+/*---------------------------------------------------------------------------*/
+static void
+patch32 (unsigned char *p,
+	 uint32_t       val)
+{
+  memcpy (p, &val, 4);
+
+}	/* patch32() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit the ModRM byte and displacement for a field of cpu_state
+
+   @param[in] reg  The host register (or opcode extension)
+   @param[in] off  The offset of the field                                   */
+/*---------------------------------------------------------------------------*/
+static void
+emit_cpu_modrm (int     reg,
+		size_t  off)
+{
+  emit8 (0x80 | (reg << 3) | X_EBX);
+  emit32 (off);
+
+}	/* emit_cpu_modrm() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit code to load a host register with the address of a variable
+
+   @param[in] reg  The host register
+   @param[in] ptr  The address                                               */
+/*---------------------------------------------------------------------------*/
+static void
+emit_movabs (int         reg,
+	     const void *ptr)
+{
+  emit8 (0x48);
+  emit8 (0xb8 + reg);
+  emit64 ((uintptr_t) ptr);
+
+}	/* emit_movabs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit code to return from the host code for a block
+
+   @param[in] next  Index of the next instruction of the block to run        */
+/*---------------------------------------------------------------------------*/
+static void
+emit_return (int  next)
+{
+  emit8 (0xb8);			/* mov eax, next */
+  emit32 (next);
+  emit8 (0x5b);			/* pop rbx */
+  emit8 (0xc3);			/* ret */
+
+}	/* emit_return() */
+
+/*! Bytes of code emit_return() produces */
+#define RETURN_SIZE  7
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit code to load a host register with a predecoded operand
+
+   @param[in] reg  The host register
+   @param[in] op   The operand (register or immediate)                       */
+/*---------------------------------------------------------------------------*/
+static void
+emit_load_op (int                reg,
+	      struct decoded_op *op)
+{
+  if (DOP_IMM == op->type)
+    {
+      emit8 (0xb8 + reg);	/* mov reg, imm */
+      emit32 (op->imm);
+    }
+  else
+    {
+      emit8 (0x8b);		/* mov reg, gpr */
+      emit_cpu_modrm (reg, CPU_REG_OFF (op->reg));
+    }
+}	/* emit_load_op() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit an ALU operation on EAX with a predecoded operand
+
+   @param[in] alu  The operation
+   @param[in] op   The operand (register or immediate)                       */
+/*---------------------------------------------------------------------------*/
+static void
+emit_alu_op (const struct x_alu *alu,
+	     struct decoded_op  *op)
+{
+  if (DOP_IMM == op->type)
+    {
+      emit8 (0x81);		/* op eax, imm */
+      emit8 (0xc0 | (alu->ext << 3) | X_EAX);
+      emit32 (op->imm);
+    }
+  else
+    {
+      emit8 (alu->rm);		/* op eax, gpr */
+      emit_cpu_modrm (X_EAX, CPU_REG_OFF (op->reg));
+    }
+}	/* emit_alu_op() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit code to store EAX in the destination register
+
+   As with setsim_reg(), r0 is always written as zero.
+
+   @param[in] op  The destination operand                                    */
+/*---------------------------------------------------------------------------*/
+static void
+emit_store_dest (struct decoded_op *op)
+{
+  if (0 == op->reg)
+    {
+      emit8 (0xc7);		/* mov r0, 0 */
+      emit_cpu_modrm (0, CPU_REG_OFF (0));
+      emit32 (0);
+    }
+  else
+    {
+      emit8 (0x89);		/* mov gpr, eax */
+      emit_cpu_modrm (X_EAX, CPU_REG_OFF (op->reg));
+    }
+}	/* emit_store_dest() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit code to copy the host flag bits in ECX and EDX into SR
+
+   @param[in] ecx_bit  SR bit for the value (0 or 1) in ECX, or 0 if unused
+   @param[in] edx_bit  SR bit for the value (0 or 1) in EDX                  */
+/*---------------------------------------------------------------------------*/
+static void
+emit_set_sr (uorreg_t  ecx_bit,
+	     uorreg_t  edx_bit)
+{
+  emit8 (0x0f);			/* movzx edx, dl */
+  emit8 (0xb6);
+  emit8 (0xd2);
+  emit8 (0xc1);			/* shl edx, log2 (edx_bit) */
+  emit8 (0xe2);
+  emit8 (ffs (edx_bit) - 1);
+
+  if (0 != ecx_bit)
+    {
+      emit8 (0x0f);		/* movzx ecx, cl */
+      emit8 (0xb6);
+      emit8 (0xc9);
+      emit8 (0xc1);		/* shl ecx, log2 (ecx_bit) */
+      emit8 (0xe1);
+      emit8 (ffs (ecx_bit) - 1);
+      emit8 (0x09);		/* or edx, ecx */
+      emit8 (0xca);
+    }
+
+  emit8 (0x8b);			/* mov ecx, sr */
+  emit_cpu_modrm (X_ECX, CPU_SPR_OFF (SPR_SR));
+  emit8 (0x81);			/* and ecx, ~bits */
+  emit8 (0xe1);
+  emit32 (~(ecx_bit | edx_bit));
+  emit8 (0x09);			/* or ecx, edx */
+  emit8 (0xd1);
+  emit8 (0x89);			/* mov sr, ecx */
+  emit_cpu_modrm (X_ECX, CPU_SPR_OFF (SPR_SR));
+
+}	/* emit_set_sr() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit the end of an add, l.add or l.addc
+
+   Sets SR[CY] and SR[OV] from the host flags, stores the result and counts a
+   byte add as the handlers do. SR[OVE] is known to be clear.
+
+   @param[in] d  The instruction                                             */
+/*---------------------------------------------------------------------------*/
+static void
+emit_add_end (struct decoded_insn *d)
+{
+  emit8 (0x0f);			/* setc cl */
+  emit8 (0x90 | X_CC_B);
+  emit8 (0xc1);
+  emit8 (0x0f);			/* seto dl */
+  emit8 (0x90 | X_CC_O);
+  emit8 (0xc2);
+  emit_store_dest (&d->op[0]);
+  emit_set_sr (SPR_SR_CY, SPR_SR_OV);
+
+  emit8 (0x0f);			/* movsx ecx, al */
+  emit8 (0xbe);
+  emit8 (0xc8);
+  emit8 (0x39);			/* cmp ecx, eax */
+  emit8 (0xc1);
+  emit8 (0x75);			/* jne over the count */
+  emit8 (12);
+  emit_movabs (X_EDX, &or1k_mstats.byteadd);
+  emit8 (0xff);			/* inc dword [rdx] */
+  emit8 (0x02);
+
+}	/* emit_add_end() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Is an operand a register or immediate, which host code can use?
+
+   @param[in] op  The operand
+
+   @return  Non-zero if it is                                                */
+/*---------------------------------------------------------------------------*/
+static int
+jit_op_ok (struct decoded_op *op)
+{
+  return  (DOP_REG == op->type) || (DOP_IMM == op->type);
+
+}	/* jit_op_ok() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit host code for an instruction, if it is a simple ALU instruction
+
+   Nothing is emitted for other instructions.
+
+   @param[in] d  The instruction
+
+   @return  Non-zero if host code was emitted                                */
+/*---------------------------------------------------------------------------*/
+static int
+jit_emit_insn (struct decoded_insn *d)
+{
+  static const struct
+  {
+    void (*exec) (struct iqueue_entry *);
+    int    cc;
+  } set_flags[] = {
+    { l_sfeq,  X_CC_E  }, { l_sfne,  X_CC_NE },
+    { l_sfgts, X_CC_G  }, { l_sfges, X_CC_GE },
+    { l_sflts, X_CC_L  }, { l_sfles, X_CC_LE },
+    { l_sfgtu, X_CC_A  }, { l_sfgeu, X_CC_AE },
+    { l_sfltu, X_CC_B  }, { l_sfleu, X_CC_BE }
+  };
+
+  struct decoded_op *op = d->op;
+  unsigned int       i;
+
+#if RAW_RANGE_STATS
+  /* Every register access is recorded */
+  return  0;
+#endif
+
+  if (l_nop == d->exec)
+    {
+      return  0 == op[0].imm;
+    }
+
+  for (i = 0; i < sizeof (set_flags) / sizeof (set_flags[0]); i++)
+    {
+      if (set_flags[i].exec == d->exec)
+	{
+	  if (!jit_op_ok (&op[0]) || !jit_op_ok (&op[1]))
+	    {
+	      return  0;
+	    }
+
+	  emit_load_op (X_EAX, &op[0]);
+	  emit_alu_op (&x_cmp, &op[1]);
+	  emit8 (0x0f);		/* setcc dl */
+	  emit8 (0x90 | set_flags[i].cc);
+	  emit8 (0xc2);
+	  emit_set_sr (0, SPR_SR_F);
+	  return  1;
+	}
+    }
+
+  /* Everything else writes a register from one or two sources */
+  if ((DOP_REG != op[0].type) || !jit_op_ok (&op[1]))
+    {
+      return  0;
+    }
+
+  if ((l_and == d->exec) || (l_or == d->exec) || (l_xor == d->exec) ||
+      (l_add == d->exec) || (l_addc == d->exec) || (l_sub == d->exec) ||
+      (l_sll == d->exec) || (l_srl == d->exec) || (l_sra == d->exec) ||
+      (l_ror == d->exec) || (l_cmov == d->exec))
+    {
+      if (!jit_op_ok (&op[2]))
+	{
+	  return  0;
+	}
+    }
+  else if ((l_movhi != d->exec) && (l_extbs != d->exec) &&
+	   (l_extbz != d->exec) && (l_exths != d->exec) &&
+	   (l_exthz != d->exec) && (l_extws != d->exec) &&
+	   (l_extwz != d->exec) && (l_ff1 != d->exec) && (l_fl1 != d->exec))
+    {
+      return  0;
+    }
+
+  emit_load_op (X_EAX, &op[1]);
+
+  if (l_movhi == d->exec)
+    {
+      emit8 (0xc1);		/* shl eax, 16 */
+      emit8 (0xe0);
+      emit8 (16);
+    }
+  else if (l_and == d->exec)
+    {
+      emit_alu_op (&x_and, &op[2]);
+    }
+  else if (l_or == d->exec)
+    {
+      emit_alu_op (&x_or, &op[2]);
+    }
+  else if (l_xor == d->exec)
+    {
+      emit_alu_op (&x_xor, &op[2]);
+    }
+  else if (l_add == d->exec)
+    {
+      emit_alu_op (&x_add, &op[2]);
+      emit_add_end (d);
+      return  1;
+    }
+  else if (l_addc == d->exec)
+    {
+      emit8 (0x8b);		/* mov edx, sr */
+      emit_cpu_modrm (X_EDX, CPU_SPR_OFF (SPR_SR));
+      emit8 (0x0f);		/* bt edx, log2 (SPR_SR_CY) */
+      emit8 (0xba);
+      emit8 (0xe2);
+      emit8 (ffs (SPR_SR_CY) - 1);
+      emit_alu_op (&x_adc, &op[2]);
+      emit_add_end (d);
+      return  1;
+    }
+  else if (l_sub == d->exec)
+    {
+      emit_alu_op (&x_sub, &op[2]);
+      emit8 (0x0f);		/* setc cl */
+      emit8 (0x90 | X_CC_B);
+      emit8 (0xc1);
+      emit8 (0x0f);		/* seto dl */
+      emit8 (0x90 | X_CC_O);
+      emit8 (0xc2);
+      emit_store_dest (&op[0]);
+      emit_set_sr (SPR_SR_CY, SPR_SR_OV);
+      return  1;
+    }
+  else if ((l_sll == d->exec) || (l_srl == d->exec) || (l_sra == d->exec) ||
+	   (l_ror == d->exec))
+    {
+      /* The shift count is taken modulo 32, as the host does for the
+	 handlers */
+      int  ext = (l_sll == d->exec) ? 4 : (l_srl == d->exec) ? 5 :
+	         (l_sra == d->exec) ? 7 : 1;
+
+      if (DOP_IMM == op[2].type)
+	{
+	  emit8 (0xc1);		/* shift eax, imm */
+	  emit8 (0xc0 | (ext << 3) | X_EAX);
+	  emit8 (op[2].imm & 0x1f);
+	}
+      else
+	{
+	  emit_load_op (X_ECX, &op[2]);
+	  emit8 (0xd3);		/* shift eax, cl */
+	  emit8 (0xc0 | (ext << 3) | X_EAX);
+	}
+    }
+  else if (l_cmov == d->exec)
+    {
+      emit_load_op (X_ECX, &op[2]);
+      emit8 (0xf7);		/* test sr, SPR_SR_F */
+      emit_cpu_modrm (0, CPU_SPR_OFF (SPR_SR));
+      emit32 (SPR_SR_F);
+      emit8 (0x0f);		/* cmovz eax, ecx */
+      emit8 (0x44);
+      emit8 (0xc1);
+    }
+  else if ((l_extbs == d->exec) || (l_extbz == d->exec) ||
+	   (l_exths == d->exec) || (l_exthz == d->exec))
+    {
+      emit8 (0x0f);		/* movsx/movzx eax, al/ax */
+      emit8 ((l_extbs == d->exec) ? 0xbe : (l_extbz == d->exec) ? 0xb6 :
+	     (l_exths == d->exec) ? 0xbf : 0xb7);
+      emit8 (0xc0);
+    }
+  else if ((l_ff1 == d->exec) || (l_fl1 == d->exec))
+    {
+      emit8 (0x85);		/* test eax, eax */
+      emit8 (0xc0);
+      emit8 (0x74);		/* jz over, leaving zero */
+      emit8 (5);
+      emit8 (0x0f);		/* bsf/bsr eax, eax */
+      emit8 ((l_ff1 == d->exec) ? 0xbc : 0xbd);
+      emit8 (0xc0);
+      emit8 (0xff);		/* inc eax */
+      emit8 (0xc0);
+    }
+
+  /* l.extws and l.extwz are just a copy */
+  emit_store_dest (&op[0]);
+  return  1;
+
+}	/* jit_emit_insn() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Fetch cycles for each instruction of a block
+
+   @param[in] blk      The block
+   @param[in] immu_on  Non-zero if the IMMU is enabled
+
+   @return  The memory delay, plus the ITLB hit delay if the IMMU is on      */
+/*---------------------------------------------------------------------------*/
+static int
+jit_cost (struct block *blk,
+	  int           immu_on)
+{
+  return  blk->mem->ops.delayr + (immu_on ? immu_state->hitdelay : 0);
+
+}	/* jit_cost() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Do the instruction fetches for a run of ALU instructions with the IMMU on
+
+   Called from host code. Only the first fetch can take an exception: the rest
+   are in the same page, and nothing in the run changes the SR or ITLB. If it
+   does, the instruction is dealt with as exec_block_insn() would.
+
+   @param[in] n  Number of instructions in the run
+
+   @return  Non-zero if the fetch took an exception and the block should be
+            left                                                            */
+/*---------------------------------------------------------------------------*/
+static int
+jit_fetch (int  n)
+{
+  oraddr_t  pc = cpu_state.pc;
+  int       i;
+
+  except_pending         = 0;
+  next_delay_insn        = 0;
+  runtime.sim.mem_cycles = 0;
+
+  immu_translate (pc);
+
+  if (except_pending)
+    {
+      update_pc ();
+
+      runtime.sim.cycles        += runtime.sim.mem_cycles;
+      scheduler.job_queue->time -= runtime.sim.mem_cycles;
+      return  1;
+    }
+
+  for (i = 1; i < n; i++)
+    {
+      immu_translate (pc + 4 * i);
+    }
+
+  /* The host code accounts for the hit delays */
+  runtime.sim.mem_cycles = 0;
+  return  0;
+
+}	/* jit_fetch() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Run an instruction which has no host code
+
+   Called from host code. The block is also left if the instruction changed
+   the memory delay, since the host code assumes it.
+
+   @param[in] blk  The block being executed
+   @param[in] d    The instruction
+
+   @return  Non-zero if the block should be left                             */
+/*---------------------------------------------------------------------------*/
+static int
+jit_exec_insn (struct block        *blk,
+	       struct decoded_insn *d)
+{
+  return  exec_block_insn (blk, d, blk->code_immu) ||
+    (jit_cost (blk, blk->code_immu) != blk->code_cost);
+
+}	/* jit_exec_insn() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Emit host code for a run of ALU instructions
+
+   The run is as long as jit_emit_insn() will take, stopping before the
+   instruction in a delay slot.
+
+   @param[in] blk    The block
+   @param[in] first  Index of the first instruction of the run
+
+   @return  Number of instructions in the run, which may be zero             */
+/*---------------------------------------------------------------------------*/
+static int
+jit_emit_run (struct block *blk,
+	      int           first)
+{
+  unsigned char       *start = jit_p;
+  unsigned char       *check_imm;
+  unsigned char       *fetch_imm = NULL;
+  struct decoded_insn *last;
+  int                  cost = blk->code_cost;
+  int                  n;
+
+  /* Leave it to the interpreter if a job falls due during the run (the last
+     instruction may take the time to zero). */
+  emit_movabs (X_EAX, &scheduler.job_queue);
+  emit8 (0x48);			/* mov rax, [rax] */
+  emit8 (0x8b);
+  emit8 (0x00);
+  emit8 (0x81);			/* cmp dword [rax + time], (n - 1) * cost */
+  emit8 (0xb8);
+  emit32 (offsetof (struct sched_entry, time));
+  check_imm = jit_p;
+  emit32 (0);
+  emit8 (0x7f);			/* jg over the return */
+  emit8 (RETURN_SIZE);
+  emit_return (first);
+
+  if (blk->code_immu)
+    {
+      emit8 (0xbf);		/* mov edi, n */
+      fetch_imm = jit_p;
+      emit32 (0);
+      emit_movabs (X_EAX, jit_fetch);
+      emit8 (0xff);		/* call rax */
+      emit8 (0xd0);
+      emit8 (0x85);		/* test eax, eax */
+      emit8 (0xc0);
+      emit8 (0x74);		/* jz over the return */
+      emit8 (RETURN_SIZE);
+      emit_return (blk->ninsns);
+    }
+
+  for (n = 0; first + n < blk->ninsns; n++)
+    {
+      struct decoded_insn *d = &(blk->insns[first + n]);
+
+      if ((first + n > 0) && (d[-1].insn_index >= 0) &&
+	  (or1ksim_or32_opcodes[d[-1].insn_index].flags & OR32_IF_DELAY))
+	{
+	  break;
+	}
+
+      if (!jit_emit_insn (d))
+	{
+	  break;
+	}
+    }
+
+  if (0 == n)
+    {
+      jit_p = start;
+      return  0;
+    }
+
+  patch32 (check_imm, (n - 1) * cost);
+
+  if (NULL != fetch_imm)
+    {
+      patch32 (fetch_imm, n);
+    }
+
+  /* The bookkeeping exec_block_insn() does, for the whole run */
+  emit_movabs (X_EAX, &runtime.sim.cycles);
+  emit8 (0x48);			/* add qword [rax], n * cost */
+  emit8 (0x81);
+  emit8 (0x00);
+  emit32 (n * cost);
+  emit_movabs (X_EAX, &runtime.cpu.instructions);
+  emit8 (0x48);			/* add qword [rax], n */
+  emit8 (0x81);
+  emit8 (0x00);
+  emit32 (n);
+
+  last = &(blk->insns[first + n - 1]);
+
+  emit8 (0x8b);			/* mov eax, pc */
+  emit_cpu_modrm (X_EAX, offsetof (struct cpu_state, pc));
+  emit8 (0x05);			/* add eax, 4 * n */
+  emit32 (4 * n);
+  emit8 (0x89);			/* mov pc, eax */
+  emit_cpu_modrm (X_EAX, offsetof (struct cpu_state, pc));
+  emit8 (0x8d);			/* lea ecx, [rax - 4] */
+  emit8 (0x48);
+  emit8 (0xfc);
+  emit8 (0x89);			/* mov ppc, ecx */
+  emit_cpu_modrm (X_ECX, CPU_SPR_OFF (SPR_PPC));
+  emit8 (0x89);			/* mov iqueue.insn_addr, ecx */
+  emit_cpu_modrm (X_ECX, CPU_IQ_OFF (insn_addr));
+  emit8 (0xc7);			/* mov iqueue.insn, insn */
+  emit_cpu_modrm (0, CPU_IQ_OFF (insn));
+  emit32 (last->insn);
+  emit8 (0xc7);			/* mov iqueue.insn_index, insn_index */
+  emit_cpu_modrm (0, CPU_IQ_OFF (insn_index));
+  emit32 (last->insn_index);
+  emit8 (0x83);			/* add eax, 4 */
+  emit8 (0xc0);
+  emit8 (4);
+  emit_movabs (X_EDX, &pcnext);
+  emit8 (0x89);			/* mov [rdx], eax */
+  emit8 (0x02);
+
+  emit_movabs (X_EAX, &scheduler.job_queue);
+  emit8 (0x48);			/* mov rax, [rax] */
+  emit8 (0x8b);
+  emit8 (0x00);
+  emit8 (0x81);			/* sub dword [rax + time], n * cost */
+  emit8 (0xa8);
+  emit32 (offsetof (struct sched_entry, time));
+  emit32 (n * cost);
+  emit8 (0x7f);			/* jg over the return */
+  emit8 (RETURN_SIZE);
+  emit_return (blk->ninsns);
+
+  return  n;
+
+}	/* jit_emit_run() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Translate a block to host code
+
+   The host code is a function, returning the index of the next instruction
+   of the block to be interpreted (the number of instructions if the block
+   should be left).
+
+   @param[in] blk      The block
+   @param[in] immu_on  Non-zero if the IMMU is enabled
+
+   @return  Non-zero if the block was translated                             */
+/*---------------------------------------------------------------------------*/
+static int
+jit_translate (struct block *blk,
+	       int           immu_on)
+{
+  int  i;
+
+  if (NULL == dstate->jit_code)
+    {
+      dstate->jit_code = mmap (NULL, JIT_CODE_SIZE,
+			       PROT_READ | PROT_WRITE | PROT_EXEC,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if (MAP_FAILED == dstate->jit_code)
+	{
+	  fprintf (stderr, "Warning: No memory for host code: basic blocks "
+		   "will be interpreted\n");
+	  dstate->jit_code = NULL;
+	  jit_unavailable  = 1;
+	  return  0;
+	}
+    }
+
+  if (dstate->jit_code_used + JIT_MAX_BLOCK_CODE > JIT_CODE_SIZE)
+    {
+      /* Nothing can be running, so all the code can go. This block goes too,
+	 and is interpreted this time. */
+      decode_cache_flush ();
+      dstate->jit_code_used = 0;
+      return  0;
+    }
+
+  blk->code_immu = immu_on;
+  blk->code_cost = jit_cost (blk, immu_on);
+  jit_p          = dstate->jit_code + dstate->jit_code_used;
+
+  emit8 (0x53);			/* push rbx */
+  emit_movabs (X_EBX, &cpu_state);
+
+  for (i = 0; i < blk->ninsns; i++)
+    {
+      int  n = jit_emit_run (blk, i);
+
+      if (n > 0)
+	{
+	  i += n - 1;
+	  continue;
+	}
+
+      emit_movabs (7, blk);	/* mov rdi, blk */
+      emit_movabs (6, &(blk->insns[i]));	/* mov rsi, insn */
+      emit_movabs (X_EAX, jit_exec_insn);
+      emit8 (0xff);		/* call rax */
+      emit8 (0xd0);
+      emit8 (0x85);		/* test eax, eax */
+      emit8 (0xc0);
+      emit8 (0x74);		/* jz over the return */
+      emit8 (RETURN_SIZE);
+      emit_return (blk->ninsns);
+    }
+
+  emit_return (blk->ninsns);
+
+  blk->code             = (int (*) (void)) (void *)
+    (dstate->jit_code + dstate->jit_code_used);
+  dstate->jit_code_used = jit_p - dstate->jit_code;
+
+  return  1;
+
+}	/* jit_translate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Run as much of a block as possible as host code
+
+   Blocks are translated once hot. The host code is only used when nothing it
+   assumes has changed since: the IMMU state and memory delay, no delay slot
+   pending and no range exceptions enabled.
+
+   @param[in] blk      The block
+   @param[in] immu_on  Non-zero if the IMMU is enabled
+
+   @return  Index of the next instruction of the block to be interpreted     */
+/*---------------------------------------------------------------------------*/
+static int
+jit_exec_block (struct block *blk,
+		int           immu_on)
+{
+  if (jit_unavailable || cpu_state.delay_insn ||
+      (cpu_state.sprs[SPR_SR] & SPR_SR_OVE) ||
+      (immu_on && (immu_state->pagesize < CODE_PAGE_SIZE)))
+    {
+      return  0;
+    }
+
+  if ((NULL != blk->code) &&
+      ((blk->code_immu != immu_on) ||
+       (blk->code_cost != jit_cost (blk, immu_on))))
+    {
+      blk->code  = NULL;
+      blk->execs = 0;
+    }
+
+  if ((NULL == blk->code) &&
+      ((++blk->execs < JIT_HOT_COUNT) || !jit_translate (blk, immu_on)))
+    {
+      return  0;
+    }
+
+  return  blk->code ();
+
+}	/* jit_exec_block() */
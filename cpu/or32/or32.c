@@ -66,11 +66,12 @@ CONST struct or32_letter or32_letters[] = {
 */
 
 #ifdef HAVE_EXECUTION
-# if SIMPLE_EXECUTION
+/* generate needs the names of the functions whatever the execution model */
+# if (SIMPLE_EXECUTION || BLOCK_EXECUTION) && !defined (OR32_GENERATE)
 #  define EFN &l_none
 #  define EF(func) &(func)
 #  define EFI &l_invalid
-# elif COMPLEX_EXECUTION
+# else
 #  define EFN "l_none"
 #  define EFI "l_invalid"
 #  ifdef __GNUC__
@@ -680,6 +681,13 @@ insn_extract (param_ch, enc_initial)
   return ret;
 }
 
+#ifndef OR32_GENERATE
+/* The decode tables, generated from or1ksim_or32_opcodes at build time by
+   generate.c (which is itself built with OR32_GENERATE, and so uses the
+   automaton).  */
+#include "decodegen.c"
+#endif
+
 #define MAX_AUTOMATA_SIZE (1200)
 #define MAX_OP_TABLE_SIZE (1200)
 #define MAX_LEN           (8)
@@ -717,6 +725,7 @@ or32_debug (int level, const char *format, ...)
 #endif
 }
 
+#ifdef OR32_GENERATE
 /* Recursive utility function used to find best match and to build automata.  */
 static unsigned long *
 cover_insn (unsigned long *cur, int pass, unsigned int mask)
@@ -821,6 +830,7 @@ cover_insn (unsigned long *cur, int pass, unsigned int mask)
     }
   return cur;
 }
+#endif	/* OR32_GENERATE */
 
 /* Returns number of nonzero bits. */
 static int
@@ -957,14 +967,18 @@ parse_params (CONST struct or32_opcode *opcode, struct insn_op_struct *cur)
 /* -------------------------------------------------------------------------- */
 /*!Constructs new automata based on or1ksim_or32_opcodes array.
 
+   Only generate itself builds the automaton, from which it generates the
+   decode tables. Everything else just parses the operands.
+
    @param[in] quiet  If non-zero (TRUE) do not print informational messages. */
 /* -------------------------------------------------------------------------- */
 void
 or1ksim_build_automata (int  quiet)
 {
   int i;
-  unsigned long *end;
   struct insn_op_struct *cur;
+#ifdef OR32_GENERATE
+  unsigned long *end;
 
   or1ksim_automata =
     (unsigned long *) malloc (MAX_AUTOMATA_SIZE * sizeof (unsigned long));
@@ -1008,6 +1022,7 @@ or1ksim_build_automata (int  quiet)
       printf ("done, num uncovered: %i/%i.\n", nuncovered, NUM_OPCODES);
     }
 #endif
+#endif	/* OR32_GENERATE */
 
 #ifdef HAVE_EXECUTION
   if (!quiet)
@@ -1051,6 +1066,20 @@ or1ksim_destruct_automata ()
 }
 
 /* Decodes instruction and returns instruction index.  */
+#ifndef OR32_GENERATE
+int
+or1ksim_insn_decode (unsigned int insn)
+{
+  const struct insn_decode_primary *p = &decode_primary[insn >> 26];
+  int i = decode_secondary[p->base + ((insn >> p->shift) & p->mask)];
+
+  /* Final check - do we have direct match?  */
+  if ((i >= 0) && ((decode_match[i].insn_mask & insn) == decode_match[i].insn))
+    return i;
+  else
+    return -1;
+}
+#else
 int
 or1ksim_insn_decode (unsigned int insn)
 {
@@ -1080,6 +1109,7 @@ or1ksim_insn_decode (unsigned int insn)
   else
     return -1;
 }
+#endif	/* OR32_GENERATE */
 
 static char disassembled_str[50];
 char *or1ksim_disassembled = &disassembled_str[0];
@@ -44,6 +44,7 @@ extern void l_sb PARAMS((struct iqueue_entry *));
 extern void l_sh PARAMS((struct iqueue_entry *));
 extern void l_lwa PARAMS((struct iqueue_entry *));
 extern void l_lwz PARAMS((struct iqueue_entry *));
+extern void l_lws PARAMS((struct iqueue_entry *));
 extern void l_lbs PARAMS((struct iqueue_entry *));
 extern void l_lbz PARAMS((struct iqueue_entry *));
 extern void l_lhs PARAMS((struct iqueue_entry *));
@@ -54,10 +55,12 @@ extern void l_or PARAMS((struct iqueue_entry *));
 extern void l_xor PARAMS((struct iqueue_entry *));
 extern void l_sub PARAMS((struct iqueue_entry *));
 extern void l_mul PARAMS((struct iqueue_entry *));
+extern void l_mulu PARAMS((struct iqueue_entry *));
 extern void l_div PARAMS((struct iqueue_entry *));
 extern void l_divu PARAMS((struct iqueue_entry *));
 extern void l_sll PARAMS((struct iqueue_entry *));
 extern void l_sra PARAMS((struct iqueue_entry *));
+extern void l_ror PARAMS((struct iqueue_entry *));
 extern void l_srl PARAMS((struct iqueue_entry *));
 extern void l_j PARAMS((struct iqueue_entry *));
 extern void l_jal PARAMS((struct iqueue_entry *));
@@ -90,6 +93,7 @@ extern void l_mac PARAMS((struct iqueue_entry *));
 extern void l_msb PARAMS((struct iqueue_entry *));
 extern void l_cmov PARAMS ((struct iqueue_entry *));
 extern void l_ff1 PARAMS ((struct iqueue_entry *));
+extern void l_fl1 PARAMS ((struct iqueue_entry *));
 extern void l_cust1 PARAMS ((struct iqueue_entry *));
 extern void l_cust2 PARAMS ((struct iqueue_entry *));
 extern void l_cust3 PARAMS ((struct iqueue_entry *));
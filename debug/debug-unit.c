@@ -1036,6 +1036,19 @@ debug_vapi_id (union param_val val, void *dat)
 }	/* debug_vapi_id () */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register the debug unit as simulator state, one for each core */
+/*---------------------------------------------------------------------------*/
+void
+reg_du_state ()
+{
+  reg_core_state (&development, sizeof (development));
+  reg_core_state (&current_scan_chain, sizeof (current_scan_chain));
+  reg_core_state (&in_reset, sizeof (in_reset));
+
+}	/* reg_du_state() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Register the configuration functions for the debug unit                   */
 /*---------------------------------------------------------------------------*/
@@ -61,5 +61,6 @@ extern int   debug_set_register (oraddr_t  address,
 extern int   debug_set_chain (enum debug_scan_chain_ids  chain);
 extern int   debug_ignore_exception (unsigned long except);
 extern void  reg_debug_sec ();
+extern void  reg_du_state ();
 
 #endif	/*  DEBUG_UNIT__H */
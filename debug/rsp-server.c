@@ -2407,4 +2407,16 @@ rsp_insert_matchpoint (struct rsp_buf *buf)
     }
 
 }	/* rsp_insert_matchpoint () */
- 
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the RSP server's state as simulator state
+
+   Each machine has its own connection to GDB and its own matchpoints.       */
+/*---------------------------------------------------------------------------*/
+void
+reg_rsp_state ()
+{
+  reg_sim_state (&rsp, sizeof (rsp));
+
+}	/* reg_rsp_state () */
@@ -31,5 +31,6 @@
 extern void  rsp_init ();
 extern void  handle_rsp ();
 extern void  rsp_exception (unsigned long int  except);
+extern void  reg_rsp_state ();
 
 #endif	/* RSP_SERVER__H */
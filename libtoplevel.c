@@ -29,8 +29,10 @@
 
 /* System includes */
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <threads.h>
 
 /* Package includes */
 #include "or1ksim.h"
@@ -43,6 +45,7 @@
 #include "jtag.h"
 #include "spr-defs.h"
 #include "sprs.h"
+#include "checkpoint.h"
 
 
 /* Indices of GDB registers that are not GPRs. Must match GDB settings! */
@@ -52,6 +55,26 @@
 #define SR_REGNUM   (MAX_GPRS + 2)	/*!< Supervision Register */
 
 
+/*! A simulator instance. Its state lives in the simulator's globals while it
+    is current, and in its own buffer otherwise. */
+struct or1ksim
+{
+  void *state;			/*!< Saved state, when not current */
+};
+
+/*! The current instance, NULL if none (or only or1ksim_init() is used) */
+static struct or1ksim *cur_inst = NULL;
+
+/*! The state of an unconfigured simulator, from which new instances start */
+static void *initial_state = NULL;
+
+/*! Serializes instances, since only one can be current at a time. The
+    pthreads header can't be used, since it picks up support/sched.h, so this
+    is a C11 mutex, set up once by init_inst_mutex(). */
+static mtx_t      inst_mutex;
+static once_flag  inst_mutex_once = ONCE_FLAG_INIT;
+
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize the simulator. 
 
@@ -93,6 +116,13 @@ or1ksim_init (int         argc,
     }
 
   config.sim.is_library = 1;	/* Library operation */
+
+  if (config.cpu.cores > 1)
+    {
+      fprintf (stderr, "Warning: or1ksim_init: only the standalone simulator "
+	       "has multiple cores: one used\n");
+      config.cpu.cores = 1;
+    }
   config.sim.profile    = 0;	/* No profiling */
   config.sim.mprofile   = 0;
 
@@ -169,15 +199,43 @@ or1ksim_run (double duration)
      duration) */
   while (duration < 0.0 || (runtime.sim.cycles < runtime.sim.end_cycles))
     {
-      long long int time_start = runtime.sim.cycles;
+      long long int time_start;
       int i;			/* Interrupt # */
 
+      skip_idle_loop (duration < 0.0 ? -1 :
+		      runtime.sim.end_cycles - runtime.sim.cycles);
+      time_start = runtime.sim.cycles;
+
       /* Each cycle has counter of mem_cycles; this value is joined with cycles
        * at the end of the cycle; no sim originated memory accesses should be
        * performed in between. */
       runtime.sim.mem_cycles = 0;
 
-      if (cpu_clock ())
+      if (cpu_dozing ())
+	{
+	  /* Nothing happens until the next scheduled job or the end of the
+	     run. */
+	  runtime.sim.mem_cycles = scheduler.job_queue->time;
+
+	  if ((duration >= 0.0) &&
+	      (runtime.sim.mem_cycles > runtime.sim.end_cycles -
+	       runtime.sim.cycles))
+	    {
+	      runtime.sim.mem_cycles = runtime.sim.end_cycles -
+		runtime.sim.cycles;
+	    }
+	}
+      else if (config.sim.quantum > 0)
+	{
+	  /* The batch does its own cycle accounting */
+	  if (cpu_quantum (duration < 0.0 ? -1 : runtime.sim.end_cycles))
+	    {
+	      return runtime.cpu.halted ? OR1KSIM_RC_HALTED : OR1KSIM_RC_BRKPT;
+	    }
+
+	  time_start = runtime.sim.cycles;
+	}
+      else if (cpu_clock ())
 	{
 	  /* This is probably wrong. This is an Or1ksim breakpoint, not a GNU
 	     one. */
@@ -249,6 +307,215 @@ or1ksim_run (double duration)
 }	/* or1ksim_run () */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Set up the instance mutex                                                 */
+/*---------------------------------------------------------------------------*/
+static void
+init_inst_mutex ()
+{
+  if (thrd_success != mtx_init (&inst_mutex, mtx_plain))
+    {
+      fprintf (stderr, "Unable to create simulator instance mutex\n");
+      exit (1);
+    }
+}	/* init_inst_mutex () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Make an instance current
+
+   The state of the current instance (if any) is saved, and that of the new
+   instance loaded. Nothing is done if it is already current. Must be called
+   with the instance mutex held.
+
+   @param[in] sim  The instance to make current                             */
+/*---------------------------------------------------------------------------*/
+static void
+switch_inst (struct or1ksim *sim)
+{
+  if (sim == cur_inst)
+    {
+      return;
+    }
+
+  if (NULL != cur_inst)
+    {
+      sim_state_save (cur_inst->state);
+    }
+
+  sim_state_load (sim->state);
+  cur_inst = sim;
+
+}	/* switch_inst () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Create a new simulator instance
+
+   Arguments are as for or1ksim_init(). The new instance is configured from
+   scratch, independently of any other instance, and is left current but
+   unlocked.
+
+   or1ksim_init() must not also be used in the same process, since the state
+   it sets up belongs to no instance.
+
+   @param[in] argc         Size of argument vector
+   @param[in] argv         Argument vector
+   @param[in] class_ptr    Pointer to a C++ class instance (for use when
+                           called by C++)
+   @param[in] upr          Upcall routine for reads
+   @param[in] upw          Upcall routine for writes
+
+   @return  The new instance, or NULL on failure                             */
+/*---------------------------------------------------------------------------*/
+struct or1ksim *
+or1ksim_new (int         argc,
+	     char       *argv[],
+	     void       *class_ptr,
+	     int       (*upr) (void              *class_ptr,
+			       unsigned long int  addr,
+			       unsigned char      mask[],
+			       unsigned char      rdata[],
+			       int                data_len),
+	     int       (*upw) (void              *class_ptr,
+			       unsigned long int  addr,
+			       unsigned char      mask[],
+			       unsigned char      wdata[],
+			       int                data_len))
+{
+  struct or1ksim *sim;
+
+  call_once (&inst_mutex_once, init_inst_mutex);
+  mtx_lock (&inst_mutex);
+
+  /* The first time through, record the state of an unconfigured simulator */
+  if (NULL == initial_state)
+    {
+      reg_sim_states ();
+
+      if (NULL == (initial_state = malloc (sim_state_size ())))
+	{
+	  fprintf (stderr, "Out-of-memory for simulator state\n");
+	  exit (1);
+	}
+
+      sim_state_save (initial_state);
+    }
+
+  sim = malloc (sizeof (struct or1ksim));
+
+  if ((NULL == sim) || (NULL == (sim->state = malloc (sim_state_size ()))))
+    {
+      fprintf (stderr, "Out-of-memory for simulator state\n");
+      exit (1);
+    }
+
+  /* Start from the unconfigured state */
+  memcpy (sim->state, initial_state, sim_state_size ());
+  switch_inst (sim);
+
+  if (OR1KSIM_RC_OK != or1ksim_init (argc, argv, class_ptr, upr, upw))
+    {
+      sim_state_load (initial_state);
+      cur_inst = NULL;
+      free (sim->state);
+      free (sim);
+      sim = NULL;
+    }
+
+  mtx_unlock (&inst_mutex);
+  return  sim;
+
+}	/* or1ksim_new () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Lock an instance and make it current
+
+   All the other library functions then act on this instance, until it is
+   unlocked. Only one instance may be locked at a time, so other threads
+   block here. Must not be called from an upcall.
+
+   @param[in] sim  The instance to lock                                      */
+/*---------------------------------------------------------------------------*/
+void
+or1ksim_lock (struct or1ksim *sim)
+{
+  mtx_lock (&inst_mutex);
+  switch_inst (sim);
+
+}	/* or1ksim_lock () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Unlock an instance
+
+   It stays current (so needs no reloading if locked again next), but
+   another thread may now lock a different instance.
+
+   @param[in] sim  The instance to unlock                                    */
+/*---------------------------------------------------------------------------*/
+void
+or1ksim_unlock (struct or1ksim *sim)
+{
+  mtx_unlock (&inst_mutex);
+
+}	/* or1ksim_unlock () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Run a simulator instance
+
+   As or1ksim_run(), with the instance locked for the duration.
+
+   @param[in] sim       The instance to run
+   @param[in] duration  Time to execute for (seconds)
+
+   @return  As for or1ksim_run()                                             */
+/*---------------------------------------------------------------------------*/
+int
+or1ksim_run_inst (struct or1ksim *sim,
+		  double          duration)
+{
+  int  rc;
+
+  or1ksim_lock (sim);
+  rc = or1ksim_run (duration);
+  or1ksim_unlock (sim);
+
+  return  rc;
+
+}	/* or1ksim_run_inst () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Destroy a simulator instance
+
+   The machine is closed down as by the standalone simulator on exit: its
+   log and profile files are closed, VAPI disconnected and its memories
+   released. The instance may not be used again. Must not be called with the
+   instance locked, nor from an upcall.
+
+   @param[in] sim  The instance to destroy                                   */
+/*---------------------------------------------------------------------------*/
+void
+or1ksim_destroy (struct or1ksim *sim)
+{
+  mtx_lock (&inst_mutex);
+  switch_inst (sim);
+  sim_close ();
+
+  /* Nothing is current until another instance is locked */
+  sim_state_load (initial_state);
+  cur_inst = NULL;
+
+  free (sim->state);
+  free (sim);
+  mtx_unlock (&inst_mutex);
+
+}	/* or1ksim_destroy () */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Reset the run-time simulation end point
 
@@ -732,3 +999,36 @@ or1ksim_set_stall_state (int  state)
   set_stall_state (state ? 1 : 0);
 
 }	/* or1ksim_set_stall_state () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Save a checkpoint of the simulated machine
+
+   @param[in] filename  The file to write
+
+   @return  Non-zero (TRUE) on success, zero (FALSE) otherwise.              */
+/*---------------------------------------------------------------------------*/
+int
+or1ksim_checkpoint_save (const char *filename)
+{
+  return  !checkpoint_save (filename);
+
+}	/* or1ksim_checkpoint_save () */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Restore a checkpoint of the simulated machine
+
+   The checkpoint must have been saved by the same simulator library, with the
+   same configuration. Otherwise the machine is left as it was.
+
+   @param[in] filename  The file to read
+
+   @return  Non-zero (TRUE) on success, zero (FALSE) otherwise.              */
+/*---------------------------------------------------------------------------*/
+int
+or1ksim_checkpoint_restore (const char *filename)
+{
+  return  !checkpoint_restore (filename);
+
+}	/* or1ksim_checkpoint_restore () */
@@ -32,9 +32,11 @@
 
 /* System includes */
 #include <stdlib.h>
+#include <string.h>
 
 /* Package includes */
 #include "dmmu.h"
+#include "abstract.h"
 #include "sim-config.h"
 #include "arch.h"
 #include "execute.h"
@@ -76,14 +78,197 @@ dmmu_find_tlbmr (oraddr_t virtaddr, uorreg_t ** dtlbmr_lru, struct dmmu *dmmu)
   return NULL;
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Update the DTLB LRU bits for a hit
+
+   All the ways of the set age by one, and the way hit is reloaded.
+
+   @param[in] dtlbmr      The DTLBMR hit
+   @param[in] dtlbmr_lru  The DTLBMR of way 0 in the same set
+   @param[in] dmmu        The DMMU                                           */
+/*---------------------------------------------------------------------------*/
+static void
+dmmu_update_lru (uorreg_t    *dtlbmr,
+		 uorreg_t    *dtlbmr_lru,
+		 struct dmmu *dmmu)
+{
+  int  i;
+
+  for (i = 0; i < dmmu->nways; i++, dtlbmr_lru += (128 * 2))
+    {
+      if (*dtlbmr_lru & SPR_DTLBMR_LRU)
+	*dtlbmr_lru = (*dtlbmr_lru & ~SPR_DTLBMR_LRU) |
+	  ((*dtlbmr_lru & SPR_DTLBMR_LRU) - 0x40);
+    }
+
+  /* This is not necessary `*dtlbmr &= ~SPR_DTLBMR_LRU;' since SPR_DTLBMR_LRU
+   * is always decremented and the number of sets is always a power of two and
+   * as such lru_reload has all bits set that get touched during decrementing
+   * SPR_DTLBMR_LRU */
+  *dtlbmr |= dmmu->lru_reload;
+
+}	/* dmmu_update_lru() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Bring the DTLB LRU bits up to date
+
+   Hits in the micro-TLB only count LRU updates while they are to the same
+   DTLBMR. They are applied here before anything else can see the LRU bits
+   or hit a different entry. The LRU field is two bits, so after four updates
+   in a row further ones change nothing.                                     */
+/*---------------------------------------------------------------------------*/
+void
+dmmu_sync_lru ()
+{
+  struct dmmu *dmmu = dmmu_state;
+  int          i;
+
+  if (!dmmu || (dmmu->lru_mr < 0))
+    {
+      return;
+    }
+
+  for (i = 0; (i < dmmu->lru_hits) && (i < 4); i++)
+    {
+      dmmu_update_lru (&cpu_state.sprs[dmmu->lru_mr],
+		       &cpu_state.sprs[SPR_DTLBMR_BASE (0) +
+				       (dmmu->lru_mr & 0x7f)], dmmu);
+    }
+
+  dmmu->lru_mr   = -1;
+  dmmu->lru_hits = 0;
+
+}	/* dmmu_sync_lru() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Forget all the micro-TLB translations
+
+   Called whenever a DTLB register or the SR is written. Pending LRU updates
+   are applied first, so the write sees them.                                */
+/*---------------------------------------------------------------------------*/
+void
+dmmu_flush_utlb ()
+{
+  struct dmmu *dmmu = dmmu_state;
+
+  if (!dmmu)
+    {
+      return;
+    }
+
+  dmmu_sync_lru ();
+  memset (dmmu->utlb, 0, sizeof (dmmu->utlb));
+
+}	/* dmmu_flush_utlb() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Refill the DTLB from the page table
+
+   Used on a DTLB miss when hardware reload is configured. DMMUCR[PTBP] is
+   the physical address of the first level table, which is indexed by bits
+   31:24 of the address. Its entries hold the (page aligned) physical address
+   of a second level table, indexed by page number within the 16MB region,
+   whose entries are DTLBTR values. Entries of either level are only used if
+   DMMU_PTE_V is set.
+
+   The way refilled is the first invalid one in the set, or else the least
+   recently used. The caller has already brought the LRU bits up to date.
+
+   @param[in] virtaddr    The address which missed
+   @param[in] dtlbmr_lru  The DTLBMR of way 0 in its set
+   @param[in] dmmu        The DMMU
+
+   @return  The DTLBMR refilled, or NULL if the page table has no entry      */
+/*---------------------------------------------------------------------------*/
+static uorreg_t *
+dmmu_walk (oraddr_t     virtaddr,
+	   uorreg_t    *dtlbmr_lru,
+	   struct dmmu *dmmu)
+{
+  oraddr_t   l1;
+  oraddr_t   pte;
+  uorreg_t  *dtlbmr;
+  int        i;
+
+  dmmu_stats.walks++;
+  runtime.sim.mem_cycles += dmmu->walkdelay;
+
+  l1 = eval_direct32 ((cpu_state.sprs[SPR_DMMUCR] & SPR_DMMUCR_PTBP) +
+		      ((virtaddr >> 24) << 2), 0, 0);
+
+  if (!(l1 & DMMU_PTE_V))
+    {
+      dmmu_stats.walk_misses++;
+      return  NULL;
+    }
+
+  pte = eval_direct32 ((l1 & dmmu->page_mask) +
+		       (((virtaddr & 0x00ffffff) >> dmmu->pagesize_log2) << 2),
+		       0, 0);
+
+  if (!(pte & DMMU_PTE_V))
+    {
+      dmmu_stats.walk_misses++;
+      return  NULL;
+    }
+
+  /* Choose a way, and forget any micro-TLB entries which might refer to it */
+  dtlbmr = dtlbmr_lru;
+
+  for (i = 0; i < dmmu->nways; i++)
+    {
+      uorreg_t *way = dtlbmr_lru + i * (128 * 2);
+
+      if (!(*way & SPR_DTLBMR_V))
+	{
+	  dtlbmr = way;
+	  break;
+	}
+      else if (!(*way & SPR_DTLBMR_LRU) && (*dtlbmr & SPR_DTLBMR_LRU))
+	{
+	  dtlbmr = way;
+	}
+    }
+
+  dmmu_flush_utlb ();
+
+  dtlbmr[0]   = (virtaddr & dmmu->page_mask) | SPR_DTLBMR_V;
+  dtlbmr[128] = (pte & dmmu->page_mask) |
+    (pte & (SPR_DTLBTR_CC | SPR_DTLBTR_CI | SPR_DTLBTR_WBC | SPR_DTLBTR_WOM |
+	    SPR_DTLBTR_A | SPR_DTLBTR_D | SPR_DTLBTR_URE | SPR_DTLBTR_UWE |
+	    SPR_DTLBTR_SRE | SPR_DTLBTR_SWE));
+
+  return  dtlbmr;
+
+}	/* dmmu_walk() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Translate a data address
+
+   Recently used translations are looked up in a micro-TLB first. An entry is
+   only made there once a translation has passed its access checks, so a hit
+   needs no checks and has no side effects beyond those of a DTLB hit. The LRU
+   update is deferred until it matters (see dmmu_sync_lru()).
+
+   @param[in] virtaddr      The effective address
+   @param[in] write_access  Non-zero for a store
+
+   @return  The physical address (undefined after an exception)              */
+/*---------------------------------------------------------------------------*/
 oraddr_t
 dmmu_translate (oraddr_t virtaddr, int write_access)
 {
-  int i;
   uorreg_t *dtlbmr;
   uorreg_t *dtlbtr;
   uorreg_t *dtlbmr_lru;
   struct dmmu *dmmu = dmmu_state;
+  struct dmmu_utlb *utlb;
+  oraddr_t vpage;
+  int refilled;
 
   if (!(cpu_state.sprs[SPR_SR] & SPR_SR_DME) ||
       !(cpu_state.sprs[SPR_UPR] & SPR_UPR_DMP))
@@ -92,28 +277,62 @@ dmmu_translate (oraddr_t virtaddr, int write_access)
       return virtaddr;
     }
 
+  vpage = virtaddr & dmmu->page_mask;
+  utlb  = &(dmmu->utlb[!!(cpu_state.sprs[SPR_SR] & SPR_SR_SM)]
+	    [!!write_access]
+	    [(virtaddr >> dmmu->pagesize_log2) & (DMMU_UTLB_SIZE - 1)]);
+
+  if (utlb->valid && (utlb->vpage == vpage))
+    {
+      dmmu_stats.loads_tlbhit++;
+
+      if (utlb->mr != dmmu->lru_mr)
+	{
+	  dmmu_sync_lru ();
+	  dmmu->lru_mr = utlb->mr;
+	}
+
+      dmmu->lru_hits++;
+      data_ci = utlb->ci;
+      runtime.sim.mem_cycles += dmmu->hitdelay;
+
+      return  utlb->ppage | (virtaddr & dmmu->page_offset_mask);
+    }
+
+  dmmu_sync_lru ();
   dtlbmr = dmmu_find_tlbmr (virtaddr, &dtlbmr_lru, dmmu);
 
+  /* If TLB refill is implemented in HW, a miss walks the page table and then
+     carries on as a hit on the new entry. */
+  refilled = 0;
+
+  if (!dtlbmr && dmmu->hw_walk)
+    {
+      dmmu_stats.loads_tlbmiss++;
+      runtime.sim.mem_cycles += dmmu->missdelay;
+
+      if (config.pcu.enabled)
+	pcu_count_event(SPR_PCMR_DTLBM);
+
+      if (NULL == (dtlbmr = dmmu_walk (virtaddr, dtlbmr_lru, dmmu)))
+	{
+	  except_handle (EXCEPT_DTLBMISS, virtaddr);
+	  return 0;
+	}
+
+      refilled = 1;
+    }
+
   /* Did we find our tlb entry? */
   if (dtlbmr)
     {				/* Yes, we did. */
-      dmmu_stats.loads_tlbhit++;
+      if (!refilled)
+	dmmu_stats.loads_tlbhit++;
 
       dtlbtr = dtlbmr + 128;
 
       /* Set LRUs */
-      for (i = 0; i < dmmu->nways; i++, dtlbmr_lru += (128 * 2))
-	{
-	  if (*dtlbmr_lru & SPR_DTLBMR_LRU)
-	    *dtlbmr_lru = (*dtlbmr_lru & ~SPR_DTLBMR_LRU) |
-	      ((*dtlbmr_lru & SPR_DTLBMR_LRU) - 0x40);
-	}
-
-      /* This is not necessary `*dtlbmr &= ~SPR_DTLBMR_LRU;' since SPR_DTLBMR_LRU
-       * is always decremented and the number of sets is always a power of two and
-       * as such lru_reload has all bits set that get touched during decrementing
-       * SPR_DTLBMR_LRU */
-      *dtlbmr |= dmmu->lru_reload;
+      dmmu_update_lru (dtlbmr, dtlbmr_lru, dmmu);
 
       /* Check if page is cache inhibited */
       data_ci = *dtlbtr & SPR_DTLBTR_CI;
@@ -125,15 +344,30 @@ dmmu_translate (oraddr_t virtaddr, int write_access)
 	{
 	  if ((write_access && !(*dtlbtr & SPR_DTLBTR_SWE))
 	      || (!write_access && !(*dtlbtr & SPR_DTLBTR_SRE)))
-	    except_handle (EXCEPT_DPF, virtaddr);
+	    {
+	      except_handle (EXCEPT_DPF, virtaddr);
+	      return (*dtlbtr & SPR_DTLBTR_PPN) | (virtaddr &
+						   (dmmu->page_offset_mask));
+	    }
 	}
       else
 	{
 	  if ((write_access && !(*dtlbtr & SPR_DTLBTR_UWE))
 	      || (!write_access && !(*dtlbtr & SPR_DTLBTR_URE)))
-	    except_handle (EXCEPT_DPF, virtaddr);
+	    {
+	      except_handle (EXCEPT_DPF, virtaddr);
+	      return (*dtlbtr & SPR_DTLBTR_PPN) | (virtaddr &
+						   (dmmu->page_offset_mask));
+	    }
 	}
 
+      /* Access allowed, so remember it */
+      utlb->valid = 1;
+      utlb->vpage = vpage;
+      utlb->ppage = *dtlbtr & SPR_DTLBTR_PPN;
+      utlb->ci    = *dtlbtr & SPR_DTLBTR_CI;
+      utlb->mr    = dtlbmr - cpu_state.sprs;
+
       return (*dtlbtr & SPR_DTLBTR_PPN) | (virtaddr &
 					   (dmmu->page_offset_mask));
     }
@@ -142,8 +376,6 @@ dmmu_translate (oraddr_t virtaddr, int write_access)
   dmmu_stats.loads_tlbmiss++;
 
   runtime.sim.mem_cycles += dmmu->missdelay;
-  /* if tlb refill implemented in HW */
-  /* return ((cpu_state.sprs[SPR_DTLBTR_BASE(minway) + set] & SPR_DTLBTR_PPN) >> 12) * dmmu->pagesize + (virtaddr % dmmu->pagesize); */
 
   except_handle (EXCEPT_DTLBMISS, virtaddr);
 
@@ -177,6 +409,7 @@ peek_into_dtlb (oraddr_t virtaddr, int write_access, int through_dc)
   uorreg_t *dtlbtr;
   uorreg_t *dtlbmr_lru;
   struct dmmu *dmmu = dmmu_state;
+  struct dmmu_utlb *utlb;
 
   if (!(cpu_state.sprs[SPR_SR] & SPR_SR_DME) ||
       !(cpu_state.sprs[SPR_UPR] & SPR_UPR_DMP))
@@ -186,6 +419,23 @@ peek_into_dtlb (oraddr_t virtaddr, int write_access, int through_dc)
       return virtaddr;
     }
 
+  /* Anything in the micro-TLB has already passed the same checks */
+  utlb = &(dmmu->utlb[!!(cpu_state.sprs[SPR_SR] & SPR_SR_SM)]
+	   [!!write_access]
+	   [(virtaddr >> dmmu->pagesize_log2) & (DMMU_UTLB_SIZE - 1)]);
+
+  if (utlb->valid && (utlb->vpage == (virtaddr & dmmu->page_mask)))
+    {
+      dmmu_stats.loads_tlbhit++;
+
+      if (through_dc)
+	{
+	  data_ci = utlb->ci;
+	}
+
+      return  utlb->ppage | (virtaddr & dmmu->page_offset_mask);
+    }
+
   dtlbmr = dmmu_find_tlbmr (virtaddr, &dtlbmr_lru, dmmu);
 
   /* Did we find our tlb entry? */
@@ -254,6 +504,8 @@ dtlb_status (void *dat)
       return;
     }
 
+  dmmu_sync_lru ();
+
   if (0 < end_set)
     PRINTF ("\nDMMU: ");
   /* Scan set(s) and way(s). */
@@ -456,6 +708,43 @@ dmmu_hitdelay (union param_val val, void *dat)
   dmmu->hitdelay = val.int_val;
 }
 
+
+/*---------------------------------------------------------------------------*/
+/*!Enable or disable hardware TLB reload
+
+   Set the corresponding flag in the DMMUCFGR
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure                                 */
+/*---------------------------------------------------------------------------*/
+static void
+dmmu_hw_walk (union param_val  val,
+	     void            *dat)
+{
+  struct dmmu *dmmu = dat;
+
+  if (val.int_val)
+    {
+      cpu_state.sprs[SPR_DMMUCFGR] |= SPR_DMMUCFGR_HTR;
+    }
+  else
+    {
+      cpu_state.sprs[SPR_DMMUCFGR] &= ~SPR_DMMUCFGR_HTR;
+    }
+
+  dmmu->hw_walk = val.int_val;
+
+}	/* dmmu_hw_walk() */
+
+
+static void
+dmmu_walkdelay (union param_val val, void *dat)
+{
+  struct dmmu *dmmu = dat;
+
+  dmmu->walkdelay = val.int_val;
+}
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize a new DMMU configuration
 
@@ -485,6 +774,12 @@ dmmu_start_sec ()
   dmmu->ustates   = 2;
   dmmu->hitdelay  = 1;
   dmmu->missdelay = 1;
+  dmmu->hw_walk   = 0;
+  dmmu->walkdelay = 2;
+  dmmu->lru_mr    = -1;
+  dmmu->lru_hits  = 0;
+
+  memset (dmmu->utlb, 0, sizeof (dmmu->utlb));
 
   if (dmmu->enabled)
     {
@@ -502,6 +797,7 @@ dmmu_start_sec ()
   way_bits = dmmu->nways - 1;
   cpu_state.sprs[SPR_DMMUCFGR] &= ~SPR_DMMUCFGR_NTW;
   cpu_state.sprs[SPR_DMMUCFGR] |= way_bits << SPR_DMMUCFGR_NTW_OFF;
+  cpu_state.sprs[SPR_DMMUCFGR] &= ~SPR_DMMUCFGR_HTR;
 
   dmmu_state = dmmu;
   return dmmu;
@@ -545,4 +841,6 @@ reg_dmmu_sec (void)
   reg_config_param (sec, "ustates",   PARAMT_INT, dmmu_ustates);
   reg_config_param (sec, "hitdelay",  PARAMT_INT, dmmu_hitdelay);
   reg_config_param (sec, "missdelay", PARAMT_INT, dmmu_missdelay);
+  reg_config_param (sec, "hw_walk",   PARAMT_INT, dmmu_hw_walk);
+  reg_config_param (sec, "walkdelay", PARAMT_INT, dmmu_walkdelay);
 }
@@ -30,6 +30,19 @@
 /* Package includes */
 #include "sim-config.h"
 
+/*! Number of entries in each DMMU micro-TLB. Must be a power of 2 */
+#define DMMU_UTLB_SIZE  8
+
+/*! A recently used DTLB translation, which has passed its access checks */
+struct dmmu_utlb
+{
+  int       valid;		/* Whether the entry may be used */
+  oraddr_t  vpage;		/* Virtual page */
+  oraddr_t  ppage;		/* Physical page */
+  uorreg_t  ci;			/* Cache inhibit bit of the DTLBTR */
+  int       mr;			/* SPR number of the matching DTLBMR */
+};
+
 struct dmmu
 {
   int       enabled;		/* Whether DMMU is enabled */
@@ -46,8 +59,18 @@ struct dmmu
   int       ustates;		/* number of DTLB usage states */
   int       missdelay;		/* How much cycles does the miss cost */
   int       hitdelay;		/* How much cycles does the hit cost */
+  int       hw_walk;		/* Whether misses walk the page table */
+  int       walkdelay;		/* How much cycles does a walk cost */
+
+  /* Micro-TLBs, by supervisor mode and write access */
+  struct dmmu_utlb  utlb[2][2][DMMU_UTLB_SIZE];
+  int       lru_mr;		/* DTLBMR with LRU updates pending, or -1 */
+  int       lru_hits;		/* Number of LRU updates pending */
 };
 
+/*! Valid bit in DMMU page table entries. Otherwise they are DTLBTR values */
+#define DMMU_PTE_V  0x00000400
+
 #define DADDR_PAGE(addr) ((addr) & dmmu_state->page_mask)
 
 /* FIXME: Remove the need for this global */
@@ -61,6 +84,8 @@ extern oraddr_t  dmmu_simulate_tlb (oraddr_t  virtaddr,
 extern oraddr_t  peek_into_dtlb (oraddr_t  virtaddr,
 				 int       write_access,
 				 int       through_dc);
+extern void      dmmu_sync_lru ();
+extern void      dmmu_flush_utlb ();
 extern void      reg_dmmu_sec ();
 
 #endif  /* DMMU__H */
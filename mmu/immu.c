@@ -29,9 +29,11 @@
 
 /* System includes */
 #include <stdlib.h>
+#include <string.h>
 
 /* Package includes */
 #include "immu.h"
+#include "abstract.h"
 #include "sim-config.h"
 #include "execute.h"
 #include "stats.h"
@@ -73,14 +75,190 @@ immu_find_tlbmr (oraddr_t virtaddr, uorreg_t ** itlbmr_lru, struct immu *immu)
   return NULL;
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Update the ITLB LRU bits for a hit
+
+   All the ways of the set age by one, and the way hit is reloaded.
+
+   @param[in] itlbmr      The ITLBMR hit
+   @param[in] itlbmr_lru  The ITLBMR of way 0 in the same set
+   @param[in] immu        The IMMU                                           */
+/*---------------------------------------------------------------------------*/
+static void
+immu_update_lru (uorreg_t    *itlbmr,
+		 uorreg_t    *itlbmr_lru,
+		 struct immu *immu)
+{
+  int  i;
+
+  for (i = 0; i < immu->nways; i++, itlbmr_lru += (128 * 2))
+    {
+      if (*itlbmr_lru & SPR_ITLBMR_LRU)
+	*itlbmr_lru = (*itlbmr_lru & ~SPR_ITLBMR_LRU) |
+	  ((*itlbmr_lru & SPR_ITLBMR_LRU) - 0x40);
+    }
+
+  /* This is not necessary `*itlbmr &= ~SPR_ITLBMR_LRU;' since SPR_DTLBMR_LRU
+   * is always decremented and the number of sets is always a power of two and
+   * as such lru_reload has all bits set that get touched during decrementing
+   * SPR_DTLBMR_LRU */
+  *itlbmr |= immu->lru_reload;
+
+}	/* immu_update_lru() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Bring the ITLB LRU bits up to date
+
+   As for the DMMU, micro-TLB hits on the same ITLBMR are counted and their
+   LRU updates applied together. Four in a row have the full effect.          */
+/*---------------------------------------------------------------------------*/
+void
+immu_sync_lru ()
+{
+  struct immu *immu = immu_state;
+  int          i;
+
+  if (!immu || (immu->lru_mr < 0))
+    {
+      return;
+    }
+
+  for (i = 0; (i < immu->lru_hits) && (i < 4); i++)
+    {
+      immu_update_lru (&cpu_state.sprs[immu->lru_mr],
+		       &cpu_state.sprs[SPR_ITLBMR_BASE (0) +
+				       (immu->lru_mr & 0x7f)], immu);
+    }
+
+  immu->lru_mr   = -1;
+  immu->lru_hits = 0;
+
+}	/* immu_sync_lru() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Forget all the micro-TLB translations
+
+   Called whenever an ITLB register or the SR is written.                    */
+/*---------------------------------------------------------------------------*/
+void
+immu_flush_utlb ()
+{
+  struct immu *immu = immu_state;
+
+  if (!immu)
+    {
+      return;
+    }
+
+  immu_sync_lru ();
+  memset (immu->utlb, 0, sizeof (immu->utlb));
+
+}	/* immu_flush_utlb() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Refill the ITLB from the page table
+
+   Used on a ITLB miss when hardware reload is configured. IMMUCR[PTBP] is
+   the physical address of the first level table, which is indexed by bits
+   31:24 of the address. Its entries hold the (page aligned) physical address
+   of a second level table, indexed by page number within the 16MB region,
+   whose entries are ITLBTR values. Entries of either level are only used if
+   IMMU_PTE_V is set.
+
+   The way refilled is the first invalid one in the set, or else the least
+   recently used. The caller has already brought the LRU bits up to date.
+
+   @param[in] virtaddr    The address which missed
+   @param[in] itlbmr_lru  The ITLBMR of way 0 in its set
+   @param[in] immu        The IMMU
+
+   @return  The ITLBMR refilled, or NULL if the page table has no entry      */
+/*---------------------------------------------------------------------------*/
+static uorreg_t *
+immu_walk (oraddr_t     virtaddr,
+	   uorreg_t    *itlbmr_lru,
+	   struct immu *immu)
+{
+  oraddr_t   l1;
+  oraddr_t   pte;
+  uorreg_t  *itlbmr;
+  int        i;
+
+  immu_stats.walks++;
+  runtime.sim.mem_cycles += immu->walkdelay;
+
+  l1 = eval_direct32 ((cpu_state.sprs[SPR_IMMUCR] & SPR_IMMUCR_PTBP) +
+		      ((virtaddr >> 24) << 2), 0, 0);
+
+  if (!(l1 & IMMU_PTE_V))
+    {
+      immu_stats.walk_misses++;
+      return  NULL;
+    }
+
+  pte = eval_direct32 ((l1 & immu->page_mask) +
+		       (((virtaddr & 0x00ffffff) >> immu->pagesize_log2) << 2),
+		       0, 0);
+
+  if (!(pte & IMMU_PTE_V))
+    {
+      immu_stats.walk_misses++;
+      return  NULL;
+    }
+
+  /* Choose a way, and forget any micro-TLB entries which might refer to it */
+  itlbmr = itlbmr_lru;
+
+  for (i = 0; i < immu->nways; i++)
+    {
+      uorreg_t *way = itlbmr_lru + i * (128 * 2);
+
+      if (!(*way & SPR_ITLBMR_V))
+	{
+	  itlbmr = way;
+	  break;
+	}
+      else if (!(*way & SPR_ITLBMR_LRU) && (*itlbmr & SPR_ITLBMR_LRU))
+	{
+	  itlbmr = way;
+	}
+    }
+
+  immu_flush_utlb ();
+
+  itlbmr[0]   = (virtaddr & immu->page_mask) | SPR_ITLBMR_V;
+  itlbmr[128] = (pte & immu->page_mask) |
+    (pte & (SPR_ITLBTR_CC | SPR_ITLBTR_CI | SPR_ITLBTR_WBC | SPR_ITLBTR_WOM |
+	    SPR_ITLBTR_A | SPR_ITLBTR_D | SPR_ITLBTR_SXE | SPR_ITLBTR_UXE));
+
+  return  itlbmr;
+
+}	/* immu_walk() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Translate an instruction address
+
+   Recently used translations which passed their execute permission check are
+   looked up in a micro-TLB first, as for the DMMU.
+
+   @param[in] virtaddr  The effective address
+
+   @return  The physical address (undefined after an exception)              */
+/*---------------------------------------------------------------------------*/
 oraddr_t
 immu_translate (oraddr_t virtaddr)
 {
-  int i;
   uorreg_t *itlbmr;
   uorreg_t *itlbtr;
   uorreg_t *itlbmr_lru;
   struct immu *immu = immu_state;
+  struct immu_utlb *utlb;
+  oraddr_t vpage;
+  int refilled;
 
   if (!(cpu_state.sprs[SPR_SR] & SPR_SR_IME) ||
       !(cpu_state.sprs[SPR_UPR] & SPR_UPR_IMP))
@@ -89,27 +267,60 @@ immu_translate (oraddr_t virtaddr)
       return virtaddr;
     }
 
+  vpage = virtaddr & immu->page_mask;
+  utlb  = &(immu->utlb[!!(cpu_state.sprs[SPR_SR] & SPR_SR_SM)]
+	    [(virtaddr >> immu->pagesize_log2) & (IMMU_UTLB_SIZE - 1)]);
+
+  if (utlb->valid && (utlb->vpage == vpage))
+    {
+      immu_stats.fetch_tlbhit++;
+
+      if (utlb->mr != immu->lru_mr)
+	{
+	  immu_sync_lru ();
+	  immu->lru_mr = utlb->mr;
+	}
+
+      immu->lru_hits++;
+      insn_ci = utlb->ci;
+      runtime.sim.mem_cycles += immu->hitdelay;
+
+      return  utlb->ppage | (virtaddr & immu->page_offset_mask);
+    }
+
+  immu_sync_lru ();
   itlbmr = immu_find_tlbmr (virtaddr, &itlbmr_lru, immu);
 
+  /* If TLB refill is implemented in HW, a miss walks the page table and then
+     carries on as a hit on the new entry. */
+  refilled = 0;
+
+  if (!itlbmr && immu->hw_walk)
+    {
+      immu_stats.fetch_tlbmiss++;
+      runtime.sim.mem_cycles += immu->missdelay;
+
+      if (config.pcu.enabled)
+	pcu_count_event(SPR_PCMR_ITLBM);
+
+      if (NULL == (itlbmr = immu_walk (virtaddr, itlbmr_lru, immu)))
+	{
+	  except_handle (EXCEPT_ITLBMISS, virtaddr);
+	  return 0;
+	}
+
+      refilled = 1;
+    }
+
   /* Did we find our tlb entry? */
   if (itlbmr)
     {				/* Yes, we did. */
-      immu_stats.fetch_tlbhit++;
+      if (!refilled)
+	immu_stats.fetch_tlbhit++;
       itlbtr = itlbmr + 128;
 
       /* Set LRUs */
-      for (i = 0; i < immu->nways; i++, itlbmr_lru += (128 * 2))
-	{
-	  if (*itlbmr_lru & SPR_ITLBMR_LRU)
-	    *itlbmr_lru = (*itlbmr_lru & ~SPR_ITLBMR_LRU) |
-	      ((*itlbmr_lru & SPR_ITLBMR_LRU) - 0x40);
-	}
-
-      /* This is not necessary `*itlbmr &= ~SPR_ITLBMR_LRU;' since SPR_DTLBMR_LRU
-       * is always decremented and the number of sets is always a power of two and
-       * as such lru_reload has all bits set that get touched during decrementing
-       * SPR_DTLBMR_LRU */
-      *itlbmr |= immu->lru_reload;
+      immu_update_lru (itlbmr, itlbmr_lru, immu);
 
       /* Check if page is cache inhibited */
       insn_ci = *itlbtr & SPR_ITLBTR_CI;
@@ -120,22 +331,35 @@ immu_translate (oraddr_t virtaddr)
       if (cpu_state.sprs[SPR_SR] & SPR_SR_SM)
 	{
 	  if (!(*itlbtr & SPR_ITLBTR_SXE))
-	    except_handle (EXCEPT_IPF, virtaddr);
+	    {
+	      except_handle (EXCEPT_IPF, virtaddr);
+	      return (*itlbtr & SPR_ITLBTR_PPN) |
+		(virtaddr & immu->page_offset_mask);
+	    }
 	}
       else
 	{
 	  if (!(*itlbtr & SPR_ITLBTR_UXE))
-	    except_handle (EXCEPT_IPF, virtaddr);
+	    {
+	      except_handle (EXCEPT_IPF, virtaddr);
+	      return (*itlbtr & SPR_ITLBTR_PPN) |
+		(virtaddr & immu->page_offset_mask);
+	    }
 	}
 
+      /* Execution allowed, so remember it */
+      utlb->valid = 1;
+      utlb->vpage = vpage;
+      utlb->ppage = *itlbtr & SPR_ITLBTR_PPN;
+      utlb->ci    = *itlbtr & SPR_ITLBTR_CI;
+      utlb->mr    = itlbmr - cpu_state.sprs;
+
       return (*itlbtr & SPR_ITLBTR_PPN) | (virtaddr & immu->page_offset_mask);
     }
 
   /* No, we didn't. */
   immu_stats.fetch_tlbmiss++;
 
-  /* if tlb refill implemented in HW */
-  /* return ((cpu_state.sprs[SPR_ITLBTR_BASE(minway) + set] & SPR_ITLBTR_PPN) >> 12) * immu->pagesize + (virtaddr % immu->pagesize); */
   runtime.sim.mem_cycles += immu->missdelay;
 
   except_handle (EXCEPT_ITLBMISS, virtaddr);
@@ -163,6 +387,7 @@ peek_into_itlb (oraddr_t virtaddr)
   uorreg_t *itlbtr;
   uorreg_t *itlbmr_lru;
   struct immu *immu = immu_state;
+  struct immu_utlb *utlb;
 
   if (!(cpu_state.sprs[SPR_SR] & SPR_SR_IME) ||
       !(cpu_state.sprs[SPR_UPR] & SPR_UPR_IMP))
@@ -170,6 +395,15 @@ peek_into_itlb (oraddr_t virtaddr)
       return (virtaddr);
     }
 
+  /* Anything in the micro-TLB has already passed the same checks */
+  utlb = &(immu->utlb[!!(cpu_state.sprs[SPR_SR] & SPR_SR_SM)]
+	   [(virtaddr >> immu->pagesize_log2) & (IMMU_UTLB_SIZE - 1)]);
+
+  if (utlb->valid && (utlb->vpage == (virtaddr & immu->page_mask)))
+    {
+      return  utlb->ppage | (virtaddr & immu->page_offset_mask);
+    }
+
   itlbmr = immu_find_tlbmr (virtaddr, &itlbmr_lru, immu);
 
   /* Did we find our tlb entry? */
@@ -230,6 +464,8 @@ itlb_status (void *dat)
       return;
     }
 
+  immu_sync_lru ();
+
   if (0 < end_set)
     PRINTF ("\nIMMU: ");
   /* Scan set(s) and way(s). */
@@ -431,6 +667,43 @@ immu_hitdelay (union param_val val, void *dat)
   immu->hitdelay = val.int_val;
 }
 
+
+/*---------------------------------------------------------------------------*/
+/*!Enable or disable hardware TLB reload
+
+   Set the corresponding flag in the IMMUCFGR
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure                                 */
+/*---------------------------------------------------------------------------*/
+static void
+immu_hw_walk (union param_val  val,
+	     void            *dat)
+{
+  struct immu *immu = dat;
+
+  if (val.int_val)
+    {
+      cpu_state.sprs[SPR_IMMUCFGR] |= SPR_IMMUCFGR_HTR;
+    }
+  else
+    {
+      cpu_state.sprs[SPR_IMMUCFGR] &= ~SPR_IMMUCFGR_HTR;
+    }
+
+  immu->hw_walk = val.int_val;
+
+}	/* immu_hw_walk() */
+
+
+static void
+immu_walkdelay (union param_val val, void *dat)
+{
+  struct immu *immu = dat;
+
+  immu->walkdelay = val.int_val;
+}
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize a new DMMU configuration
 
@@ -457,6 +730,12 @@ immu_start_sec ()
   immu->ustates   = 2;
   immu->hitdelay  = 1;
   immu->missdelay = 1;
+  immu->hw_walk   = 0;
+  immu->walkdelay = 2;
+  immu->lru_mr    = -1;
+  immu->lru_hits  = 0;
+
+  memset (immu->utlb, 0, sizeof (immu->utlb));
 
   if (immu->enabled)
     {
@@ -474,6 +753,7 @@ immu_start_sec ()
   way_bits = immu->nways - 1;
   cpu_state.sprs[SPR_IMMUCFGR] &= ~SPR_IMMUCFGR_NTW;
   cpu_state.sprs[SPR_IMMUCFGR] |= way_bits << SPR_IMMUCFGR_NTW_OFF;
+  cpu_state.sprs[SPR_IMMUCFGR] &= ~SPR_IMMUCFGR_HTR;
 
   immu_state = immu;
   return immu;
@@ -516,5 +796,7 @@ reg_immu_sec (void)
   reg_config_param (sec, "entrysize", PARAMT_INT, immu_entrysize);
   reg_config_param (sec, "ustates",   PARAMT_INT, immu_ustates);
   reg_config_param (sec, "missdelay", PARAMT_INT, immu_missdelay);
+  reg_config_param (sec, "hw_walk",   PARAMT_INT, immu_hw_walk);
+  reg_config_param (sec, "walkdelay", PARAMT_INT, immu_walkdelay);
   reg_config_param (sec, "hitdelay",  PARAMT_INT, immu_hitdelay);
 }
@@ -30,6 +30,19 @@
 /* Package includes */
 #include "sim-config.h"
 
+/*! Number of entries in each IMMU micro-TLB. Must be a power of 2 */
+#define IMMU_UTLB_SIZE  8
+
+/*! A recently used ITLB translation, which has passed its access checks */
+struct immu_utlb
+{
+  int       valid;		/* Whether the entry may be used */
+  oraddr_t  vpage;		/* Virtual page */
+  oraddr_t  ppage;		/* Physical page */
+  uorreg_t  ci;			/* Cache inhibit bit of the ITLBTR */
+  int       mr;			/* SPR number of the matching ITLBMR */
+};
+
 struct immu
 {
   int       enabled;		/* Whether IMMU is enabled */
@@ -46,8 +59,18 @@ struct immu
   int       ustates;		/* number of ITLB usage states */
   int       missdelay;		/* How much cycles does the miss cost */
   int       hitdelay;		/* How much cycles does the hit cost */
+  int       hw_walk;		/* Whether misses walk the page table */
+  int       walkdelay;		/* How much cycles does a walk cost */
+
+  /* Micro-TLBs, by supervisor mode */
+  struct immu_utlb  utlb[2][IMMU_UTLB_SIZE];
+  int       lru_mr;		/* ITLBMR with LRU updates pending, or -1 */
+  int       lru_hits;		/* Number of LRU updates pending */
 };
 
+/*! Valid bit in IMMU page table entries. Otherwise they are ITLBTR values */
+#define IMMU_PTE_V  0x00000400
+
 #define IADDR_PAGE(addr) ((addr) & immu_state->page_mask)
 
 /* FIXME: Remove the need for this global */
@@ -58,6 +81,8 @@ extern struct immu *immu_state;
 extern oraddr_t  immu_translate (oraddr_t virtaddr);
 extern oraddr_t  immu_simulate_tlb (oraddr_t virtaddr);
 extern oraddr_t  peek_into_itlb (oraddr_t virtaddr);
+extern void      immu_sync_lru ();
+extern void      immu_flush_utlb ();
 extern void      reg_immu_sec ();
 
 #endif /* IMMU__H */
@@ -41,6 +41,10 @@ enum  or1ksim_rc {
   OR1KSIM_RC_HALTED		/* Hit NOP_EXIT */
 };
 
+/* An opaque simulator instance */
+
+struct or1ksim;
+
 /* The interface methods */
 
 #ifdef __cplusplus
@@ -112,6 +116,41 @@ int  or1ksim_write_reg (int                regnum,
 
 void  or1ksim_set_stall_state (int  state);
 
+/* Checkpoints of the whole simulated machine */
+int  or1ksim_checkpoint_save (const char *filename);
+
+int  or1ksim_checkpoint_restore (const char *filename);
+
+/* Multiple instances. Each has the state of a complete simulated machine.
+   All the functions above act on the instance most recently locked, or on
+   the single implicit instance created by or1ksim_init(). Instances never
+   run concurrently: locking one waits until no other is locked, even when
+   they are driven from different threads. Each machine's state is copied in
+   and out of the simulator's globals when a different instance is locked,
+   so lock an instance for long stretches rather than call by call. */
+struct or1ksim *or1ksim_new (int         argc,
+			     char       *argv[],
+			     void       *class_ptr,
+			     int       (*upr) (void              *class_ptr,
+					       unsigned long int  addr,
+					       unsigned char      mask[],
+					       unsigned char      rdata[],
+					       int                data_len),
+			     int       (*upw) (void              *class_ptr,
+					       unsigned long int  addr,
+					       unsigned char      mask[],
+					       unsigned char      wdata[],
+					       int                data_len));
+
+void  or1ksim_lock (struct or1ksim *sim);
+
+void  or1ksim_unlock (struct or1ksim *sim);
+
+int  or1ksim_run_inst (struct or1ksim *sim,
+		       double          duration);
+
+void  or1ksim_destroy (struct or1ksim *sim);
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,6 +49,7 @@
 #include "channel.h"
 #include "abstract.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "sim-cmd.h"
 
 
@@ -1326,6 +1327,19 @@ uart_sec_end (void *dat)
 
   reg_sim_reset (uart_reset, dat);
   reg_sim_stat (uart_status, dat);
+
+  /* Everything up to the channel and configuration */
+  REG_CHECKPOINT (uart, offsetof (struct dev_16450, channel));
+  REG_CHECKPOINT_JOB (uart_char_clock);
+  REG_CHECKPOINT_JOB (uart_send_break);
+  REG_CHECKPOINT_JOB (uart_tx_send);
+  REG_CHECKPOINT_JOB (uart_int_cti);
+  REG_CHECKPOINT_JOB (uart_recv_break_start);
+  REG_CHECKPOINT_JOB (uart_recv_break_stop);
+  REG_CHECKPOINT_JOB (uart_recv_break);
+  REG_CHECKPOINT_JOB (uart_recv_char);
+  REG_CHECKPOINT_JOB (uart_check_char);
+  REG_CHECKPOINT_JOB (uart_vapi_cmd);
 }
 
 void
@@ -738,3 +738,14 @@ reg_ata_sec ()
   reg_config_param (sec, "mwdma",          PARAMT_INT, ata_mwdma);
   reg_config_param (sec, "pio",            PARAMT_INT, ata_pio);
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the ATA configuration state as simulator state                  */
+/*---------------------------------------------------------------------------*/
+void
+reg_ata_state ()
+{
+  reg_sim_state (&conf_dev, sizeof (conf_dev));
+
+}	/* reg_ata_state() */
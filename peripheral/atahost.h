@@ -184,5 +184,6 @@ void ata_int (void *dat);
 
 /* Prototypes for external use */
 void reg_ata_sec ();
+void reg_ata_state ();
 
 #endif /* ATAHOST__H */
@@ -35,6 +35,7 @@
 #include "abstract.h"
 #include "mc.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 
 #define XFER_READ8	0
 #define XFER_READ16	1
@@ -212,7 +213,7 @@ enum cfi_state
   SECURED_SILICON_SEC_EXIT
 };
 
-enum cfi_state current_state;
+static enum cfi_state current_state;
 
 struct mem_config
 {
@@ -435,6 +436,10 @@ cfi_memory_sec_end (void *dat)
   ops.write_dat8 = mem->mem;
 
   ops.log = mem->log;
+  ops.host_mem = NULL;
+  ops.prog_mem = NULL;
+  ops.host_touch = NULL;
+  ops.host_touch_dat = NULL;
 
   mema = reg_mem_area (mem->baseaddr, mem->size, 0, &ops);
 
@@ -445,6 +450,8 @@ cfi_memory_sec_end (void *dat)
   mc_reg_mem_area (mema, 0, 0);
 
   reg_sim_reset (mem_reset, dat);
+  REG_CHECKPOINT (mem->mem, mem->size);
+  REG_CHECKPOINT (&current_state, sizeof (current_state));
 
   current_state = UNKNOWN;
 }
@@ -662,3 +669,14 @@ state_machine_process (int xfer_type, int addr, int data_in, void *dat)
 
   return 0;
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the CFI flash command state as simulator state                  */
+/*---------------------------------------------------------------------------*/
+void
+reg_cfi_memory_state ()
+{
+  reg_sim_state (&current_state, sizeof (current_state));
+
+}	/* reg_cfi_memory_state() */
@@ -22,5 +22,6 @@
 #define CFI_FLASH__H
 
 extern void  reg_cfi_memory_sec ();
+extern void  reg_cfi_memory_state ();
 
 #endif  /* CFI_FLASH__H */
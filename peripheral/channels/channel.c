@@ -46,10 +46,11 @@ struct channel_factory
 {
   const char *name;
   const struct channel_ops *ops;
-  struct channel_factory *next;
+  const struct channel_factory *next;
 };
 
-static struct channel_factory preloaded[] = {
+/* The kinds of channel, fixed at build time, so shared by every machine */
+static const struct channel_factory preloaded[] = {
   {"fd",    &fd_channel_ops,    &preloaded[1]},
   {"file",  &file_channel_ops,  &preloaded[2]},
   {"xterm", &xterm_channel_ops, &preloaded[3]},
@@ -57,16 +58,16 @@ static struct channel_factory preloaded[] = {
   {"tty",   &tty_channel_ops,   NULL}
 };
 
-static struct channel_factory *head = &preloaded[0];
+static const struct channel_factory *const head = &preloaded[0];
 
 /* Forward declaration of static functions */
-static struct channel_factory *find_channel_factory (const char *name);
+static const struct channel_factory *find_channel_factory (const char *name);
 
 struct channel *
 channel_init (const char *descriptor)
 {
   struct channel *retval;
-  struct channel_factory *current;
+  const struct channel_factory *current;
   char *args, *name;
   int count;
 
@@ -179,10 +180,10 @@ channel_close (struct channel *channel)
     }
 }
 
-static struct channel_factory *
+static const struct channel_factory *
 find_channel_factory (const char *name)
 {
-  struct channel_factory *current = head;
+  const struct channel_factory *current = head;
 
   current = head;
   while (current && strcmp (current->name, name))
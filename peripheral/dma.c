@@ -583,6 +583,17 @@ dma_enabled (union param_val val, void *dat)
 }
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register the DMA controllers as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_dma_state ()
+{
+  reg_sim_state (&dmas, sizeof (dmas));
+
+}	/* reg_dma_state() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize a new DMA configuration
 
@@ -110,5 +110,6 @@ struct dma_channel *find_dma_controller_ch (unsigned controller,
 
 /* Prototype for external use */
 extern void  reg_dma_sec ();
+extern void  reg_dma_state ();
 
 #endif	/* DMA__H */
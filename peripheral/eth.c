@@ -58,6 +58,7 @@
 #include "pic.h"
 #include "sched.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "sim-cmd.h"
 
 #if HAVE_LINUX_IF_TUN_H==1
@@ -1989,6 +1990,14 @@ eth_sec_end (void *dat)
   reg_sim_stat (eth_status, dat);
   reg_sim_reset (eth_reset, dat);
 
+  /* Not the external interface's file names and handles */
+  REG_CHECKPOINT (eth, offsetof (struct eth_device, rxfile));
+  REG_CHECKPOINT (&eth->tx_bd_index,
+		  sizeof (struct eth_device) -
+		  offsetof (struct eth_device, tx_bd_index));
+  REG_CHECKPOINT_JOB (eth_controller_tx_clock);
+  REG_CHECKPOINT_JOB (eth_controller_rx_clock);
+
 }	/* eth_sec_end () */
 
 
@@ -38,6 +38,7 @@
 #include "abstract.h"
 #include "sched.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 
 
 #define FB_SIZEX           640
@@ -539,6 +540,8 @@ fb_sec_end (void *dat)
   reg_mem_area (fb->baseaddr, FB_PAL + 256 * 4, 0, &ops);
 
   reg_sim_reset (fb_reset, dat);
+  REG_CHECKPOINT (fb, offsetof (struct fb_state, filename));
+  REG_CHECKPOINT_JOB (fb_job);
 }
 
 void
@@ -39,6 +39,7 @@
 #include "pic.h"
 #include "abstract.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "sim-cmd.h"
 #include "gpio.h"
 
@@ -417,6 +418,9 @@ gpio_sec_end (void *dat)
 
   reg_sim_reset (gpio_reset, dat);
   reg_sim_stat (gpio_status, dat);
+  REG_CHECKPOINT (gpio, sizeof (struct gpio_device));
+  REG_CHECKPOINT_JOB (gpio_clock);
+  REG_CHECKPOINT_JOB (gpio_do_int);
 }
 
 void
@@ -47,6 +47,7 @@
 #include "abstract.h"
 #include "sim-config.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "sim-cmd.h"
 #include "mc.h"
 
@@ -389,6 +390,18 @@ mc_index (union param_val val, void *dat)
 }
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register the memory controllers as simulator state */
+/*---------------------------------------------------------------------------*/
+void
+reg_mc_state ()
+{
+  reg_sim_state (&mcs, sizeof (mcs));
+  reg_sim_state (&mc_areas, sizeof (mc_areas));
+
+}	/* reg_mc_state() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Initialize a new memory controller configuration
 
@@ -446,6 +459,7 @@ mc_sec_end (void *dat)
   reg_mem_area (mc->baseaddr, MC_ADDR_SPACE, 1, &ops);
   reg_sim_reset (mc_reset, dat);
   reg_sim_stat (mc_status, dat);
+  REG_CHECKPOINT (mc, offsetof (struct mc, index));
 }
 
 void
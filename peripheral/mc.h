@@ -40,5 +40,6 @@ extern void  reg_mc_sec ();
 extern void  mc_reg_mem_area (struct dev_memarea *mem,
 			      unsigned int        cs,
 			      int                 mc);
+extern void  reg_mc_state ();
 
 #endif /* MC__H */
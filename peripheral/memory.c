@@ -33,6 +33,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* Package includes */
 #include "arch.h"
@@ -40,6 +46,7 @@
 #include "abstract.h"
 #include "mc.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 
 
 struct mem_config
@@ -53,12 +60,21 @@ struct mem_config
   int delayr;			/* Read cycles */
   int delayw;			/* Write cycles */
 
-  void *mem;			/* malloced memory for this memory */
+  void *mem;			/* mapped memory for this memory */
+  char *file;			/* Host file mapped as the memory, or NULL */
+  enum
+  {
+    MM_PRIVATE,			/* Changes are private to the simulator */
+    MM_SHARED			/* Changes are written to the file */
+  } mmap;
 
   int pattern;			/* A user specified memory initialization
 				 * pattern */
   int random_seed;		/* Initialize the memory with random values,
 				 * starting with seed */
+  unsigned long lazy_seed;	/* Seed of the random values since reset */
+  uint32_t *unfilled;		/* Pages not yet filled since reset, for
+				 * memory filled on first touch, else NULL */
   enum
   {
     MT_UNKNOWN,
@@ -68,6 +84,20 @@ struct mem_config
   } type;
 };
 
+/*! Size of the pages in which memory is filled on first touch. Fixed, rather
+    than the host page size, so that random values do not depend on the
+    host. */
+#define MEM_FILL_BITS  12
+#define MEM_FILL_SIZE  (1 << MEM_FILL_BITS)
+
+/*! Bytes in the bitmap of unfilled pages of a memory */
+#define MEM_UNFILLED_BYTES(mem)						\
+  (((((mem)->size + MEM_FILL_SIZE - 1) >> MEM_FILL_BITS) + 31) / 32 *	\
+   sizeof (uint32_t))
+
+static void  mem_fill_page (struct mem_config *mem,
+			    oraddr_t           page);
+
 static uint32_t
 simmem_read32 (oraddr_t addr, void *dat)
 {
@@ -120,6 +150,85 @@ simmem_write8 (oraddr_t addr, uint8_t value, void *dat)
 #endif
 }
 
+/*! Fill the page holding an address, if it has not been filled since reset */
+static inline void
+mem_touch (struct mem_config *mem, oraddr_t addr)
+{
+  oraddr_t page = addr >> MEM_FILL_BITS;
+
+  if (mem->unfilled[page / 32] & (1u << (page % 32)))
+    mem_fill_page (mem, page);
+}
+
+/* Read and write functions for memory filled on first touch. Their data is
+   the memory configuration. */
+static uint32_t
+simmem_lazy_read32 (oraddr_t addr, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  return simmem_read32 (addr, mem->mem);
+}
+
+static uint16_t
+simmem_lazy_read16 (oraddr_t addr, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  return simmem_read16 (addr, mem->mem);
+}
+
+static uint8_t
+simmem_lazy_read8 (oraddr_t addr, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  return simmem_read8 (addr, mem->mem);
+}
+
+static void
+simmem_lazy_write32 (oraddr_t addr, uint32_t value, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  simmem_write32 (addr, value, mem->mem);
+}
+
+static void
+simmem_lazy_write16 (oraddr_t addr, uint16_t value, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  simmem_write16 (addr, value, mem->mem);
+}
+
+static void
+simmem_lazy_write8 (oraddr_t addr, uint8_t value, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  mem_touch (mem, addr);
+  simmem_write8 (addr, value, mem->mem);
+}
+
+/* Fill the pages of part of a memory filled on first touch, before the CPU or
+   the program loader goes to it directly. */
+static void
+simmem_lazy_touch (uint32_t offset, uint32_t len, void *dat)
+{
+  struct mem_config *mem = dat;
+  oraddr_t           addr;
+
+  for (addr = offset & ~(MEM_FILL_SIZE - 1); addr < offset + len;
+       addr += MEM_FILL_SIZE)
+    mem_touch (mem, addr);
+}
+
 static uint32_t
 simmem_read_zero32 (oraddr_t addr, void *dat)
 {
@@ -177,43 +286,128 @@ simmem_write_null8 (oraddr_t addr, uint8_t value, void *dat)
 	     "memory area (value 0x%08" PRIx8 ").\n", addr, value);
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Map the host file backing a memory
+
+   The file holds the memory as 32-bit words in host byte order, as the memory
+   is held in the simulator. Nothing is read up front: the host pages the file
+   in as it is touched, and simulators mapping the same file share the page
+   cache.
+
+   A private mapping is copy-on-write, so the file is never changed. Any part
+   of the memory beyond the end of the file reads as zero. A shared mapping
+   writes changes back to the file, which is created or extended to the size
+   of the memory if need be.
+
+   Called first with mem->mem NULL, to choose the address of the memory. A
+   private mapping is mapped again at the same address on each reset, so that
+   reset discards any changes.
+
+   @param[in] mem  The memory configuration                                  */
+/*---------------------------------------------------------------------------*/
 static void
-mem_reset (void *dat)
+mem_map_file (struct mem_config *mem)
 {
-  struct mem_config *mem = dat;
-  int seed;
-  int i;
-  uint8_t *mem_area = mem->mem;
+  int          fd;
+  struct stat  st;
+  void        *addr;
+  int          fixed = (NULL == mem->mem) ? 0 : MAP_FIXED;
 
-  /* Initialize memory */
-  switch (mem->type)
+  fd = (MM_SHARED == mem->mmap) ? open (mem->file, O_RDWR | O_CREAT, 0666) :
+    open (mem->file, O_RDONLY);
+
+  if ((fd < 0) || (fstat (fd, &st) < 0))
     {
-    case MT_RANDOM:
-      if (mem->random_seed == -1)
+      fprintf (stderr, "ERROR: Unable to open memory file %s: %s\n",
+	       mem->file, strerror (errno));
+      exit (1);
+    }
+
+  if (MM_SHARED == mem->mmap)
+    {
+      if ((st.st_size < mem->size) && (ftruncate (fd, mem->size) < 0))
 	{
-	  /* seed = time (NULL); */
-	  /* srandom (seed); */
-	  /* /\* Print out the seed just in case we ever need to debug *\/ */
-	  /* PRINTF ("Seeding random generator with value %d\n", seed); */
+	  fprintf (stderr, "ERROR: Unable to extend memory file %s: %s\n",
+		   mem->file, strerror (errno));
+	  exit (1);
 	}
-      else
+
+      addr = mmap (mem->mem, mem->size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | fixed, fd, 0);
+    }
+  else
+    {
+      /* Anonymous (zero) memory, with as much of the file as there is mapped
+	 over its start. */
+      size_t  len = (st.st_size < mem->size) ? st.st_size : mem->size;
+
+      addr = mmap (mem->mem, mem->size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | fixed, -1, 0);
+
+      if ((MAP_FAILED != addr) && (len > 0) &&
+	  (MAP_FAILED == mmap (addr, len, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_FIXED, fd, 0)))
 	{
-	  seed = mem->random_seed;
-	  srandom (seed);
+	  addr = MAP_FAILED;
 	}
+    }
+
+  if (MAP_FAILED == addr)
+    {
+      fprintf (stderr, "ERROR: Unable to map memory file %s: %s\n",
+	       mem->file, strerror (errno));
+      exit (1);
+    }
+
+  close (fd);
+  mem->mem = addr;
+
+}	/* mem_map_file() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Fill a page of a memory with its initial values
+
+   Random values are generated afresh for each page, from the memory's seed
+   and the offset of the page, so the values do not depend on the order in
+   which pages are touched.
+
+   @param[in] mem   The memory configuration
+   @param[in] page  The page number in the memory                            */
+/*---------------------------------------------------------------------------*/
+static void
+mem_fill_page (struct mem_config *mem,
+	       oraddr_t           page)
+{
+  size_t    offset   = (size_t) page << MEM_FILL_BITS;
+  size_t    len      = mem->size - offset;
+  uint8_t  *mem_area = (uint8_t *) mem->mem + offset;
+  uint64_t  x;
+  size_t    i;
 
-      for (i = 0; i < mem->size; i++, mem_area++)
-	*mem_area = random () & 0xFF;
+  mem->unfilled[page / 32] &= ~(1u << (page % 32));
+  len = (len < MEM_FILL_SIZE) ? len : MEM_FILL_SIZE;
+
+  switch (mem->type)
+    {
+    case MT_RANDOM:
+      /* xorshift64, seeded from the page */
+      x = ((uint64_t) mem->lazy_seed << 32) ^ offset ^ 0x9e3779b97f4a7c15ULL;
+
+      for (i = 0; i < len; i++, mem_area++)
+	{
+	  x ^= x << 13;
+	  x ^= x >> 7;
+	  x ^= x << 17;
+	  *mem_area = x & 0xff;
+	}
       break;
     case MT_PATTERN:
-      for (i = 0; i < mem->size; i++, mem_area++)
-	*mem_area = mem->pattern;
-      break;
-    case MT_UNKNOWN:
+      memset (mem_area, mem->pattern, len);
       break;
     case MT_EXITNOPS:
       /* Fill memory with OR1K exit NOP */
-      for (i = 0; i < mem->size; i++, mem_area++)
+      for (i = 0; i < len; i++, mem_area++)
 	switch(i & 0x3) {
 	case 3:
 	  *mem_area = 0x15;
@@ -226,11 +420,130 @@ mem_reset (void *dat)
 	  break;
 	}
       break;
+    default:
+      break;
+    }
+}	/* mem_fill_page() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Allocate the host memory for a memory
+
+   The memory is mapped anonymously, without reserving swap, so the host only
+   provides pages as they are touched, and a large memory costs only what the
+   program uses. A memory which is not all zero after reset is filled a page
+   at a time, on the first access to each page, and has a bitmap of the pages
+   not yet filled.
+
+   @param[in] mem  The memory configuration                                  */
+/*---------------------------------------------------------------------------*/
+static void
+mem_alloc (struct mem_config *mem)
+{
+  mem->mem = mmap (NULL, mem->size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (MAP_FAILED == mem->mem)
+    {
+      fprintf (stderr,
+	       "Unable to allocate memory at %" PRIxADDR ", length %i\n",
+	       mem->baseaddr, mem->size);
+      exit (-1);
+    }
+
+  if ((MT_RANDOM == mem->type) || (MT_EXITNOPS == mem->type) ||
+      ((MT_PATTERN == mem->type) && (0 != mem->pattern)))
+    {
+      mem->unfilled = malloc (MEM_UNFILLED_BYTES (mem));
+
+      if (NULL == mem->unfilled)
+	{
+	  fprintf (stderr, "Out-of-memory\n");
+	  exit (-1);
+	}
+
+      memset (mem->unfilled, 0xff, MEM_UNFILLED_BYTES (mem));
+    }
+}	/* mem_alloc() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Reset a memory
+
+   A memory filled on first touch has all its pages discarded and marked as
+   unfilled again, so reset costs only the pages which were touched. A zero
+   memory just has its pages discarded. Unknown memory is left alone,
+   and a private file is mapped again.
+
+   @param[in] dat  The memory configuration                                  */
+/*---------------------------------------------------------------------------*/
+static void
+mem_reset (void *dat)
+{
+  struct mem_config *mem = dat;
+
+  /* Memory backed by a file starts with the file's contents */
+  if (NULL != mem->file)
+    {
+      if (MM_PRIVATE == mem->mmap)
+	{
+	  mem_map_file (mem);
+	}
+
+      return;
+    }
+
+  switch (mem->type)
+    {
+    case MT_RANDOM:
+      /* Without a seed of its own, take one from the simulator's random
+	 numbers, seeded at startup. */
+      mem->lazy_seed = (-1 == mem->random_seed) ? random () : mem->random_seed;
+      /* Fall through */
+    case MT_PATTERN:
+    case MT_EXITNOPS:
+      madvise (mem->mem, mem->size, MADV_DONTNEED);
+
+      if (NULL != mem->unfilled)
+	{
+	  memset (mem->unfilled, 0xff, MEM_UNFILLED_BYTES (mem));
+
+	  /* Nothing may go on using the old pages directly */
+	  mem_map_changed ();
+	}
+      break;
+    case MT_UNKNOWN:
+      break;
     default:
       fprintf (stderr, "Invalid memory configuration type.\n");
       exit (1);
     }
-}
+}	/* mem_reset() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Release a memory
+
+   The pages are unmapped (so a shared file gets the last changes) and the
+   bitmap of unfilled pages freed.
+
+   @param[in] dat  The memory configuration                                  */
+/*---------------------------------------------------------------------------*/
+static void
+mem_done (void *dat)
+{
+  struct mem_config *mem = dat;
+
+  if ((NULL != mem->mem) && (MAP_FAILED != mem->mem))
+    {
+      munmap (mem->mem, mem->size);
+      mem->mem = NULL;
+    }
+
+  free (mem->unfilled);
+  mem->unfilled = NULL;
+
+}	/* mem_done() */
 
 /*-------------------------------------------------[ Memory configuration ]---*/
 static void
@@ -355,6 +668,56 @@ memory_log (union param_val val, void *dat)
   mem->log = strdup (val.str_val);
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Set the host file backing the memory
+
+   @param[in] val  The file name
+   @param[in] dat  The config data structure                                 */
+/*---------------------------------------------------------------------------*/
+static void
+memory_file (union param_val val, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  if (NULL != mem->file)
+    {
+      free (mem->file);
+    }
+
+  mem->file = strdup (val.str_val);
+
+}	/* memory_file() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Set how the host file backing the memory is mapped
+
+   Value must be private or shared (case insensitive). Unrecognized values
+   are ignored with a warning.
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure                                 */
+/*---------------------------------------------------------------------------*/
+static void
+memory_mmap (union param_val val, void *dat)
+{
+  struct mem_config *mem = dat;
+
+  if (0 == strcasecmp (val.str_val, "private"))
+    {
+      mem->mmap = MM_PRIVATE;
+    }
+  else if (0 == strcasecmp (val.str_val, "shared"))
+    {
+      mem->mmap = MM_SHARED;
+    }
+  else
+    {
+      fprintf (stderr, "Warning: memory mmap invalid. Ignored\n");
+    }
+}	/* memory_mmap() */
+
+
 static void
 memory_delayr (union param_val val, void *dat)
 {
@@ -398,6 +761,10 @@ memory_sec_start ()
   mem->delayr = 1;
   mem->delayw = 1;
   mem->log = NULL;
+  mem->file = NULL;
+  mem->mmap = MM_PRIVATE;
+  mem->lazy_seed = 0;
+  mem->unfilled = NULL;
 
   return mem;
 
@@ -425,12 +792,14 @@ memory_sec_end (void *dat)
       mem->size += 4;
     }
 
-  if (!(mem->mem = malloc (mem->size)))
+  if (NULL != mem->file)
     {
-      fprintf (stderr,
-	       "Unable to allocate memory at %" PRIxADDR ", length %i\n",
-	       mem->baseaddr, mem->size);
-      exit (-1);
+      mem->mem = NULL;
+      mem_map_file (mem);
+    }
+  else
+    {
+      mem_alloc (mem);
     }
 
   if (mem->delayr > 0)
@@ -472,11 +841,66 @@ memory_sec_end (void *dat)
   ops.write_dat16 = mem->mem;
   ops.write_dat8 = mem->mem;
 
+  /* Memory filled on first touch fills each page on the first access to it,
+     or before the CPU or the program loader go to it directly. */
+  if (NULL != mem->unfilled)
+    {
+      if (mem->delayr > 0)
+	{
+	  ops.readfunc32 = simmem_lazy_read32;
+	  ops.readfunc16 = simmem_lazy_read16;
+	  ops.readfunc8 = simmem_lazy_read8;
+	}
+
+      if (mem->delayw > 0)
+	{
+	  ops.writefunc32 = simmem_lazy_write32;
+	  ops.writefunc16 = simmem_lazy_write16;
+	  ops.writefunc8 = simmem_lazy_write8;
+	}
+
+      ops.writeprog8 = simmem_lazy_write8;
+      ops.writeprog32 = simmem_lazy_write32;
+      ops.writeprog8_dat = mem;
+      ops.writeprog32_dat = mem;
+
+      ops.read_dat32 = mem;
+      ops.read_dat16 = mem;
+      ops.read_dat8 = mem;
+
+      ops.write_dat32 = mem;
+      ops.write_dat16 = mem;
+      ops.write_dat8 = mem;
+
+      ops.host_touch = simmem_lazy_touch;
+      ops.host_touch_dat = mem;
+    }
+  else
+    {
+      ops.host_touch = NULL;
+      ops.host_touch_dat = NULL;
+    }
+
   ops.delayr = mem->delayr;
   ops.delayw = mem->delayw;
 
   ops.log = mem->log;
 
+  /* Readable and writable memory filling its whole (power of 2) area may be
+     accessed directly by the CPU. */
+  if ((mem->delayr > 0) && (mem->delayw > 0) &&
+      (0 == (mem->size & (mem->size - 1))))
+    {
+      ops.host_mem = mem->mem;
+    }
+  else
+    {
+      ops.host_mem = NULL;
+    }
+
+  /* Likewise the program loader, even if the CPU may not write it */
+  ops.prog_mem = (0 == (mem->size & (mem->size - 1))) ? mem->mem : NULL;
+
   mema = reg_mem_area (mem->baseaddr, mem->size, 0, &ops);
 
   /* Set valid */
@@ -487,6 +911,14 @@ memory_sec_end (void *dat)
     mc_reg_mem_area (mema, mem->ce, mem->mc);
 
   reg_sim_reset (mem_reset, dat);
+  reg_sim_done (mem_done, dat);
+  REG_CHECKPOINT (mem->mem, mem->size);
+
+  if (NULL != mem->unfilled)
+    {
+      REG_CHECKPOINT (&mem->lazy_seed, sizeof (mem->lazy_seed));
+      REG_CHECKPOINT (mem->unfilled, MEM_UNFILLED_BYTES (mem));
+    }
 }
 
 void
@@ -506,4 +938,6 @@ reg_memory_sec (void)
   reg_config_param (sec, "delayr",      PARAMT_INT, memory_delayr);
   reg_config_param (sec, "delayw",      PARAMT_INT, memory_delayw);
   reg_config_param (sec, "log",         PARAMT_STR, memory_log);
+  reg_config_param (sec, "file",        PARAMT_STR, memory_file);
+  reg_config_param (sec, "mmap",        PARAMT_WORD, memory_mmap);
 }
@@ -0,0 +1,234 @@
+/* ompic.c -- Multi-core inter-processor interrupt controller
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* This program is commented throughout in a fashion suitable for processing
+   with Doxygen. */
+
+
+/* The OpenRISC multi-core inter-processor interrupt controller (OMPIC), as
+   used by Linux for SMP. Each core has a control and a status register. A
+   core interrupts another by writing the other's number, some data and the
+   generate bit to its own control register. The interrupt is raised on the
+   same PIC line of every core, and held until the core interrupted writes
+   the acknowledge bit to its own control register. */
+
+/* Autoconf and/or portability configuration */
+#include "config.h"
+#include "port.h"
+
+/* System includes */
+#include <stdlib.h>
+
+/* Package includes */
+#include "sim-config.h"
+#include "arch.h"
+#include "abstract.h"
+#include "toplevel-support.h"
+#include "checkpoint.h"
+#include "sim-cmd.h"
+#include "ompic.h"
+
+
+/*
+ * Implementation of OMPIC registers and state
+ */
+struct ompic_device
+{
+  /* Is peripheral enabled */
+  int enabled;
+
+  /* Base address in memory */
+  oraddr_t baseaddr;
+
+  /* Which IRQ to generate */
+  int irq;
+
+  /* Visible registers of each core */
+  uint32_t ctrl[MAX_CORES];
+  uint32_t stat[MAX_CORES];
+};
+
+
+/* Initialize all parameters and state */
+static void
+ompic_reset (void *dat)
+{
+  struct ompic_device *ompic = dat;
+
+  memset (ompic->ctrl, 0, sizeof (ompic->ctrl));
+  memset (ompic->stat, 0, sizeof (ompic->stat));
+}
+
+
+/* Dump status */
+static void
+ompic_status (void *dat)
+{
+  struct ompic_device *ompic = dat;
+  int cpu;
+
+  PRINTF ("\nOMPIC at 0x%" PRIxADDR ":\n", ompic->baseaddr);
+
+  for (cpu = 0; cpu < config.cpu.cores; cpu++)
+    {
+      PRINTF ("Core %2d CTRL : 0x%08" PRIx32 "  STAT : 0x%08" PRIx32 "\n",
+	      cpu, ompic->ctrl[cpu], ompic->stat[cpu]);
+    }
+}
+
+
+/* Wishbone read */
+static uint32_t
+ompic_read32 (oraddr_t addr, void *dat)
+{
+  struct ompic_device *ompic = dat;
+  int cpu = addr / OMPIC_CPUBYTES;
+
+  if (cpu >= config.cpu.cores)
+    return 0;
+
+  if (addr == OMPIC_CTRL (cpu))
+    return ompic->ctrl[cpu];
+  else
+    return ompic->stat[cpu];
+}
+
+
+/* Wishbone write. Only the control registers may be written. A core's own
+   interrupt is acknowledged before another core is interrupted, so a core may
+   do both at once. */
+static void
+ompic_write32 (oraddr_t addr, uint32_t value, void *dat)
+{
+  struct ompic_device *ompic = dat;
+  int cpu = addr / OMPIC_CPUBYTES;
+  int dst;
+
+  if ((cpu >= config.cpu.cores) || (addr != OMPIC_CTRL (cpu)))
+    return;
+
+  ompic->ctrl[cpu] = value;
+
+  if (value & OMPIC_CTRL_IRQ_ACK)
+    {
+      if (ompic->stat[cpu] & OMPIC_STAT_IRQ_PENDING)
+	smp_clear_interrupt (cpu, ompic->irq);
+
+      ompic->stat[cpu] &= ~OMPIC_STAT_IRQ_PENDING;
+    }
+
+  if (value & OMPIC_CTRL_IRQ_GEN)
+    {
+      dst = (value >> OMPIC_CTRL_DST_OFF) & OMPIC_CTRL_DST_MASK;
+
+      if (dst >= config.cpu.cores)
+	return;
+
+      /* Interrupts not yet acknowledged are merged */
+      if (!(ompic->stat[dst] & OMPIC_STAT_IRQ_PENDING))
+	smp_report_interrupt (dst, ompic->irq);
+
+      ompic->stat[dst] = OMPIC_STAT_IRQ_PENDING |
+	(cpu << OMPIC_STAT_SRC_OFF) | (value & OMPIC_DATA_MASK);
+    }
+}
+
+
+/*--------------------------------------------------[ OMPIC configuration ]---*/
+static void
+ompic_baseaddr (union param_val val, void *dat)
+{
+  struct ompic_device *ompic = dat;
+  ompic->baseaddr = val.addr_val;
+}
+
+static void
+ompic_irq (union param_val val, void *dat)
+{
+  struct ompic_device *ompic = dat;
+  ompic->irq = val.int_val;
+}
+
+static void
+ompic_enabled (union param_val val, void *dat)
+{
+  struct ompic_device *ompic = dat;
+  ompic->enabled = val.int_val;
+}
+
+static void *
+ompic_sec_start (void)
+{
+  struct ompic_device *new = malloc (sizeof (struct ompic_device));
+
+  if (!new)
+    {
+      fprintf (stderr, "Peripheral ompic: Run out of memory\n");
+      exit (-1);
+    }
+
+  memset (new, 0, sizeof (struct ompic_device));
+
+  new->enabled = 1;
+  new->baseaddr = 0;
+  new->irq = 0;
+
+  return new;
+}
+
+static void
+ompic_sec_end (void *dat)
+{
+  struct ompic_device *ompic = dat;
+  struct mem_ops ops;
+
+  if (!ompic->enabled)
+    {
+      free (dat);
+      return;
+    }
+
+  memset (&ops, 0, sizeof (struct mem_ops));
+
+  ops.readfunc32 = ompic_read32;
+  ops.writefunc32 = ompic_write32;
+  ops.write_dat32 = dat;
+  ops.read_dat32 = dat;
+
+  ops.delayr = 1;
+  ops.delayw = 1;
+
+  /* Register memory range */
+  reg_mem_area (ompic->baseaddr, OMPIC_ADDR_SPACE, 0, &ops);
+
+  reg_sim_reset (ompic_reset, dat);
+  reg_sim_stat (ompic_status, dat);
+  REG_CHECKPOINT (ompic, sizeof (struct ompic_device));
+}
+
+void
+reg_ompic_sec (void)
+{
+  struct config_section *sec =
+    reg_config_sec ("ompic", ompic_sec_start, ompic_sec_end);
+
+  reg_config_param (sec, "enabled",  PARAMT_INT, ompic_enabled);
+  reg_config_param (sec, "baseaddr", PARAMT_ADDR, ompic_baseaddr);
+  reg_config_param (sec, "irq",      PARAMT_INT, ompic_irq);
+}
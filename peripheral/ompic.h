@@ -0,0 +1,55 @@
+/* ompic.h -- Multi-core inter-processor interrupt controller definitions
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* This program is commented throughout in a fashion suitable for processing
+   with Doxygen. */
+
+
+#ifndef OMPIC__H
+#define OMPIC__H
+
+
+/* Constants also used by testbench */
+
+/* Each core has a control and a status register */
+#define OMPIC_CPUBYTES       8
+#define OMPIC_CTRL(cpu)      ((cpu) * OMPIC_CPUBYTES)
+#define OMPIC_STAT(cpu)      ((cpu) * OMPIC_CPUBYTES + 4)
+
+/* Address space required by the OMPIC */
+#define OMPIC_ADDR_SPACE     (MAX_CORES * OMPIC_CPUBYTES)
+
+/* Fields inside the control register */
+#define OMPIC_CTRL_IRQ_ACK   0x80000000
+#define OMPIC_CTRL_IRQ_GEN   0x40000000
+#define OMPIC_CTRL_DST_OFF   16
+#define OMPIC_CTRL_DST_MASK  0x3fff
+
+/* Fields inside the status register */
+#define OMPIC_STAT_IRQ_PENDING  0x40000000
+#define OMPIC_STAT_SRC_OFF      16
+
+/* Data sent with an interrupt, in both registers */
+#define OMPIC_DATA_MASK      0x0000ffff
+
+
+/* Function prototypes for external use */
+extern void  reg_ompic_sec ();
+
+#endif  /* OMPIC__H */
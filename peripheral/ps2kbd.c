@@ -39,6 +39,7 @@
 #include "abstract.h"
 #include "sched.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "sim-cmd.h"
 
 
@@ -749,6 +750,12 @@ kbd_sec_end (void *dat)
   reg_mem_area (kbd->baseaddr, KBD_SPACE, 0, &ops);
   reg_sim_reset (kbd_reset, dat);
   reg_sim_stat (kbd_info, dat);
+
+  /* Not the input stream, nor its name */
+  REG_CHECKPOINT (kbd, offsetof (struct kbd_state, rxfs));
+  REG_CHECKPOINT (&kbd->ccmd, offsetof (struct kbd_state, rxfile) -
+		  offsetof (struct kbd_state, ccmd));
+  REG_CHECKPOINT_JOB (kbd_job);
 }
 
 void
@@ -38,6 +38,7 @@
 #include "abstract.h"
 #include "sched.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 
 
 #define VGA_CTRL        0x00	/* Control Register */
@@ -436,6 +437,8 @@ vga_sec_end (void *dat)
   ops.delayw = 2;
   reg_mem_area (vga->baseaddr, VGA_ADDR_SPACE, 0, &ops);
   reg_sim_reset (vga_reset, dat);
+  REG_CHECKPOINT (vga, offsetof (struct vga_state, filename));
+  REG_CHECKPOINT_JOB (vga_job);
 }
 
 
@@ -43,6 +43,7 @@
 #include "sprs.h"
 #include "sim-config.h"
 #include "sched.h"
+#include "checkpoint.h"
 
 
 /* -------------------------------------------------------------------------- */
@@ -256,3 +257,16 @@ reg_pic_sec ()
   reg_config_param (sec, "use_nmi",      PARAMT_INT, pic_use_nmi);
 
 }	/* reg_pic_sec() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the PIC's jobs for checkpoints
+
+   PICMR and PICSR are SPRs, so are saved with the CPU.                      */
+/*---------------------------------------------------------------------------*/
+void
+reg_pic_checkpoint ()
+{
+  REG_CHECKPOINT_JOB (pic_rep_int);
+
+}	/* reg_pic_checkpoint() */
@@ -33,5 +33,6 @@ extern void  report_interrupt (int line);
 extern void  clear_interrupt (int line);
 extern void  pic_ints_en ();
 extern void  reg_pic_sec ();
+extern void  reg_pic_checkpoint ();
 
 #endif  /* PIC__H */
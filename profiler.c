@@ -97,6 +97,14 @@ prof_acquire (const char *fprofname)
   int line = 0;
   int reopened = 0;
 
+  /* Start afresh, rather than add to any earlier profile */
+  prof_nfuncs = 0;
+  prof_cycles = 0;
+  nstack      = 0;
+  maxstack    = 0;
+  ntotcalls   = 0;
+  nfunccalls  = 0;
+
   if (runtime.sim.fprof)
     {
       fprof = runtime.sim.fprof;
@@ -47,6 +47,7 @@
 #include "labels.h"
 #include "sched.h"
 #include "toplevel-support.h"
+#include "checkpoint.h"
 #include "dumpverilog.h"
 #include "profiler.h"
 #include "mprofiler.h"
@@ -73,6 +74,22 @@ struct sim_stat
 
 static struct sim_stat *sim_stats = NULL;
 
+/* The addresses last used by the memory commands, the defaults for the next
+ * time */
+static oraddr_t dm_from = 0, dm_to = 0;
+static oraddr_t dv_from = 0, dv_to = 0;
+static oraddr_t dh_from = 0, dh_to = 0;
+static oraddr_t pm_addr = 0;
+static oraddr_t cm_from = 0, cm_to = 0;
+static unsigned int cm_size = 0;
+
+/* The last command, repeated by an empty line */
+#ifdef HAVE_LIBREADLINE
+static char *prev_str = NULL;
+#else
+static char prev_str[500] = { 0 };
+#endif
+
 /* Registers a status printing callback */
 void
 reg_sim_stat (void (*stat_func) (void *dat), void *dat)
@@ -132,6 +149,10 @@ sim_cmd_help (int argc, char **argv)	/* help */
     ("break <addr>                   - toggle breakpoint at address <addr>\n");
   PRINTF ("breaks                         - print all set breakpoints\n");
   PRINTF ("reset                          - simulator reset\n");
+  PRINTF
+    ("save <filename>                - save a checkpoint of the simulation\n");
+  PRINTF
+    ("restore <filename>             - restore a checkpoint of the simulation\n");
   PRINTF ("hist                           - execution history\n");
   PRINTF
     ("stall                          - stalls the processor and gives control to\n");
@@ -175,19 +196,17 @@ sim_cmd_trace (int argc, char **argv)	/* trace */
 static int
 sim_cmd_dm (int argc, char **argv)	/* dump memory */
 {
-  static oraddr_t from = 0, to = 0;
-
   if (argc >= 2)
     {
       if (argv[1][0] == '_')
-	from = eval_label (argv[1]);
+	dm_from = eval_label (argv[1]);
       else
-	from = strtoul (argv[1], NULL, 0);
-      to = from + 0x40;
+	dm_from = strtoul (argv[1], NULL, 0);
+      dm_to = dm_from + 0x40;
     }
   if (argc >= 3)
-    to = strtoul (argv[2], NULL, 0);
-  dump_memory (from, to);
+    dm_to = strtoul (argv[2], NULL, 0);
+  dump_memory (dm_from, dm_to);
   PRINTF ("\n");
   return 0;
 }
@@ -195,23 +214,21 @@ sim_cmd_dm (int argc, char **argv)	/* dump memory */
 static int
 sim_cmd_dv (int argc, char **argv)	/* dump memory as verilog */
 {
-  static oraddr_t from = 0, to = 0;
-
   if (argc >= 2)
     {
       if (argv[1][0] == '_')
-	from = eval_label (argv[1]);
+	dv_from = eval_label (argv[1]);
       else
-	from = strtoul (argv[1], NULL, 0);
-      to = from + 0x40;
+	dv_from = strtoul (argv[1], NULL, 0);
+      dv_to = dv_from + 0x40;
     }
   if (argc >= 3)
-    to = strtoul (argv[2], NULL, 0);
+    dv_to = strtoul (argv[2], NULL, 0);
 
   if (argc < 4)
-    dumpverilog ("or1k_mem", from, to);
+    dumpverilog ("or1k_mem", dv_from, dv_to);
   else
-    dumpverilog (argv[3], from, to);
+    dumpverilog (argv[3], dv_from, dv_to);
 
   PRINTF ("\n");
   return 0;
@@ -220,20 +237,18 @@ sim_cmd_dv (int argc, char **argv)	/* dump memory as verilog */
 static int
 sim_cmd_dh (int argc, char **argv)	/* dump memory as hex */
 {
-  static oraddr_t from = 0, to = 0;
-
   if (argc >= 2)
     {
       if (argv[1][0] == '_')
-	from = eval_label (argv[1]);
+	dh_from = eval_label (argv[1]);
       else
-	from = strtoul (argv[1], NULL, 0);
-      to = from + 0x40;
+	dh_from = strtoul (argv[1], NULL, 0);
+      dh_to = dh_from + 0x40;
     }
   if (argc >= 3)
-    to = strtoul (argv[2], NULL, 0);
+    dh_to = strtoul (argv[2], NULL, 0);
 
-  dumphex (from, to);
+  dumphex (dh_from, dh_to);
   PRINTF ("\n");
   return 0;
 }
@@ -241,7 +256,6 @@ sim_cmd_dh (int argc, char **argv)	/* dump memory as hex */
 static int
 sim_cmd_pm (int argc, char **argv)	/* patch memory */
 {
-  static oraddr_t addr = 0;
   int breakpoint = 0;
 
   if (argc != 3)
@@ -253,47 +267,45 @@ sim_cmd_pm (int argc, char **argv)	/* patch memory */
   if (argc >= 2)
     {
       if (argv[1][0] == '_')
-	addr = eval_label (argv[1]);
+	pm_addr = eval_label (argv[1]);
       else
-	addr = strtoul (argv[1], NULL, 0);
+	pm_addr = strtoul (argv[1], NULL, 0);
     }
-  set_mem32 (addr, strtoul (argv[2], NULL, 0), &breakpoint);
+  set_mem32 (pm_addr, strtoul (argv[2], NULL, 0), &breakpoint);
   return 0;
 }
 
 static int
 sim_cmd_cm (int argc, char **argv)	/* copy memory 2004-01-20 hpanther */
 {
-  static oraddr_t from = 0, to = 0;
-  static unsigned int size = 0;
   int i;
 
   if (argc >= 2)
     {
       if (argv[1][0] == '_')
-	from = eval_label (argv[1]);
+	cm_from = eval_label (argv[1]);
       else
-	from = strtoul (argv[1], NULL, 0);
+	cm_from = strtoul (argv[1], NULL, 0);
     }
 
   if (argc >= 3)
     {
       if (argv[2][0] == '_')
-	to = eval_label (argv[2]);
+	cm_to = eval_label (argv[2]);
       else
-	to = strtoul (argv[2], NULL, 0);
+	cm_to = strtoul (argv[2], NULL, 0);
     }
 
   if (argc >= 4)
     {
       if (argv[3][0] == '_')
-	size = eval_label (argv[3]);
+	cm_size = eval_label (argv[3]);
       else
-	size = strtoul (argv[3], NULL, 0);
+	cm_size = strtoul (argv[3], NULL, 0);
     }
 
-  for (i = 0; i < size; i += 4)
-    set_direct32 (to + i, eval_direct32 (from + i, 0, 0), 0, 0);
+  for (i = 0; i < cm_size; i += 4)
+    set_direct32 (cm_to + i, eval_direct32 (cm_from + i, 0, 0), 0, 0);
   return 0;
 }
 
@@ -393,6 +405,34 @@ sim_cmd_reset (int argc, char **argv)	/* reset simulator */
   return 0;
 }
 
+static int
+sim_cmd_save (int argc, char **argv)	/* save checkpoint */
+{
+  if (argc != 2)
+    {
+      PRINTF ("save <filename>\n");
+      return 0;
+    }
+
+  if (!checkpoint_save (argv[1]))
+    PRINTF ("Checkpoint saved to %s\n", argv[1]);
+  return 0;
+}
+
+static int
+sim_cmd_restore (int argc, char **argv)	/* restore checkpoint */
+{
+  if (argc != 2)
+    {
+      PRINTF ("restore <filename>\n");
+      return 0;
+    }
+
+  if (!checkpoint_restore (argv[1]))
+    PRINTF ("Checkpoint restored from %s\n", argv[1]);
+  return 0;
+}
+
 static int
 sim_cmd_hist (int argc, char **argv)	/* dump history */
 {
@@ -438,6 +478,35 @@ print_insn_exec (void *dat)
   handle_sim_command ();
 }
 
+/* Registers the state of the command interpreter as simulator state */
+void
+reg_sim_cmd_state ()
+{
+  reg_sim_state (&to_insn_num, sizeof (to_insn_num));
+  reg_sim_state (&sim_stats, sizeof (sim_stats));
+  reg_sim_state (&dm_from, sizeof (dm_from));
+  reg_sim_state (&dm_to, sizeof (dm_to));
+  reg_sim_state (&dv_from, sizeof (dv_from));
+  reg_sim_state (&dv_to, sizeof (dv_to));
+  reg_sim_state (&dh_from, sizeof (dh_from));
+  reg_sim_state (&dh_to, sizeof (dh_to));
+  reg_sim_state (&pm_addr, sizeof (pm_addr));
+  reg_sim_state (&cm_from, sizeof (cm_from));
+  reg_sim_state (&cm_to, sizeof (cm_to));
+  reg_sim_state (&cm_size, sizeof (cm_size));
+  reg_sim_state (&prev_str, sizeof (prev_str));
+}
+
+/* Registers the jobs above, which may be pending when a checkpoint is
+ * saved */
+void
+reg_sim_cmd_checkpoint ()
+{
+  REG_CHECKPOINT_JOB (reenter_int);
+  REG_CHECKPOINT_JOB (check_insn_exec);
+  REG_CHECKPOINT_JOB (print_insn_exec);
+}
+
 static int
 sim_cmd_run (int argc, char **argv)	/* run */
 {
@@ -620,6 +689,8 @@ static const struct sim_command sim_commands[] = {
   {"r", sim_cmd_r},
   {"de", sim_cmd_de},
   {"reset", sim_cmd_reset},
+  {"save", sim_cmd_save},
+  {"restore", sim_cmd_restore},
   {"hist", sim_cmd_hist},
   {"stall", sim_cmd_stall},
   {"unstall", sim_cmd_unstall},
@@ -647,11 +718,8 @@ handle_sim_command (void)
   char *argv[5];
   char *cur_arg;
   const struct sim_command *cur_cmd;
-#ifdef HAVE_LIBREADLINE
-  static char *prev_str = NULL;
-#else
+#ifndef HAVE_LIBREADLINE
   char b2[500];
-  static char prev_str[500] = { 0 };
 #endif
 
   runtime.sim.iprompt_run = 1;
@@ -31,5 +31,7 @@
 /* Prototypes for external use */
 extern void  handle_sim_command (void);
 extern void  reg_sim_stat (void (*stat_func) (void *dat), void *dat);
+extern void  reg_sim_cmd_checkpoint ();
+extern void  reg_sim_cmd_state ();
 
 #endif /* SIM_CMD_H */
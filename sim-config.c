@@ -32,6 +32,7 @@
 #include "port.h"
 
 /* System includes */
+#include <stddef.h>
 #include <stdlib.h>
 
 /* Package includes */
@@ -54,6 +55,7 @@
 #include "dma.h"
 #include "eth.h"
 #include "gpio.h"
+#include "ompic.h"
 #include "vga.h"
 #include "fb.h"
 #include "ps2kbd.h"
@@ -66,6 +68,7 @@
 #include "misc.h"
 #include "argtable2.h"
 #include "cfi_flash.h"
+#include "toplevel-support.h"
 
 /*! A structure used to represent possible parameters in a section. */
 struct config_param
@@ -284,6 +287,8 @@ init_defconfig ()
   config.sim.exe_bin_insn_log    = 0;
   config.sim.exe_bin_insn_log_fn = strdup ("exe-insn.bin");
   config.sim.clkcycle_ps         = 4000;	/* 4000 for 4ns (250MHz) */
+  config.sim.quantum             = 0;	/* One instruction at a time */
+  config.sim.idle_skip           = 0;
 
   /* Debug */
   config.debug.jtagcycle_ps = 40000;	/* 40000 for 40ns (25MHz) */
@@ -316,6 +321,8 @@ init_defconfig ()
   config.cpu.dependstats      = 0;
   config.cpu.sbuf_len         = 0;
   config.cpu.hardfloat        = 0;
+  config.cpu.cores            = 1;
+  config.cpu.core_quantum     = 1000;
 
   /* Data cache (IC is set dynamically). Also set relevant SPR bits */
   config.dc.enabled         = 0;
@@ -327,6 +334,7 @@ init_defconfig ()
   config.dc.load_missdelay  = 2;
   config.dc.store_hitdelay  = 0;
   config.dc.store_missdelay = 0;
+  config.dc.stats_only      = 0;
 
   if (config.dc.enabled)
     {
@@ -418,6 +426,7 @@ init_defconfig ()
   runtime.sim.fprof                 = NULL;
   runtime.sim.fmprof                = NULL;
   runtime.sim.fout                  = stdout;
+  runtime.sim.fork_index            = -1;
 
   /* Debug */
   runtime.debug.instr           = JI_UNDEFINED;
@@ -958,6 +967,11 @@ parse_args (int argc, char *argv[])
   struct arg_lit  *strict_npc;
   struct arg_lit  *profile;
   struct arg_lit  *mprofile;
+  struct arg_file *restore;
+  struct arg_int  *fork_children;
+  struct arg_int  *fork_jobs;
+  struct arg_str  *fork_input;
+  struct arg_str  *fork_output;
   struct arg_file *load_file;
   struct arg_end  *end;
 
@@ -987,6 +1001,16 @@ parse_args (int argc, char *argv[])
   strict_npc = arg_lit0 (NULL, "strict-npc", "setting NPC flushes pipeline");
   profile = arg_lit0 (NULL, "enable-profile", "enable profiling");
   mprofile = arg_lit0 (NULL, "enable-mprofile", "enable memory profiling");
+  restore = arg_file0 (NULL, "restore", "<file>",
+		       "restore a checkpoint after loading");
+  fork_children = arg_int0 (NULL, "fork", "<n>",
+			    "fork <n> children at l.nop 13");
+  fork_jobs = arg_int0 (NULL, "fork-jobs", "<n>",
+			"run at most <n> children at once");
+  fork_input = arg_str0 (NULL, "fork-input", "<pattern>",
+			 "input of each child (%d is its index)");
+  fork_output = arg_str0 (NULL, "fork-output", "<pattern>",
+			  "output of each child (%d is its index)");
   load_file = arg_file0 (NULL, NULL, "<file>", "OR32 executable");
   end = arg_end (20);
 
@@ -1009,6 +1033,11 @@ parse_args (int argc, char *argv[])
     strict_npc,
     profile,
     mprofile,
+    restore,
+    fork_children,
+    fork_jobs,
+    fork_input,
+    fork_output,
     load_file,
     end };
 
@@ -1136,6 +1165,50 @@ parse_args (int argc, char *argv[])
   config.sim.profile = profile->count;
   config.sim.mprofile = mprofile->count;
 
+  /* Checkpoint */
+  if (restore->count > 0)
+    {
+      runtime.sim.restore_fn = strdup (restore->filename[0]);
+    }
+  else
+    {
+      runtime.sim.restore_fn = NULL;
+    }
+
+  /* Fork at l.nop NOP_FORK */
+  runtime.sim.fork_children = 0;
+  runtime.sim.fork_jobs     = 0;
+  runtime.sim.fork_input    = NULL;
+  runtime.sim.fork_output   = NULL;
+  runtime.sim.fork_cli      = command->count;
+
+  if (fork_children->count > 0)
+    {
+      if (fork_children->ival[0] <= 0)
+	{
+	  fprintf (stderr, "ERROR: --fork needs at least one child\n");
+	  arg_freetable (argtab, sizeof (argtab) / sizeof (argtab[0]));
+	  return 1;
+	}
+
+      runtime.sim.fork_children = fork_children->ival[0];
+    }
+
+  if (fork_jobs->count > 0)
+    {
+      runtime.sim.fork_jobs = fork_jobs->ival[0];
+    }
+
+  if (fork_input->count > 0)
+    {
+      runtime.sim.fork_input = strdup (fork_input->sval[0]);
+    }
+
+  if (fork_output->count > 0)
+    {
+      runtime.sim.fork_output = strdup (fork_output->sval[0]);
+    }
+
   /* Executable file */
   if (load_file->count > 0)
     {
@@ -1540,6 +1613,47 @@ sim_clkcycle (union param_val  val,
 }	/* sim_clkcycle() */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Set the maximum number of instructions to run between scheduler checks
+
+   Zero (the default) goes round the main loop for every instruction. Negative
+   values are treated as zero with a warning.
+
+   @param[in] val  The value to use
+   @param[in] dat  The config data structure (not used here)                 */
+/*---------------------------------------------------------------------------*/
+static void
+sim_quantum (union param_val  val,
+	     void            *dat)
+{
+  if (val.int_val < 0)
+    {
+      fprintf (stderr, "Warning: negative quantum %d: zero used\n",
+	       val.int_val);
+      config.sim.quantum = 0;
+    }
+  else
+    {
+      config.sim.quantum = val.int_val;
+    }
+}	/* sim_quantum() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Skip trips round guest idle loops
+
+   @param[in] val  Non-zero (TRUE) to skip idle loops, zero (FALSE) otherwise.
+   @param[in] dat  The config data structure (not used here)                 */
+/*---------------------------------------------------------------------------*/
+static void
+sim_idle_skip (union param_val  val,
+	       void            *dat)
+{
+  config.sim.idle_skip = val.int_val;
+
+}	/* sim_idle_skip() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Register the functions to handle a section sim
 
@@ -1582,10 +1696,36 @@ reg_sim_sec ()
 		    sim_exe_bin_insn_log_fn);
 
   reg_config_param (sec, "clkcycle",       PARAMT_WORD,     sim_clkcycle);
+  reg_config_param (sec, "quantum",        PARAMT_INT,      sim_quantum);
+  reg_config_param (sec, "idle_skip",      PARAMT_INT,      sim_idle_skip);
 
 }	/* reg_sim_sec() */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register the configuration and runtime state as simulator state
+
+   The configuration is shared by the cores of a multi-core machine, but each
+   counts its own cycles and instructions.                                  */
+/*---------------------------------------------------------------------------*/
+void
+reg_config_state ()
+{
+  reg_sim_state (&config, sizeof (config));
+  reg_sim_state (&runtime, offsetof (struct runtime, sim.cycles));
+  reg_core_state (&runtime.sim.cycles, offsetof (struct runtime, sim.hush) -
+		  offsetof (struct runtime, sim.cycles));
+  reg_sim_state (&runtime.sim.hush, offsetof (struct runtime, cpu) -
+		 offsetof (struct runtime, sim.hush));
+  reg_core_state (&runtime.cpu, sizeof (runtime.cpu));
+  reg_sim_state (&runtime.vapi, sizeof (struct runtime) -
+		 offsetof (struct runtime, vapi));
+  reg_sim_state (&section_master_list, sizeof (section_master_list));
+  reg_sim_state (&line_number, sizeof (line_number));
+
+}	/* reg_config_state() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Register all the possible sections which we support.
 
@@ -1612,6 +1752,7 @@ reg_config_secs ()
   reg_ic_sec ();
   reg_dc_sec ();
   reg_gpio_sec ();
+  reg_ompic_sec ();
   reg_bpb_sec ();
   reg_pm_sec ();
   reg_pcu_sec ();
@@ -1693,4 +1834,7 @@ set_config_command (int argc, char **argv)
       PRINTF ("Invalid parameters specified.\n");
       break;
     }
+
+  /* The setting may change which instruction handlers are needed */
+  exec_select_handlers ();
 }
@@ -36,6 +36,7 @@
 /* Simulator configuration macros. Eventually this one will be a lot bigger. */
 
 #define MAX_SBUF_LEN     256	/* Max. length of store buffer */
+#define MAX_CORES         32	/* Max. number of cores */
 
 #define EXE_LOG_HARDWARE   0	/* Print out RTL states */
 #define EXE_LOG_SIMPLE     1	/* Executed log prints out dissasembly */
@@ -96,6 +97,8 @@ struct config
     int strict_npc;		/* JPB. NPC flushes pipeline when changed */
     int  quiet;			/* Minimize message output */
     int  report_mem_errs;	/* Report out of memory accesses */
+    int  quantum;		/* Max insns between scheduler checks */
+    int  idle_skip;		/* Skip trips round guest idle loops */
   } sim;
 
   struct
@@ -123,6 +126,8 @@ struct config
     int dependstats;		/* dependency statistics */
     int sbuf_len;		/* length of store buffer, 0=disabled */
     int hardfloat;      /* whether hardfloat is enabled */
+    int cores;			/* Number of cores sharing memory */
+    int core_quantum;		/* Cycles each core runs before the next */
   } cpu;
 
   struct
@@ -136,6 +141,7 @@ struct config
     int store_hitdelay;		/* cycles a store hit costs */
     int load_missdelay;		/* cycles a load miss costs */
     int load_hitdelay;		/* cycles a load hit costs */
+    int stats_only;		/* Track tags only, hold no line data */
   } dc;
 
   struct pic
@@ -183,9 +189,19 @@ struct runtime
     FILE *fprof;		/* Profiler file */
     FILE *fmprof;		/* Memory profiler file */
     FILE *fexe_log;		/* RTL state comparison file */
+    int exe_log_labelled;	/* Last logged insn was in a label... */
+    oraddr_t exe_log_label;	/* ...at this address */
     FILE *fexe_bin_insn_log;	/* Binary instruction dump/log file */
     FILE *fout;			/* file for standard output */
     char *filename;		/* Original Command Simulator file (CZ) */
+    char *restore_fn;		/* Checkpoint to restore at start */
+    int fork_children;		/* Children to fork at l.nop NOP_FORK */
+    int fork_jobs;		/* Children to run at once */
+    char *fork_input;		/* Standard input of each child */
+    char *fork_output;		/* Standard output of each child */
+    int fork_cli;		/* Children go to the interactive prompt */
+    int fork_index;		/* Index of this child, -1 if not a child */
+    int exit_code;		/* Exit code of the simulator */
     int iprompt;		/* Interactive prompt */
     int iprompt_run;		/* Interactive prompt is running */
     long long cycles;		/* Cycles counts fetch stages */
@@ -298,5 +314,6 @@ extern struct config_section *reg_config_sec (const char *section,
 					      void  (*sec_end) (void *));
 
 extern void  reg_config_secs ();
+extern void  reg_config_state ();
 
 #endif /* SIM_CONFIG_H */
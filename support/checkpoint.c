@@ -0,0 +1,631 @@
+/* checkpoint.c -- Saving and restoring the simulated machine to a file
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* This program is commented throughout in a fashion suitable for processing
+   with Doxygen. */
+
+
+/* A checkpoint holds every region registered with reg_checkpoint(), in the
+   order registered, and the scheduler's queue of jobs. Regions must be plain
+   data (no pointers, file handles and the like), since they are restored
+   byte for byte, possibly by another process. The job functions and their
+   parameters are pointers, so are saved as an index into the job functions
+   registered with reg_checkpoint_job() and as an offset into a registered
+   region respectively. A job whose function is not registered cannot be
+   saved.
+
+   A checkpoint may thus only be restored by the same simulator executable,
+   with the same configuration. Each region is saved with its size and a tag
+   made from the expression registering it (see REG_CHECKPOINT), so a
+   checkpoint whose regions were registered differently is refused, even if
+   its sizes happen to add up. The file format (all fields in host byte
+   order) is:
+
+     header      magic "OR1KCKPT", then uint32_t version, region count, job
+                 count and job function count, then int64_t code signature
+                 and uint64_t total size of the region data.
+     regions     for each region, uint64_t size, uint32_t tag and zero.
+     jobs        for each job in the order to queue it, int64_t cycles until
+                 it is due, uint32_t index of the job function, uint32_t
+                 region holding the parameter (CKPT_NO_REGION for NULL) and
+                 uint64_t offset of the parameter in that region.
+     data        the contents of each region.                              */
+
+
+/* Autoconf and/or portability configuration */
+#include "config.h"
+#include "port.h"
+
+/* System includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Package includes */
+#include "checkpoint.h"
+#include "sched.h"
+#include "sim-config.h"
+#include "toplevel-support.h"
+#include "execute.h"
+#include "abstract.h"
+#include "immu.h"
+#include "dmmu.h"
+
+
+/*! The version of the file format written. Change it whenever the format
+    changes. */
+#define CKPT_VERSION  3
+
+/*! Region index for a NULL job parameter */
+#define CKPT_NO_REGION  0xffffffff
+
+/*! The magic number at the start of a checkpoint */
+static const char  ckpt_magic[8] = { 'O', 'R', '1', 'K', 'C', 'K', 'P', 'T' };
+
+/*! Header of a checkpoint file */
+struct ckpt_header
+{
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  nregions;
+  uint32_t  njobs;
+  uint32_t  nfuncs;
+  int64_t   signature;
+  uint64_t  data_size;
+};
+
+/*! A region in a checkpoint file */
+struct ckpt_region_rec
+{
+  uint64_t  size;
+  uint32_t  tag;
+  uint32_t  reserved;
+};
+
+/*! A job in a checkpoint file */
+struct ckpt_job
+{
+  int64_t   time;
+  uint32_t  func;
+  uint32_t  region;
+  uint64_t  offset;
+};
+
+/*! A region of checkpointed state */
+struct ckpt_region
+{
+  void               *addr;
+  size_t              size;
+  const char         *name;
+  uint32_t            tag;
+  struct ckpt_region *next;
+};
+
+/*! The regions registered, in order, and their number and total size. Part
+    of the simulator state, since each machine has its own. */
+static struct ckpt_region  *ckpt_regions      = NULL;
+static struct ckpt_region **ckpt_regions_tail = &ckpt_regions;
+static uint32_t             ckpt_nregions     = 0;
+static uint64_t             ckpt_data_size    = 0;
+
+/*! The job functions registered, in order, and their number. Also part of
+    the simulator state. */
+static void               (**ckpt_funcs) (void *) = NULL;
+static uint32_t             ckpt_nfuncs           = 0;
+
+
+/*---------------------------------------------------------------------------*/
+/*!Make the tag of a region from its name
+
+   A 32-bit FNV-1a hash.
+
+   @param[in] name  The name of the region
+
+   @return  The tag                                                          */
+/*---------------------------------------------------------------------------*/
+static uint32_t
+ckpt_tag (const char *name)
+{
+  uint32_t  tag = 2166136261U;
+
+  while (*name)
+    {
+      tag ^= (unsigned char) *name++;
+      tag *= 16777619U;
+    }
+
+  return  tag;
+
+}	/* ckpt_tag() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register a region to be saved in checkpoints
+
+   Usually called through REG_CHECKPOINT, which names the region after the
+   expression giving its address.
+
+   @param[in] addr  Start of the region
+   @param[in] size  Size of the region in bytes
+   @param[in] name  Name of the region, checked when restoring              */
+/*---------------------------------------------------------------------------*/
+void
+reg_checkpoint (void       *addr,
+		size_t      size,
+		const char *name)
+{
+  struct ckpt_region *new = malloc (sizeof (struct ckpt_region));
+
+  if (!new)
+    {
+      fprintf (stderr, "reg_checkpoint: Out-of-memory\n");
+      exit (1);
+    }
+
+  new->addr          = addr;
+  new->size          = size;
+  new->name          = name;
+  new->tag           = ckpt_tag (name);
+  new->next          = NULL;
+  *ckpt_regions_tail = new;
+  ckpt_regions_tail  = &new->next;
+
+  ckpt_nregions++;
+  ckpt_data_size += size;
+
+}	/* reg_checkpoint() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register a job function which may be pending when a checkpoint is saved
+
+   Jobs are saved by their function's index in the order registered, so a
+   checkpoint is restored only through functions registered in the same way.
+   Registering a function again (as each instance of a peripheral does) is
+   harmless.
+
+   @param[in] func  The job function                                        */
+/*---------------------------------------------------------------------------*/
+void
+reg_checkpoint_job (void (*func) (void *))
+{
+  uint32_t  i;
+
+  for (i = 0; i < ckpt_nfuncs; i++)
+    {
+      if (func == ckpt_funcs[i])
+	{
+	  return;
+	}
+    }
+
+  ckpt_funcs = realloc (ckpt_funcs, (ckpt_nfuncs + 1) * sizeof (*ckpt_funcs));
+
+  if (!ckpt_funcs)
+    {
+      fprintf (stderr, "reg_checkpoint_job: Out-of-memory\n");
+      exit (1);
+    }
+
+  ckpt_funcs[ckpt_nfuncs++] = func;
+
+}	/* reg_checkpoint_job() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the checkpoint regions and job functions as simulator state               */
+/*---------------------------------------------------------------------------*/
+void
+reg_checkpoint_state ()
+{
+  reg_sim_state (&ckpt_regions, sizeof (ckpt_regions));
+  reg_sim_state (&ckpt_regions_tail, sizeof (ckpt_regions_tail));
+  reg_sim_state (&ckpt_nregions, sizeof (ckpt_nregions));
+  reg_sim_state (&ckpt_data_size, sizeof (ckpt_data_size));
+  reg_sim_state (&ckpt_funcs, sizeof (ckpt_funcs));
+  reg_sim_state (&ckpt_nfuncs, sizeof (ckpt_nfuncs));
+
+}	/* reg_checkpoint_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!A signature of the simulator's code
+
+   Regions are saved as they lie in memory, so can only be restored by the
+   same executable, whose structures are laid out the same way. Rebuilding
+   almost always moves functions relative to each other, which this detects.
+
+   @return  The signature                                                    */
+/*---------------------------------------------------------------------------*/
+static int64_t
+ckpt_signature ()
+{
+  return  (int64_t) ((intptr_t) exec_main - (intptr_t) reg_checkpoint);
+
+}	/* ckpt_signature() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Encode a job for a checkpoint
+
+   @param[out] job    The encoded job
+   @param[in]  func   The job function
+   @param[in]  param  The job parameter
+
+   @return  Non-zero if the function is not registered or the parameter is in
+            no registered region                                            */
+/*---------------------------------------------------------------------------*/
+static int
+ckpt_encode_job (struct ckpt_job  *job,
+		 void            (*func) (void *),
+		 void             *param)
+{
+  struct ckpt_region *cur;
+  uint32_t            i;
+
+  for (i = 0; (i < ckpt_nfuncs) && (func != ckpt_funcs[i]); i++)
+    {
+    }
+
+  if (i == ckpt_nfuncs)
+    {
+      return  1;
+    }
+
+  job->func = i;
+
+  if (NULL == param)
+    {
+      job->region = CKPT_NO_REGION;
+      job->offset = 0;
+      return  0;
+    }
+
+  for (cur = ckpt_regions, i = 0; cur; cur = cur->next, i++)
+    {
+      if (((char *) param >= (char *) cur->addr) &&
+	  ((char *) param < (char *) cur->addr + cur->size))
+	{
+	  job->region = i;
+	  job->offset = (char *) param - (char *) cur->addr;
+	  return  0;
+	}
+    }
+
+  return  1;
+
+}	/* ckpt_encode_job() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Save the simulated machine to a checkpoint file
+
+   Any TLB LRU updates held back by the MMU micro-TLBs are made first, so the
+   saved SPRs are complete. Statistics, logs and the like are not saved.
+
+   @param[in] filename  The file to write
+
+   @return  Zero on success, non-zero (having said why) otherwise            */
+/*---------------------------------------------------------------------------*/
+int
+checkpoint_save (const char *filename)
+{
+  struct ckpt_header   hdr;
+  int                  njobs;
+  struct ckpt_job     *jobs;
+  void               (**funcs) (void *);
+  void               **params;
+  int64_t             *times;
+  struct ckpt_region  *cur;
+  FILE                *f;
+  int                  i;
+  int                  err = 0;
+
+  if (config.cpu.cores > 1)
+    {
+      fprintf (stderr, "Warning: checkpoint_save: checkpoints of several "
+	       "cores are not supported\n");
+      return  1;
+    }
+
+  immu_sync_lru ();
+  dmmu_sync_lru ();
+
+  /* Every job must be saved, or the restored machine will misbehave */
+  njobs  = sched_jobs (NULL, NULL, NULL, 0);
+  jobs   = malloc ((njobs + 1) * sizeof (struct ckpt_job));
+  funcs  = malloc ((njobs + 1) * sizeof (*funcs));
+  params = malloc ((njobs + 1) * sizeof (void *));
+  times  = malloc ((njobs + 1) * sizeof (int64_t));
+
+  if ((NULL == jobs) || (NULL == funcs) || (NULL == params) ||
+      (NULL == times))
+    {
+      fprintf (stderr, "checkpoint_save: Out-of-memory\n");
+      exit (1);
+    }
+
+  sched_jobs (funcs, params, times, njobs);
+
+  for (i = 0; (i < njobs) && !err; i++)
+    {
+      jobs[i].time = times[i];
+      err          = ckpt_encode_job (&jobs[i], funcs[i], params[i]);
+    }
+
+  free (funcs);
+  free (params);
+  free (times);
+
+  if (err)
+    {
+      fprintf (stderr, "Warning: checkpoint_save: a job of a peripheral "
+	       "which cannot be checkpointed is pending: try later\n");
+      free (jobs);
+      return  1;
+    }
+
+  if (NULL == (f = fopen (filename, "wb")))
+    {
+      fprintf (stderr, "Warning: checkpoint_save: cannot open %s: ",
+	       filename);
+      perror (NULL);
+      free (jobs);
+      return  1;
+    }
+
+  memcpy (hdr.magic, ckpt_magic, sizeof (hdr.magic));
+  hdr.version   = CKPT_VERSION;
+  hdr.nregions  = ckpt_nregions;
+  hdr.njobs     = njobs;
+  hdr.nfuncs    = ckpt_nfuncs;
+  hdr.signature = ckpt_signature ();
+  hdr.data_size = ckpt_data_size;
+
+  err = (1 != fwrite (&hdr, sizeof (hdr), 1, f));
+
+  for (cur = ckpt_regions; cur && !err; cur = cur->next)
+    {
+      struct ckpt_region_rec  rec;
+
+      rec.size     = cur->size;
+      rec.tag      = cur->tag;
+      rec.reserved = 0;
+
+      err = (1 != fwrite (&rec, sizeof (rec), 1, f));
+    }
+
+  if (!err && (njobs > 0))
+    {
+      err = (njobs != fwrite (jobs, sizeof (struct ckpt_job), njobs, f));
+    }
+
+  /* The regions are written straight from where they are, so memory goes
+     out in a few large writes. */
+  for (cur = ckpt_regions; cur && !err; cur = cur->next)
+    {
+      err = (cur->size > 0) && (1 != fwrite (cur->addr, cur->size, 1, f));
+    }
+
+  free (jobs);
+
+  if (fclose (f) || err)
+    {
+      fprintf (stderr, "Warning: checkpoint_save: error writing %s\n",
+	       filename);
+      remove (filename);
+      return  1;
+    }
+
+  return  0;
+
+}	/* checkpoint_save() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Restore the simulated machine from a checkpoint file
+
+   The file is checked against this simulator and its configuration before
+   anything is changed, so a checkpoint which does not match leaves the
+   machine as it was. Decoded instructions are discarded.
+
+   @param[in] filename  The file to read
+
+   @return  Zero on success, non-zero (having said why) otherwise            */
+/*---------------------------------------------------------------------------*/
+int
+checkpoint_restore (const char *filename)
+{
+  struct ckpt_header  hdr;
+  struct ckpt_job    *jobs = NULL;
+  struct ckpt_region *cur;
+  FILE               *f;
+  uint32_t            i;
+
+  if (config.cpu.cores > 1)
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: checkpoints of several "
+	       "cores are not supported\n");
+      return  1;
+    }
+
+  if (NULL == (f = fopen (filename, "rb")))
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: cannot open %s: ",
+	       filename);
+      perror (NULL);
+      return  1;
+    }
+
+  if ((1 != fread (&hdr, sizeof (hdr), 1, f)) ||
+      (0 != memcmp (hdr.magic, ckpt_magic, sizeof (hdr.magic))))
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: %s is not a "
+	       "checkpoint\n", filename);
+      fclose (f);
+      return  1;
+    }
+
+  if (CKPT_VERSION != hdr.version)
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: %s is version %u, not "
+	       "%u\n", filename, (unsigned int) hdr.version, CKPT_VERSION);
+      fclose (f);
+      return  1;
+    }
+
+  if (ckpt_signature () != hdr.signature)
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: %s was written by a "
+	       "different simulator executable\n", filename);
+      fclose (f);
+      return  1;
+    }
+
+  if ((ckpt_nregions != hdr.nregions) || (ckpt_nfuncs != hdr.nfuncs) ||
+      (ckpt_data_size != hdr.data_size))
+    {
+      fprintf (stderr, "Warning: checkpoint_restore: %s does not match this "
+	       "configuration\n", filename);
+      fclose (f);
+      return  1;
+    }
+
+  for (cur = ckpt_regions; cur; cur = cur->next)
+    {
+      struct ckpt_region_rec  rec;
+
+      if (1 != fread (&rec, sizeof (rec), 1, f))
+	{
+	  fprintf (stderr, "Warning: checkpoint_restore: %s is truncated\n",
+		   filename);
+	  fclose (f);
+	  return  1;
+	}
+
+      if ((rec.size != cur->size) || (rec.tag != cur->tag))
+	{
+	  fprintf (stderr, "Warning: checkpoint_restore: %s does not match "
+		   "this configuration at %s\n", filename, cur->name);
+	  fclose (f);
+	  return  1;
+	}
+    }
+
+  if (hdr.njobs > 0)
+    {
+      jobs = malloc (hdr.njobs * sizeof (struct ckpt_job));
+
+      if (NULL == jobs)
+	{
+	  fprintf (stderr, "checkpoint_restore: Out-of-memory\n");
+	  exit (1);
+	}
+
+      if (hdr.njobs != fread (jobs, sizeof (struct ckpt_job), hdr.njobs, f))
+	{
+	  fprintf (stderr, "Warning: checkpoint_restore: %s is truncated\n",
+		   filename);
+	  free (jobs);
+	  fclose (f);
+	  return  1;
+	}
+    }
+
+  /* Each job must call a registered function with a parameter inside its
+     region */
+  for (i = 0; i < hdr.njobs; i++)
+    {
+      int  bad = (jobs[i].func >= ckpt_nfuncs);
+
+      if (CKPT_NO_REGION == jobs[i].region)
+	{
+	  bad = bad || (0 != jobs[i].offset);
+	}
+      else if (jobs[i].region >= ckpt_nregions)
+	{
+	  bad = 1;
+	}
+      else
+	{
+	  uint32_t  r;
+
+	  for (cur = ckpt_regions, r = 0; r < jobs[i].region; r++)
+	    {
+	      cur = cur->next;
+	    }
+
+	  bad = bad || (jobs[i].offset >= cur->size);
+	}
+
+      if (bad)
+	{
+	  fprintf (stderr, "Warning: checkpoint_restore: %s is corrupt\n",
+		   filename);
+	  free (jobs);
+	  fclose (f);
+	  return  1;
+	}
+    }
+
+  /* Past the point of no return. The regions are read straight into
+     place. */
+  for (cur = ckpt_regions; cur; cur = cur->next)
+    {
+      if ((cur->size > 0) && (1 != fread (cur->addr, cur->size, 1, f)))
+	{
+	  fprintf (stderr, "ERROR: checkpoint_restore: %s is truncated\n",
+		   filename);
+	  exit (1);
+	}
+    }
+
+  fclose (f);
+
+  sched_reset ();
+
+  for (i = 0; i < hdr.njobs; i++)
+    {
+      void  *param = NULL;
+
+      if (CKPT_NO_REGION != jobs[i].region)
+	{
+	  uint32_t  r;
+
+	  for (cur = ckpt_regions, r = 0; r < jobs[i].region; r++)
+	    {
+	      cur = cur->next;
+	    }
+
+	  param = (char *) cur->addr + jobs[i].offset;
+	}
+
+      sched_add (ckpt_funcs[jobs[i].func], param, (int32_t) jobs[i].time,
+		 "checkpoint_restore");
+    }
+
+  free (jobs);
+
+  immu_flush_utlb ();
+  dmmu_flush_utlb ();
+  mem_map_changed ();
+
+  return  0;
+
+}	/* checkpoint_restore() */
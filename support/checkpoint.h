@@ -0,0 +1,46 @@
+/* checkpoint.h -- Saving and restoring the simulated machine to a file
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* This program is commented throughout in a fashion suitable for processing
+   with Doxygen. */
+
+
+#ifndef CHECKPOINT__H
+#define CHECKPOINT__H
+
+/* System includes */
+#include <stddef.h>
+
+/* Register a region to be saved in checkpoints, named after the expression
+   giving its address */
+#define REG_CHECKPOINT(addr, size) reg_checkpoint (addr, size, #addr)
+
+/* Register a job function which may be pending when a checkpoint is saved */
+#define REG_CHECKPOINT_JOB(func) reg_checkpoint_job (func)
+
+/* Prototypes for external use */
+extern void  reg_checkpoint (void       *addr,
+			     size_t      size,
+			     const char *name);
+extern void  reg_checkpoint_job (void (*func) (void *));
+extern void  reg_checkpoint_state ();
+extern int   checkpoint_save (const char *filename);
+extern int   checkpoint_restore (const char *filename);
+
+#endif	/* CHECKPOINT__H */
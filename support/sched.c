@@ -37,155 +37,596 @@
 #include "sched.h"
 #include "debug.h"
 #include "sim-config.h"
+#include "toplevel-support.h"
 
 
 DECLARE_DEBUG_CHANNEL(sched_jobs);
 
-#define SCHED_HEAP_SIZE 128
-#define SCHED_TIME_MAX  INT32_MAX
+/* Jobs are held in a binary heap, ordered by the absolute time they are due.
+   Jobs due at the same time run newest first, as they always have.  Only the
+   first job in the heap has its time field counting down to zero, which is
+   all the main loop needs to look at.  The pool of job entries grows as
+   needed, SCHED_HEAP_SIZE entries at a time. */
+
+#define SCHED_HEAP_SIZE  128
+#define SCHED_TIME_MAX   INT32_MAX
+#define SCHED_HASH_SIZE  256
 
 /* FIXME: Scheduler should continue from previous cycles not current ones */
 
 struct scheduler_struct scheduler;
 
+static struct sched_entry **sched_heap;		/* Queued jobs */
+static int                  sched_heap_len;
+static int                  sched_heap_max;
+static struct sched_entry **sched_all;		/* All jobs, indexed by id */
+static uint32_t             sched_all_len;
+static struct sched_entry  *sched_free;		/* Unused jobs */
+static struct sched_entry  *sched_hash[SCHED_HASH_SIZE];	/* By func/param */
+static int64_t              sched_last_now;	/* Time when queue empty */
+static uint64_t             sched_seq;
+
+
+/*---------------------------------------------------------------------------*/
+/*!Hash a job function and parameter
+
+   @param[in] func   The job function
+   @param[in] param  The job parameter
+
+   @return  The index in sched_hash                                          */
+/*---------------------------------------------------------------------------*/
+static unsigned int
+sched_hash_index (void  (*func) (void *),
+		  void   *param)
+{
+  uintptr_t  h = (uintptr_t) func ^ ((uintptr_t) param >> 3);
+
+  return  (h ^ (h >> 8) ^ (h >> 16)) & (SCHED_HASH_SIZE - 1);
+
+}	/* sched_hash_index() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Is one job due before another?
+
+   @param[in] a  The first job
+   @param[in] b  The second job
+
+   @return  Non-zero if a should run before b                                */
+/*---------------------------------------------------------------------------*/
+static int
+sched_earlier (struct sched_entry *a,
+	       struct sched_entry *b)
+{
+  return  (a->deadline < b->deadline) ||
+    ((a->deadline == b->deadline) && (a->seq > b->seq));
+
+}	/* sched_earlier() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!The current scheduler time
+
+   Worked out from the countdown of the first job, which is all the main loop
+   updates.
+
+   @return  The current time                                                 */
+/*---------------------------------------------------------------------------*/
+static int64_t
+sched_now ()
+{
+  if (scheduler.job_queue)
+    {
+      return  scheduler.job_queue->deadline - scheduler.job_queue->time;
+    }
+  else
+    {
+      return  sched_last_now;
+    }
+}	/* sched_now() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Compare jobs for qsort(), in the order they were due and added
+
+   @param[in] a  Pointer to the first job
+   @param[in] b  Pointer to the second job
+
+   @return  Negative, zero or positive as a is due before, with or after b   */
+/*---------------------------------------------------------------------------*/
+static int
+sched_cmp_due (const void *a,
+	       const void *b)
+{
+  const struct sched_entry *ja = *(struct sched_entry * const *) a;
+  const struct sched_entry *jb = *(struct sched_entry * const *) b;
+
+  if (ja->deadline != jb->deadline)
+    {
+      return  (ja->deadline < jb->deadline) ? -1 : 1;
+    }
+
+  return  (ja->seq < jb->seq) ? -1 : (ja->seq > jb->seq);
+
+}	/* sched_cmp_due() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Make the top of the heap the first job, counting down from now
+
+   @param[in] now  The current time                                          */
+/*---------------------------------------------------------------------------*/
+static void
+sched_set_head (int64_t  now)
+{
+  if (sched_heap_len > 0)
+    {
+      scheduler.job_queue       = sched_heap[0];
+      scheduler.job_queue->time = (int32_t) (sched_heap[0]->deadline - now);
+    }
+  else
+    {
+      scheduler.job_queue = NULL;
+      sched_last_now      = now;
+    }
+}	/* sched_set_head() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Place a job in the heap
+
+   @param[in] i    Position in the heap
+   @param[in] job  The job                                                   */
+/*---------------------------------------------------------------------------*/
+static void
+sched_heap_set (int                 i,
+		struct sched_entry *job)
+{
+  sched_heap[i]   = job;
+  job->heap_index = i;
+
+}	/* sched_heap_set() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Move a job up the heap to its proper place
+
+   @param[in] i  Position of the job in the heap                             */
+/*---------------------------------------------------------------------------*/
+static void
+sched_sift_up (int  i)
+{
+  struct sched_entry *job = sched_heap[i];
+
+  while (i > 0)
+    {
+      int  parent = (i - 1) / 2;
+
+      if (!sched_earlier (job, sched_heap[parent]))
+	{
+	  break;
+	}
+
+      sched_heap_set (i, sched_heap[parent]);
+      i = parent;
+    }
+
+  sched_heap_set (i, job);
+
+}	/* sched_sift_up() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Move a job down the heap to its proper place
+
+   @param[in] i  Position of the job in the heap                             */
+/*---------------------------------------------------------------------------*/
+static void
+sched_sift_down (int  i)
+{
+  struct sched_entry *job = sched_heap[i];
+
+  for (;;)
+    {
+      int  child = 2 * i + 1;
+
+      if (child >= sched_heap_len)
+	{
+	  break;
+	}
+
+      if ((child + 1 < sched_heap_len) &&
+	  sched_earlier (sched_heap[child + 1], sched_heap[child]))
+	{
+	  child++;
+	}
+
+      if (!sched_earlier (sched_heap[child], job))
+	{
+	  break;
+	}
+
+      sched_heap_set (i, sched_heap[child]);
+      i = child;
+    }
+
+  sched_heap_set (i, job);
+
+}	/* sched_sift_down() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Add another SCHED_HEAP_SIZE job entries to the pool                       */
+/*---------------------------------------------------------------------------*/
+static void
+sched_grow ()
+{
+  struct sched_entry  *new = malloc (SCHED_HEAP_SIZE *
+				     sizeof (struct sched_entry));
+  struct sched_entry **all = realloc (sched_all,
+				      (sched_all_len + SCHED_HEAP_SIZE) *
+				      sizeof (struct sched_entry *));
+  struct sched_entry **heap = realloc (sched_heap,
+				       (sched_heap_max + SCHED_HEAP_SIZE) *
+				       sizeof (struct sched_entry *));
+  int  i;
+
+  if ((NULL == new) || (NULL == all) || (NULL == heap))
+    {
+      fprintf (stderr, "Out-of-memory while allocateing scheduler queue\n");
+      exit (1);
+    }
+
+  sched_all       = all;
+  sched_heap      = heap;
+  sched_heap_max += SCHED_HEAP_SIZE;
+
+  for (i = 0; i < SCHED_HEAP_SIZE; i++)
+    {
+      new[i].id         = sched_all_len;
+      new[i].gen        = 0;
+      new[i].heap_index = -1;
+      new[i].next       = sched_free;
+
+      sched_all[sched_all_len++] = &new[i];
+      sched_free                 = &new[i];
+    }
+}	/* sched_grow() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Take a job out of the queue and return it to the pool
+
+   @param[in] job  The job
+   @param[in] now  The current time                                          */
+/*---------------------------------------------------------------------------*/
+static void
+sched_remove (struct sched_entry *job,
+	      int64_t             now)
+{
+  struct sched_entry **pp;
+  int                  i = job->heap_index;
+
+  sched_heap_len--;
+
+  if (i < sched_heap_len)
+    {
+      sched_heap_set (i, sched_heap[sched_heap_len]);
+
+      if ((i > 0) &&
+	  sched_earlier (sched_heap[i], sched_heap[(i - 1) / 2]))
+	{
+	  sched_sift_up (i);
+	}
+      else
+	{
+	  sched_sift_down (i);
+	}
+    }
+
+  for (pp = &sched_hash[sched_hash_index (job->func, job->param)];
+       *pp != job;
+       pp = &(*pp)->next)
+    ;
+
+  *pp             = job->next;
+  job->heap_index = -1;
+  job->gen++;
+  job->next       = sched_free;
+  sched_free      = job;
+
+  sched_set_head (now);
+
+}	/* sched_remove() */
+
+
 /* Dummy function, representing a guard, which protects heap from
    emptying */
 void sched_guard (void *dat)
 {
-  if(scheduler.job_queue)
-    SCHED_ADD(sched_guard, dat, SCHED_TIME_MAX);
-  else {
-    scheduler.job_queue = scheduler.free_job_queue;
-    scheduler.free_job_queue = scheduler.free_job_queue->next;
-    scheduler.job_queue->next = NULL;
-    scheduler.job_queue->func = sched_guard;
-    scheduler.job_queue->time = SCHED_TIME_MAX;
-  }
+  SCHED_ADD(sched_guard, dat, SCHED_TIME_MAX);
 }
 
 void sched_reset(void)
 {
-  struct sched_entry *cur, *next;
+  while (sched_heap_len > 0)
+    {
+      sched_remove (sched_heap[sched_heap_len - 1], 0);
+    }
 
-  for(cur = scheduler.job_queue; cur; cur = next) {
-    next = cur->next;
-    cur->next = scheduler.free_job_queue;
-    scheduler.free_job_queue = cur;
-  }
-  scheduler.job_queue = NULL;
+  sched_last_now = 0;
   sched_guard(NULL);
 }
 
 void sched_init(void)
 {
   int i;
-  struct sched_entry *new;
-
-  scheduler.free_job_queue = NULL;
 
-  for(i = 0; i < SCHED_HEAP_SIZE; i++) {
-    if(!(new = malloc(sizeof(struct sched_entry)))) {
-      fprintf(stderr, "Out-of-memory while allocateing scheduler queue\n");
-      exit(1);
+  for (i = 0; i < SCHED_HASH_SIZE; i++)
+    {
+      sched_hash[i] = NULL;
     }
-    new->next = scheduler.free_job_queue;
-    scheduler.free_job_queue = new;
-  }
+
+  sched_free = NULL;
+  sched_heap_len = 0;
+  sched_last_now = 0;
   scheduler.job_queue = NULL;
+
+  sched_grow ();
   sched_guard(NULL);
 }
 
+/*---------------------------------------------------------------------------*/
+/*!Start a new, empty scheduler
+
+   The current scheduler's jobs and arrays are left alone, for whoever has
+   saved the state referring to them. Used to give each core of a multi-core
+   machine its own queue.                                                    */
+/*---------------------------------------------------------------------------*/
+void
+sched_new ()
+{
+  sched_heap     = NULL;
+  sched_heap_max = 0;
+  sched_all      = NULL;
+  sched_all_len  = 0;
+
+  sched_init ();
+
+}	/* sched_new() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!List the queued jobs
+
+   Jobs are listed in the order they are due, so adding them to an empty queue
+   in turn with sched_add() queues them as they are now. The guard job is not
+   included.
+
+   @param[out] funcs   The job functions, or NULL to just count the jobs
+   @param[out] params  The job parameters
+   @param[out] times   Clock cycles from now until each is due
+   @param[in]  max     The most jobs to list
+
+   @return  The number of jobs queued                                        */
+/*---------------------------------------------------------------------------*/
+int
+sched_jobs (void     (**funcs) (void *),
+	    void      **params,
+	    int64_t    *times,
+	    int         max)
+{
+  struct sched_entry **sorted;
+  int64_t              now = sched_now ();
+  int                  n   = 0;
+  int                  i;
+
+  for (i = 0; i < sched_heap_len; i++)
+    {
+      if (sched_heap[i]->func != sched_guard)
+	{
+	  n++;
+	}
+    }
+
+  if ((NULL == funcs) || (0 == n))
+    {
+      return  n;
+    }
+
+  if (NULL == (sorted = malloc (n * sizeof (struct sched_entry *))))
+    {
+      fprintf (stderr, "Out-of-memory while listing scheduler queue\n");
+      exit (1);
+    }
+
+  for (i = 0, n = 0; i < sched_heap_len; i++)
+    {
+      if (sched_heap[i]->func != sched_guard)
+	{
+	  sorted[n++] = sched_heap[i];
+	}
+    }
+
+  /* Oldest first for the same time, since sched_add() puts newer first */
+  qsort (sorted, n, sizeof (struct sched_entry *), sched_cmp_due);
+
+  for (i = 0; (i < n) && (i < max); i++)
+    {
+      funcs[i]  = sorted[i]->func;
+      params[i] = sorted[i]->param;
+      times[i]  = sorted[i]->deadline - now;
+    }
+
+  free (sorted);
+  return  n;
+
+}	/* sched_jobs() */
+
+
 /* Executes jobs in time queue */ 
 void do_scheduler(void)
 {
   struct sched_entry *tmp;
+  void (*func) (void *);
+  void *param;
 
   /* Execute all jobs till now */
   do {  
     tmp = scheduler.job_queue;
-    scheduler.job_queue = tmp->next;
-    tmp->next = scheduler.free_job_queue;
-    scheduler.free_job_queue = tmp;
+    func = tmp->func;
+    param = tmp->param;
 
-    scheduler.job_queue->time += tmp->time;
+    sched_remove (tmp, tmp->deadline - tmp->time);
 
-    tmp->func (tmp->param);
+    func (param);
   } while(scheduler.job_queue->time <= 0);
 }
 
-/* Adds new job to the queue */
-void sched_add(void (*job_func)(void *), void *job_param, int32_t job_time,
-               const char *func)
-{
-  struct sched_entry *cur, *prev, *new_job;
-  int32_t alltime;
-
-  cur = scheduler.job_queue;
-  prev = NULL;
-  alltime = cur->time;
-  while(cur && (alltime < job_time)) {
-    prev = cur;
-    cur = cur->next;
-    if(cur)
-      alltime += cur->time;
-  }
-
-  new_job = scheduler.free_job_queue;
-  scheduler.free_job_queue = new_job->next;
-  new_job->next = cur;
-
-  new_job->func = job_func;
-  new_job->param = job_param;
-
-  if(prev) {
-    new_job->time = job_time - (alltime - (cur ? cur->time : 0));
-    prev->next = new_job;
-  } else {
-    scheduler.job_queue = new_job;
-    new_job->time = job_time >= 0 ? job_time : cur->time;
-  }
-
-  if(cur)
-    cur->time -= new_job->time;
+/*---------------------------------------------------------------------------*/
+/*!Add a new job to the queue
 
-}
+   A negative time means the job is overdue. It then runs with the first job,
+   unless that is even more overdue.
+
+   @param[in] job_func   The function to call
+   @param[in] job_param  The parameter to pass it
+   @param[in] job_time   Clock cycles from now until it is due
+   @param[in] func       Name of the function (unused)
 
-/* Returns a job with specified function and param, NULL if not found */
-void sched_find_remove(void (*job_func)(void *), void *dat)
+   @return  A handle for the job, which may be passed to sched_cancel()      */
+/*---------------------------------------------------------------------------*/
+sched_handle
+sched_add (void        (*job_func) (void *),
+	   void         *job_param,
+	   int32_t       job_time,
+	   const char   *func)
+{
+  struct sched_entry *new_job;
+  unsigned int        h;
+  int64_t             now = sched_now ();
+
+  if ((job_time < 0) && scheduler.job_queue &&
+      (scheduler.job_queue->time >= job_time))
+    {
+      job_time = scheduler.job_queue->time;
+    }
+
+  if (NULL == sched_free)
+    {
+      sched_grow ();
+    }
+
+  new_job    = sched_free;
+  sched_free = new_job->next;
+
+  new_job->func     = job_func;
+  new_job->param    = job_param;
+  new_job->deadline = now + job_time;
+  new_job->seq      = ++sched_seq;
+
+  h             = sched_hash_index (job_func, job_param);
+  new_job->next = sched_hash[h];
+  sched_hash[h] = new_job;
+
+  sched_heap[sched_heap_len] = new_job;
+  sched_sift_up (sched_heap_len++);
+  sched_set_head (now);
+
+  return  ((sched_handle) new_job->gen << 32) | (new_job->id + 1);
+
+}	/* sched_add() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Remove the next job with a given function and parameter
+
+   Nothing happens if there is no such job.
+
+   @param[in] job_func  The job function
+   @param[in] dat       The job parameter                                    */
+/*---------------------------------------------------------------------------*/
+void
+sched_find_remove (void  (*job_func) (void *),
+		   void   *dat)
 {
   struct sched_entry *cur;
-  struct sched_entry *prev = NULL;
+  struct sched_entry *found = NULL;
+
+  for (cur = sched_hash[sched_hash_index (job_func, dat)]; cur;
+       cur = cur->next)
+    {
+      if ((cur->func == job_func) && (cur->param == dat) &&
+	  ((NULL == found) || sched_earlier (cur, found)))
+	{
+	  found = cur;
+	}
+    }
 
-  for (cur = scheduler.job_queue; cur; prev = cur, cur = cur->next) {
-    if ((cur->func == job_func) && (cur->param == dat)) {
-      if(cur->next)
-        cur->next->time += cur->time;
+  if (found)
+    {
+      sched_remove (found, sched_now ());
+    }
+}	/* sched_find_remove() */
 
-      if(prev)
-        prev->next = cur->next;
-      else
-        scheduler.job_queue = cur->next;
-      cur->next = scheduler.free_job_queue;
-      scheduler.free_job_queue = cur;
-      break;
+
+/*---------------------------------------------------------------------------*/
+/*!Cancel a job
+
+   Nothing happens if the job has already run or been removed.
+
+   @param[in] handle  The handle returned by sched_add()                     */
+/*---------------------------------------------------------------------------*/
+void
+sched_cancel (sched_handle  handle)
+{
+  uint32_t            id = (uint32_t) handle;
+  struct sched_entry *job;
+
+  if ((0 == id) || (id > sched_all_len))
+    {
+      return;
     }
-  }
-}
+
+  job = sched_all[id - 1];
+
+  if ((job->gen == (uint32_t) (handle >> 32)) && (job->heap_index >= 0))
+    {
+      sched_remove (job, sched_now ());
+    }
+}	/* sched_cancel() */
+
 
 /* Schedules the next job so that it will run after the next instruction */
 void sched_next_insn(void (*func)(void *), void *dat)
 {
   int32_t cycles = 1;
-  struct sched_entry *cur = scheduler.job_queue;
 
-  /* The cycles count of the jobs may go into negatives.  If this happens, func
-   * will get called before the next instruction has executed. */
-  while(cur && (cur->time < 0)) {
-    cycles -= cur->time;
-    cur = cur->next;
-  }
+  /* The cycles count of the first job may go into negatives.  If this
+   * happens, func will get called before the next instruction has
+   * executed. */
+  if (scheduler.job_queue && (scheduler.job_queue->time < 0))
+    cycles -= scheduler.job_queue->time;
 
   SCHED_ADD(func, dat, cycles);
 }
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register the scheduler as simulator state, one for each core */
+/*---------------------------------------------------------------------------*/
+void
+reg_sched_state ()
+{
+  reg_core_state (&scheduler, sizeof (scheduler));
+  reg_core_state (&sched_heap, sizeof (sched_heap));
+  reg_core_state (&sched_heap_len, sizeof (sched_heap_len));
+  reg_core_state (&sched_heap_max, sizeof (sched_heap_max));
+  reg_core_state (&sched_all, sizeof (sched_all));
+  reg_core_state (&sched_all_len, sizeof (sched_all_len));
+  reg_core_state (&sched_free, sizeof (sched_free));
+  reg_core_state (&sched_hash, sizeof (sched_hash));
+  reg_core_state (&sched_last_now, sizeof (sched_last_now));
+  reg_core_state (&sched_seq, sizeof (sched_seq));
+
+}	/* reg_sched_state() */
@@ -34,36 +34,52 @@
 /*! Macro to remove a job from the scheduler */
 #define SCHED_FIND_REMOVE(f, p) sched_find_remove(f, p)
 
+/*! Handle for a scheduled job, allowing it to be cancelled. Zero is never a
+    valid handle. */
+typedef uint64_t sched_handle;
+
 /*! Structure for holding one job entry */
 struct sched_entry
 {
-  int32_t time;			/* Clock cycles before job starts */
+  int32_t time;			/* Clock cycles before job starts (only
+				   maintained for the first job) */
   void *param;			/* Parameter to pass to the function */
   void (*func) (void *);	/* Function to call when time reaches 0 */
-  struct sched_entry *next;
+  int64_t deadline;		/* Absolute time the job is due */
+  uint64_t seq;			/* Order added, newest first for equal time */
+  int heap_index;		/* Position in the heap, -1 if not queued */
+  uint32_t id;			/* Index in the table of all jobs */
+  uint32_t gen;			/* Times this entry has been reused */
+  struct sched_entry *next;	/* Next in the free list or hash chain */
 };
 
-/*! Heap of jobs */
+/*! Queue of jobs */
 struct scheduler_struct
 {
-  struct sched_entry *free_job_queue;
-  struct sched_entry *job_queue;
+  struct sched_entry *job_queue;	/* The next job due */
 };
 
 /* Global data structures for external use */
 extern struct scheduler_struct scheduler;
 
 /* Function prototypes for external use */
-extern void sched_init ();
-extern void sched_reset ();
-extern void sched_next_insn (void  (*func) (void *),
-			     void *dat);
-extern void sched_find_remove (void        (*job_func) (void *),
-			       void       *dat);
-extern void sched_add (void        (*job_func) (void *),
-		       void       *job_param,
-		       int32_t     job_time,
-		       const char *func);
-extern void do_scheduler ();
+extern void         sched_init ();
+extern void         sched_reset ();
+extern void         sched_new ();
+extern int          sched_jobs (void     (**funcs) (void *),
+				void      **params,
+				int64_t    *times,
+				int         max);
+extern void         sched_next_insn (void  (*func) (void *),
+				     void *dat);
+extern void         sched_find_remove (void        (*job_func) (void *),
+				       void       *dat);
+extern sched_handle sched_add (void        (*job_func) (void *),
+			       void       *job_param,
+			       int32_t     job_time,
+			       const char *func);
+extern void         sched_cancel (sched_handle  handle);
+extern void         do_scheduler ();
+extern void         reg_sched_state ();
 
 #endif /* _SCHED_H_ */
@@ -0,0 +1,53 @@
+/* fork.c. Test of forking the Or1ksim simulation at l.nop 13
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+/* Boots once, then forks at l.nop NOP_FORK (see fork.exp, which runs with
+   --fork). Each child reports its index, the number of children and an
+   argument, which its own command script may patch into r13 before it
+   carries on, then exits with that argument as its exit code. Run without
+   --fork, the program carries on as the only process, with index and
+   count zero. */
+
+#include "support.h"
+
+/* Assembler functions */
+extern unsigned long  lo_fork (unsigned long *count,
+			       unsigned long *arg);
+
+
+int main (void)
+{
+  unsigned long  index;
+  unsigned long  count;
+  unsigned long  arg;
+
+  printf ("Booted\n");
+
+  index = lo_fork (&count, &arg);
+
+  printf ("Child %lu of %lu, argument %lu\n", index, count, arg);
+  report (index);
+  report (count);
+  report (arg);
+  exit ((int) arg);
+}
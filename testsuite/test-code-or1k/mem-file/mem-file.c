@@ -0,0 +1,114 @@
+/* mem-file.c. Test of Or1ksim memory backed by host files
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+/* Runs with two memories backed by host files (see mem-file.cfg). The
+   private one is mapped from a short file made by mem-file.exp, and must
+   read as the file up to its end and as zero after it. The shared one keeps
+   a counter, which grows by STEP each time the program runs and is kept in
+   its file. The words used read the same in either byte order, since the
+   files hold memory in host byte order. Stop at tests_done () to check the
+   memories from the simulator's command line. */
+
+#include "support.h"
+
+/*! The memories, from mem-file.cfg */
+#define PRIV_BASE    0xa0000000
+#define SHARED_BASE  0xa0004000
+#define MEM_SIZE     0x00004000
+
+/*! Words in the private file, and the value of each */
+#define FILE_WORDS   16
+#define PATTERN(i)   (0x01010101 * ((i) + 1))
+
+/*! Value written over the private file */
+#define WRITTEN      0x5a5a5a5a
+
+/*! Increment of the shared counter */
+#define STEP         0x01010101
+
+/* fails if x is false */
+#define ASSERT(x) ((x)?1: fail (__FUNCTION__, __LINE__))
+
+
+void fail (char *func, int line)
+{
+#ifndef __FUNCTION__
+#define __FUNCTION__ "?"
+#endif
+
+  printf ("Test failed in %s\n", func);
+  report (line);
+  report (0xeeeeeeee);
+  exit (1);
+}
+
+/* The private memory holds the file, padded with zeros. Writes to it are
+   seen by the program, but not written to the file. */
+void private_test (void)
+{
+  int  i;
+
+  for (i = 0; i < FILE_WORDS; i++)
+    {
+      ASSERT (REG32 (PRIV_BASE + i * 4) == PATTERN (i));
+    }
+
+  ASSERT (REG32 (PRIV_BASE + FILE_WORDS * 4) == 0);
+  ASSERT (REG32 (PRIV_BASE + MEM_SIZE - 4) == 0);
+
+  REG32 (PRIV_BASE) = WRITTEN;
+  ASSERT (REG32 (PRIV_BASE) == WRITTEN);
+}
+
+/* The shared memory holds the counter left by the last run */
+void shared_test (void)
+{
+  unsigned long  count = REG32 (SHARED_BASE);
+
+  report (count);
+  ASSERT (count % STEP == 0);
+
+  REG32 (SHARED_BASE) = count + STEP;
+  ASSERT (REG32 (SHARED_BASE) == count + STEP);
+  report (count + STEP);
+}
+
+/* Somewhere to break once the memories are changed. Not inlined, whatever
+   the optimization. */
+void __attribute__ ((noinline)) tests_done (void)
+{
+  printf ("Tests completed\n");
+}
+
+int main (void)
+{
+  private_test ();
+  printf ("Private tests OK\n");
+
+  shared_test ();
+  printf ("Shared tests OK\n");
+
+  tests_done ();
+  report (0xdeaddead);
+  exit (0);
+}
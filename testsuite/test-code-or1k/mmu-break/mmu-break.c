@@ -0,0 +1,140 @@
+/* mmu-break.c. Test of Or1ksim breakpoints with small IMMU pages
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+/* Runs with 4kB IMMU pages (see mmu-break.cfg). A little function is copied
+   to CODE_PA, and called with the IMMU on through ALIAS_VA, a virtual page
+   mapped to it. Offsets in a 4kB page are the same for the two addresses,
+   but offsets in an 8kB page are not. The simulator's command line sets a
+   breakpoint at CODE_PA, which must be hit. */
+
+#include "spr-defs.h"
+#include "support.h"
+
+/*! IMMU page size */
+#define PAGE_SIZE  4096
+
+/*! Number of ITLB sets (one way each) */
+#define TLB_SETS  64
+
+/*! Physical address of the copied function. The breakpoint is set here. */
+#define CODE_PA  0x00100000
+
+/*! Virtual address mapped to CODE_PA. Its TLB set is well above those of the
+    program's own pages. */
+#define ALIAS_VA  0x00129000
+
+/*! Value returned by the copied function */
+#define RESULT  0x1234
+
+/*! Page number of an address. SPR_ITLBMR_VPN and SPR_ITLBTR_PPN assume
+    8kB pages. */
+#define PAGE_NUM(a)  ((a) & ~(PAGE_SIZE - 1))
+
+/*! Instruction execute rights */
+#define ITLB_PR  (SPR_ITLBTR_SXE | SPR_ITLBTR_UXE)
+
+/* fails if x is false */
+#define ASSERT(x) ((x)?1: fail (__FUNCTION__, __LINE__))
+
+/* Assembler functions */
+extern void  lo_immu_en (void);
+extern void  lo_immu_dis (void);
+
+/*! The copied function: l.ori r11,r0,RESULT; l.jr r9; l.nop. The l.nop is
+    only executed on a target with delay slots. */
+static const unsigned long  code[] = {
+  0xa9600000 | RESULT,
+  0x44004800,
+  0x15000000
+};
+
+/*! ITLB miss counter for ALIAS_VA */
+volatile int  alias_miss_count;
+
+
+void fail (char *func, int line)
+{
+#ifndef __FUNCTION__
+#define __FUNCTION__ "?"
+#endif
+
+  lo_immu_dis ();
+
+  printf ("Test failed in %s\n", func);
+  report (line);
+  report (0xeeeeeeee);
+  exit (1);
+}
+
+/* ITLB miss exception handler. ALIAS_VA is mapped to CODE_PA, everything
+   else one to one. */
+void itlb_miss_handler (void)
+{
+  unsigned long  ea  = mfspr (SPR_EEAR_BASE);
+  unsigned long  pa  = ea;
+  int            set = (ea / PAGE_SIZE) % TLB_SETS;
+
+  if (PAGE_NUM (ea) == ALIAS_VA)
+    {
+      alias_miss_count++;
+      pa = CODE_PA;
+    }
+
+  mtspr (SPR_ITLBMR_BASE (0) + set, PAGE_NUM (ea) | SPR_ITLBMR_V);
+  mtspr (SPR_ITLBTR_BASE (0) + set, PAGE_NUM (pa) | ITLB_PR);
+}
+
+int main (void)
+{
+  unsigned long  (*func) (void) = (unsigned long (*) (void)) ALIAS_VA;
+  unsigned long  res;
+  int            i;
+
+  excpt_itlbmiss = (unsigned long) itlb_miss_handler;
+
+  for (i = 0; i < sizeof (code) / sizeof (code[0]); i++)
+    {
+      REG32 (CODE_PA + i * 4) = code[i];
+    }
+
+  for (i = 0; i < TLB_SETS; i++)
+    {
+      mtspr (SPR_ITLBMR_BASE (0) + i, 0);
+    }
+
+  ASSERT ((ALIAS_VA & (PAGE_SIZE - 1)) == (CODE_PA & (PAGE_SIZE - 1)));
+  ASSERT ((ALIAS_VA & (2 * PAGE_SIZE - 1)) != (CODE_PA & (2 * PAGE_SIZE - 1)));
+
+  lo_immu_en ();
+  printf ("Calling code at alias\n");
+  res = func ();
+  lo_immu_dis ();
+
+  report (res);
+  ASSERT (res == RESULT);
+  ASSERT (alias_miss_count == 1);
+
+  printf ("Tests completed\n");
+  report (0xdeaddead);
+  exit (0);
+}
@@ -0,0 +1,309 @@
+/* mmu-walk.c. Test of the Or1ksim MMU hardware page table walk
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+/* Runs with hw_walk set for both MMUs (see mmu-walk.cfg). All of RAM is
+   mapped one to one by the page table, so the program itself runs with both
+   MMUs on, its TLB entries all coming from walks. A few test pages are
+   mapped higher up, and a few addresses are left out of the table to check
+   that a walk finding no entry still takes the TLB miss exception. The
+   walk statistics are checked from the simulator's command line once the
+   program reaches exit (). */
+
+#include "spr-defs.h"
+#include "support.h"
+
+/*! MMU page size */
+#define PAGE_SIZE  8192
+
+/*! Number of TLB sets (one way each) */
+#define TLB_SETS  64
+
+/*! RAM mapped one to one, starting at zero */
+#define RAM_SIZE  0x00200000
+
+/*! Number of entries in a second level table, covering 16MB */
+#define L2_ENTRIES  (0x01000000 / PAGE_SIZE)
+
+/*! Valid bit of a page table entry at either level */
+#define PTE_V  0x00000400
+
+/*! Access rights of a page table entry. The ITLBTR execute bits share their
+    positions with DTLBTR[URE,UWE], so one table serves both MMUs. */
+#define PTE_PR  (SPR_DTLBTR_URE | SPR_DTLBTR_UWE | \
+		 SPR_DTLBTR_SRE | SPR_DTLBTR_SWE)
+
+/*! Virtual address of the test pages. Its TLB set is well above those of
+    the program's own pages. */
+#define TEST_SET  40
+#define TEST_VA   (0xc0000000 + TEST_SET * PAGE_SIZE)
+
+/*! Number of test pages in the page table. The next page is missing from
+    its second level table. */
+#define TEST_PAGES  4
+
+/*! Virtual address missing from the first level table */
+#define NO_L1_VA  (0x80000000 + (TEST_SET + 5) * PAGE_SIZE)
+
+/*! Physical address of the test pages */
+#define TEST_PA  0x00100000
+
+/*! Physical page mapped at TEST_VA by the alternative page table */
+#define ALT_PAGE  6
+
+/*! Walk delay and miss delay from mmu-walk.cfg */
+#define WALKDELAY  7
+#define MISSDELAY  1
+
+/*! Value held in each physical test page */
+#define PATTERN(page)  (0x600d0000 + (page))
+
+/* fails if x is false */
+#define ASSERT(x) ((x)?1: fail (__FUNCTION__, __LINE__))
+
+/* Assembler functions */
+extern void           lo_mmu_en (void);
+extern void           lo_mmu_dis (void);
+extern unsigned long  lo_load_cycles (unsigned long  addr);
+
+/*! First level tables, normal and alternative */
+static unsigned long  l1_table[256] __attribute__ ((aligned (1024)));
+static unsigned long  l1_alt[256]   __attribute__ ((aligned (1024)));
+
+/*! Second level tables for RAM, the test pages and the alternative test
+    pages */
+static unsigned long  l2_ram[L2_ENTRIES]  __attribute__ ((aligned (PAGE_SIZE)));
+static unsigned long  l2_test[L2_ENTRIES] __attribute__ ((aligned (PAGE_SIZE)));
+static unsigned long  l2_alt[L2_ENTRIES]  __attribute__ ((aligned (PAGE_SIZE)));
+
+/*! DTLB miss counter and EA of the last miss */
+volatile int            dtlb_miss_count;
+volatile unsigned long  dtlb_miss_ea;
+
+/*! Physical address the DTLB miss handler maps the missing page to */
+volatile unsigned long  dtlb_miss_pa;
+
+/*! ITLB miss counter. All instruction fetches should be refilled by walks */
+volatile int  itlb_miss_count;
+
+
+void fail (char *func, int line)
+{
+#ifndef __FUNCTION__
+#define __FUNCTION__ "?"
+#endif
+
+  lo_mmu_dis ();
+
+  printf ("Test failed in %s\n", func);
+  report (line);
+  report (0xeeeeeeee);
+  exit (1);
+}
+
+/* DTLB miss exception handler. Only taken when the walk finds no entry, so
+   this maps the page in software, the way an OS would. */
+void dtlb_miss_handler (void)
+{
+  unsigned long  ea  = mfspr (SPR_EEAR_BASE);
+  int            set = (ea / PAGE_SIZE) % TLB_SETS;
+
+  dtlb_miss_count++;
+  dtlb_miss_ea = ea;
+
+  mtspr (SPR_DTLBMR_BASE (0) + set, (ea & SPR_DTLBMR_VPN) | SPR_DTLBMR_V);
+  mtspr (SPR_DTLBTR_BASE (0) + set, (dtlb_miss_pa & SPR_DTLBTR_PPN) | PTE_PR);
+}
+
+/* ITLB miss exception handler. Should never be taken. */
+void itlb_miss_handler (void)
+{
+  itlb_miss_count++;
+  lo_mmu_dis ();
+
+  printf ("Test failed: ITLB miss at %.8lx\n", mfspr (SPR_EEAR_BASE));
+  report (0xeeeeeeee);
+  exit (1);
+}
+
+/* Invalidate every entry of both TLBs */
+void tlb_invalidate (void)
+{
+  int  i;
+
+  for (i = 0; i < TLB_SETS; i++)
+    {
+      mtspr (SPR_DTLBMR_BASE (0) + i, 0);
+      mtspr (SPR_ITLBMR_BASE (0) + i, 0);
+    }
+}
+
+/* Build the page tables and fill the physical test pages */
+void setup (void)
+{
+  int  i;
+
+  for (i = 0; i < RAM_SIZE / PAGE_SIZE; i++)
+    {
+      l2_ram[i] = (i * PAGE_SIZE) | PTE_PR | PTE_V;
+    }
+
+  for (i = 0; i < TEST_PAGES; i++)
+    {
+      l2_test[TEST_SET + i] = (TEST_PA + i * PAGE_SIZE) | PTE_PR | PTE_V;
+    }
+
+  l2_alt[TEST_SET] = (TEST_PA + ALT_PAGE * PAGE_SIZE) | PTE_PR | PTE_V;
+
+  l1_table[0]    = (unsigned long) l2_ram  | PTE_V;
+  l1_table[0xc0] = (unsigned long) l2_test | PTE_V;
+  l1_alt[0]      = (unsigned long) l2_ram  | PTE_V;
+  l1_alt[0xc0]   = (unsigned long) l2_alt  | PTE_V;
+
+  for (i = 0; i < 8; i++)
+    {
+      REG32 (TEST_PA + i * PAGE_SIZE) = PATTERN (i);
+    }
+}
+
+/* Check the MMUs say they refill in hardware */
+void htr_test (void)
+{
+  ASSERT (mfspr (SPR_DMMUCFGR) & SPR_DMMUCFGR_HTR);
+  ASSERT (mfspr (SPR_IMMUCFGR) & SPR_IMMUCFGR_HTR);
+}
+
+/* Each test page is refilled by a walk, without an exception. The entry
+   made must match the page table entry, less its valid bit. */
+void refill_test (void)
+{
+  unsigned long  mr;
+  unsigned long  tr;
+  int            i;
+
+  for (i = 0; i < TEST_PAGES; i++)
+    {
+      ASSERT (REG32 (TEST_VA + i * PAGE_SIZE) == PATTERN (i));
+      ASSERT (REG32 (TEST_VA + (i + 1) * PAGE_SIZE - 4) == 0);
+    }
+
+  ASSERT (dtlb_miss_count == 0);
+
+  for (i = 0; i < TEST_PAGES; i++)
+    {
+      mr = mfspr (SPR_DTLBMR_BASE (0) + TEST_SET + i);
+      tr = mfspr (SPR_DTLBTR_BASE (0) + TEST_SET + i);
+
+      ASSERT ((mr & (SPR_DTLBMR_VPN | SPR_DTLBMR_V)) ==
+	      ((TEST_VA + i * PAGE_SIZE) | SPR_DTLBMR_V));
+      ASSERT (tr == ((TEST_PA + i * PAGE_SIZE) | PTE_PR));
+    }
+}
+
+/* A walk with no valid second level entry, and one with no valid first level
+   entry, both take the DTLB miss exception. The entry made by the handler is
+   then used without another walk. */
+void walk_miss_test (void)
+{
+  unsigned long  ea;
+
+  ea           = TEST_VA + TEST_PAGES * PAGE_SIZE;
+  dtlb_miss_pa = TEST_PA + TEST_PAGES * PAGE_SIZE;
+  ASSERT (REG32 (ea) == PATTERN (TEST_PAGES));
+  ASSERT (dtlb_miss_count == 1);
+  ASSERT (dtlb_miss_ea == ea);
+
+  ea           = NO_L1_VA;
+  dtlb_miss_pa = TEST_PA + (TEST_PAGES + 1) * PAGE_SIZE;
+  ASSERT (REG32 (ea) == PATTERN (TEST_PAGES + 1));
+  ASSERT (dtlb_miss_count == 2);
+  ASSERT (dtlb_miss_ea == ea);
+
+  ASSERT (REG32 (TEST_VA + TEST_PAGES * PAGE_SIZE) == PATTERN (TEST_PAGES));
+  ASSERT (dtlb_miss_count == 2);
+}
+
+/* Only DMMUCR[PTBP] locates the page table. The other bits of DMMUCR are
+   set throughout, and switching tables changes the translation. */
+void ptbp_test (void)
+{
+  mtspr (SPR_DMMUCR, (unsigned long) l1_alt | ~SPR_DMMUCR_PTBP);
+  mtspr (SPR_DTLBMR_BASE (0) + TEST_SET, 0);
+  ASSERT (REG32 (TEST_VA) == PATTERN (ALT_PAGE));
+
+  mtspr (SPR_DMMUCR, (unsigned long) l1_table | ~SPR_DMMUCR_PTBP);
+  mtspr (SPR_DTLBMR_BASE (0) + TEST_SET, 0);
+  ASSERT (REG32 (TEST_VA) == PATTERN (0));
+  ASSERT (dtlb_miss_count == 2);
+}
+
+/* A walk costs missdelay plus walkdelay cycles more than a hit */
+void walkdelay_test (void)
+{
+  unsigned long  walk_cycles;
+  unsigned long  hit_cycles;
+
+  /* Make sure lo_load_cycles is in the ITLB first */
+  lo_load_cycles (TEST_VA);
+
+  mtspr (SPR_DTLBMR_BASE (0) + TEST_SET + 1, 0);
+  walk_cycles = lo_load_cycles (TEST_VA + PAGE_SIZE);
+  hit_cycles  = lo_load_cycles (TEST_VA + PAGE_SIZE);
+
+  ASSERT (walk_cycles - hit_cycles == MISSDELAY + WALKDELAY);
+}
+
+int main (void)
+{
+  excpt_dtlbmiss = (unsigned long) dtlb_miss_handler;
+  excpt_itlbmiss = (unsigned long) itlb_miss_handler;
+
+  setup ();
+
+  htr_test ();
+  printf ("HTR tests OK\n");
+
+  /* The low bits of xMMUCR are not part of the table address */
+  mtspr (SPR_DMMUCR, (unsigned long) l1_table | ~SPR_DMMUCR_PTBP);
+  mtspr (SPR_IMMUCR, (unsigned long) l1_table | ~SPR_IMMUCR_PTBP);
+  tlb_invalidate ();
+  lo_mmu_en ();
+
+  refill_test ();
+  printf ("DTLB refill tests OK\n");
+
+  walk_miss_test ();
+  printf ("DTLB walk miss tests OK\n");
+
+  ptbp_test ();
+  printf ("PTBP tests OK\n");
+
+  walkdelay_test ();
+  printf ("Walk delay tests OK\n");
+
+  lo_mmu_dis ();
+  ASSERT (itlb_miss_count == 0);
+
+  printf ("Tests completed\n");
+  report (0xdeaddead);
+  exit (0);
+}
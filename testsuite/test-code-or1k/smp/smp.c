@@ -0,0 +1,292 @@
+/* smp.c. Test of the Or1ksim interleaved multi-core machine
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+/* Runs on CORES cores taking short turns (see smp.cfg). All the cores
+   increment one counter with l.lwa and l.swa, then pass an OMPIC interrupt
+   round a ring, core 0 first. Interrupts are mostly sent to cores which are
+   not running at the time. Then cores 0 and 1 check that a reservation held
+   by one core is lost when the other stores to it, and only then. Only core
+   0 prints. */
+
+#include "spr-defs.h"
+#include "support.h"
+#include "int.h"
+
+/*! Number of cores, from smp.cfg */
+#define CORES  4
+
+/*! Size of each core's stack. Must match smp-asm.S */
+#define STACK_SIZE  0x1000
+
+/*! Increments of the counter by each core */
+#define INCS  500
+
+/*! OMPIC base address and interrupt line, from smp.cfg */
+#define OMPIC_BASE  0x98000000
+#define OMPIC_IRQ   1
+
+/*! OMPIC registers and fields */
+#define OMPIC_CTRL(cpu)  (OMPIC_BASE + (cpu) * 8)
+#define OMPIC_STAT(cpu)  (OMPIC_BASE + (cpu) * 8 + 4)
+#define OMPIC_CTRL_IRQ_ACK      0x80000000
+#define OMPIC_CTRL_IRQ_GEN      0x40000000
+#define OMPIC_CTRL_DST(cpu)     ((cpu) << 16)
+#define OMPIC_STAT_IRQ_PENDING  0x40000000
+#define OMPIC_STAT_SRC(stat)    (((stat) >> 16) & 0x3fff)
+#define OMPIC_DATA(stat)        ((stat) & 0xffff)
+
+/*! Data sent with the interrupt to a core */
+#define IPI_DATA(cpu)  (0x600 + (cpu))
+
+/*! Value of a flag once set. Memory is not cleared before main (). */
+#define MAGIC  0x600d600d
+
+/* fails if x is false */
+#define ASSERT(x) ((x)?1: fail (__FUNCTION__, __LINE__))
+
+/* Assembler functions */
+extern unsigned long  lo_atomic_inc (volatile unsigned long *addr);
+extern unsigned long  lo_lwa (volatile unsigned long *addr);
+extern int            lo_swa (volatile unsigned long *addr,
+			      unsigned long           value);
+
+/*! The stack of each core, set up by main () in smp-asm.S */
+unsigned long  smp_stacks[CORES][STACK_SIZE / sizeof (unsigned long)];
+
+/*! Set by core 0 once the shared data is set up */
+volatile unsigned long  go;
+
+/*! Set by each core once it takes interrupts */
+volatile unsigned long  ready[CORES];
+
+/*! Counter incremented by every core */
+volatile unsigned long  counter;
+
+/*! Interrupts taken by each core and the OMPIC status of the last */
+volatile unsigned long  ipis[CORES];
+volatile unsigned long  ipi_stat[CORES];
+
+/*! Word reserved by core 1 in the reservation tests, the progress of those
+    tests and the result of core 1's l.swa */
+volatile unsigned long  resv_word;
+volatile unsigned long  resv_other;
+volatile unsigned long  resv_step;
+volatile int            resv_result;
+
+
+void fail (char *func, int line)
+{
+#ifndef __FUNCTION__
+#define __FUNCTION__ "?"
+#endif
+
+  printf ("Test failed in %s on core %lu\n", func, mfspr (SPR_COREID));
+  report (line);
+  report (0xeeeeeeee);
+  exit (1);
+}
+
+/* OMPIC interrupt handler. Acknowledging the interrupt lowers the line. */
+void ipi_handler (void *arg)
+{
+  int  core = mfspr (SPR_COREID);
+
+  ipi_stat[core] = REG32 (OMPIC_STAT (core));
+  ipis[core]++;
+
+  REG32 (OMPIC_CTRL (core)) = OMPIC_CTRL_IRQ_ACK;
+}
+
+/* Interrupt the next core round the ring */
+void send_ipi (int core)
+{
+  int  dst = (core + 1) % CORES;
+
+  REG32 (OMPIC_CTRL (core)) =
+    OMPIC_CTRL_IRQ_GEN | OMPIC_CTRL_DST (dst) | IPI_DATA (dst);
+}
+
+/* Wait for the interrupt from the previous core round the ring, and check
+   the OMPIC status it left */
+void wait_ipi (int core)
+{
+  int  src = (core + CORES - 1) % CORES;
+
+  while (ipis[core] == 0)
+    ;
+
+  ASSERT (ipis[core] == 1);
+  ASSERT (ipi_stat[core] & OMPIC_STAT_IRQ_PENDING);
+  ASSERT (OMPIC_STAT_SRC (ipi_stat[core]) == src);
+  ASSERT (OMPIC_DATA (ipi_stat[core]) == IPI_DATA (core));
+  ASSERT (!(REG32 (OMPIC_STAT (core)) & OMPIC_STAT_IRQ_PENDING));
+  ASSERT (!(mfspr (SPR_PICSR) & (1 << OMPIC_IRQ)));
+}
+
+/* Every core increments the counter with l.lwa and l.swa, so no increment
+   is lost however the cores' turns fall. */
+void increment (void)
+{
+  int  i;
+
+  for (i = 0; i < INCS; i++)
+    {
+      lo_atomic_inc (&counter);
+    }
+}
+
+/* Core 1 reserves resv_word, and core 0 stores elsewhere while core 1 waits,
+   so core 1's l.swa succeeds. Then core 0 stores to resv_word while core 1
+   waits, so core 1's l.swa fails. Core 1 may take more than one step in a
+   turn, so each core waits for the other to reach at least a step. */
+void resv_test (int core)
+{
+  unsigned long  v;
+
+  if (0 == core)
+    {
+      while (resv_step < 1)
+	;
+
+      resv_other = MAGIC;
+      resv_step  = 2;
+
+      while (resv_step < 3)
+	;
+
+      ASSERT (resv_result == 1);
+      ASSERT (resv_word == MAGIC + 1);
+
+      while (resv_step < 4)
+	;
+
+      resv_word = 0;
+      resv_step = 5;
+
+      while (resv_step < 6)
+	;
+
+      ASSERT (resv_result == 0);
+      ASSERT (resv_word == 0);
+    }
+  else
+    {
+      v         = lo_lwa (&resv_word);
+      resv_step = 1;
+
+      while (resv_step < 2)
+	;
+
+      resv_result = lo_swa (&resv_word, v + 1);
+      resv_step   = 3;
+
+      v         = lo_lwa (&resv_word);
+      resv_step = 4;
+
+      while (resv_step < 5)
+	;
+
+      resv_result = lo_swa (&resv_word, v + 1);
+      resv_step   = 6;
+    }
+}
+
+void smp_main (int core)
+{
+  int  i;
+
+  if (0 == core)
+    {
+      ASSERT (mfspr (SPR_NUMCORES) == CORES);
+
+      counter   = 0;
+      resv_word = MAGIC;
+      resv_step = 0;
+
+      for (i = 0; i < CORES; i++)
+	{
+	  ready[i] = 0;
+	  ipis[i]  = 0;
+	}
+
+      int_init ();
+      int_add (OMPIC_IRQ, ipi_handler, 0);
+      go = MAGIC;
+    }
+  else
+    {
+      while (go != MAGIC)
+	;
+
+      mtspr (SPR_PICMR, mfspr (SPR_PICMR) | (1 << OMPIC_IRQ));
+    }
+
+  mtspr (SPR_SR, mfspr (SPR_SR) | SPR_SR_IEE);
+  ready[core] = MAGIC;
+
+  if (0 == core)
+    {
+      for (i = 1; i < CORES; i++)
+	{
+	  while (ready[i] != MAGIC)
+	    ;
+	}
+
+      printf ("%d cores ready\n", CORES);
+    }
+
+  increment ();
+
+  /* Each core has finished incrementing when it passes the interrupt on */
+  if (0 == core)
+    {
+      send_ipi (core);
+      wait_ipi (core);
+
+      ASSERT (counter == CORES * INCS);
+      printf ("Atomic increment tests OK\n");
+      printf ("Interrupt tests OK\n");
+    }
+  else
+    {
+      wait_ipi (core);
+      send_ipi (core);
+    }
+
+  if (core <= 1)
+    {
+      resv_test (core);
+    }
+
+  if (0 == core)
+    {
+      printf ("Reservation tests OK\n");
+      printf ("Tests completed\n");
+      report (counter);
+      report (0xdeaddead);
+      exit (0);
+    }
+
+  while (1)
+    ;
+}
@@ -103,6 +103,8 @@
 #define SPR_EEAR_LAST	(SPRGROUP_SYS + 63)
 #define SPR_ESR_BASE	(SPRGROUP_SYS + 64)
 #define SPR_ESR_LAST	(SPRGROUP_SYS + 79)
+#define SPR_COREID	(SPRGROUP_SYS + 128)
+#define SPR_NUMCORES	(SPRGROUP_SYS + 129)
 #define SPR_GPR_BASE	(SPRGROUP_SYS + 1024)
 
 /* Data MMU group */
@@ -318,6 +320,7 @@
 #define SPR_DMMUCR_P1S	   0x000007c0  /* Level 1 Page Size */
 #define SPR_DMMUCR_VADDR_WIDTH	0x0000f800  /* Virtual ADDR Width */
 #define SPR_DMMUCR_PADDR_WIDTH	0x000f0000  /* Physical ADDR Width */
+#define SPR_DMMUCR_PTBP	   0xfffffc00  /* Page Table Base Pointer */
 
 /*
  * Bit definitions for the Instruction MMU Control Register
@@ -327,6 +330,7 @@
 #define SPR_IMMUCR_P1S	   0x000007c0  /* Level 1 Page Size */
 #define SPR_IMMUCR_VADDR_WIDTH	0x0000f800  /* Virtual ADDR Width */
 #define SPR_IMMUCR_PADDR_WIDTH	0x000f0000  /* Physical ADDR Width */
+#define SPR_IMMUCR_PTBP	   0xfffffc00  /* Page Table Base Pointer */
 
 /*
  * Bit definitions for the Data TLB Match Register
@@ -714,5 +718,6 @@
 #define NOP_RANDOM       0x000a      /* Return 4 random bytes */
 #define NOP_OR1KSIM      0x000b      /* Return non-zero if this is Or1ksim */
 #define NOP_EXIT_SILENT  0x000c      /* End of simulation, quiet version */
+#define NOP_FORK         0x000d      /* Fork children to continue */
 
 #endif	/* SPR_DEFS__H */
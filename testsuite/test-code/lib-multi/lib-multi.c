@@ -0,0 +1,199 @@
+/* lib-multi.c. Test of multiple Or1ksim library instances.
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of OpenRISC 1000 Architectural Simulator.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the Free
+   Software Foundation; either version 3 of the License, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http:  www.gnu.org/licenses/>.  */
+
+/* ----------------------------------------------------------------------------
+   This code is commented throughout for use with Doxygen.
+   --------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "or1ksim.h"
+
+
+/*! Number of instances to create */
+#define NUM_INST  2
+
+/*! Address in high memory, unused by the test program */
+#define TEST_ADDR  0xffe00000
+
+
+/* --------------------------------------------------------------------------*/
+/*!Main program
+
+   Build an or1ksim program using the library which creates several instances
+   with the same program and config from the command line. Usage:
+
+   lib-multi <config-file> <image> <duration_ms>
+
+   Check that the instances have separate memory and keep separate time while
+   running for <duration_ms> milliseconds of simulated time each, and that
+   destroying one leaves the others intact.
+
+   @param[in] argc  Number of elements in argv
+   @param[in] argv  Vector of program name and arguments
+
+   @return  Return code for the program.                                     */
+/* --------------------------------------------------------------------------*/
+int
+main (int   argc,
+      char *argv[])
+{
+  /* Parse args */
+  if (4 != argc)
+    {
+      fprintf (stderr,
+	       "usage: lib-multi <config-file> <image> <duration_ms>\n");
+      return  1;
+    }
+
+  int     duration_ms = atoi (argv[3]);
+  double  duration    = (double) duration_ms / 1.0e3;
+
+  if (duration_ms <= 0)
+    {
+      fprintf (stderr, "ERROR. Duration must be positive number of ms\n");
+      return  1;
+    }
+
+  /* Dummy argv array to pass arguments to or1ksim_new. */
+  char *dummy_argv[5];
+
+  dummy_argv[0] = "libsim";
+  dummy_argv[1] = "-q";
+  dummy_argv[2] = "-f";
+  dummy_argv[3] = argv[1];
+  dummy_argv[4] = argv[2];
+
+  /* Create the instances */
+  struct or1ksim *sim[NUM_INST];
+  int             i;
+
+  for (i = 0; i < NUM_INST; i++)
+    {
+      if (NULL == (sim[i] = or1ksim_new (5, dummy_argv, NULL, NULL, NULL)))
+	{
+	  printf ("Creating instance %d failed.\n", i);
+	  return  1;
+	}
+    }
+
+  printf ("Created %d instances.\n", NUM_INST);
+
+  /* Give each instance a different value in memory, then check each still
+     has its own. */
+  for (i = 0; i < NUM_INST; i++)
+    {
+      unsigned char  buf[4];
+
+      memset (buf, 'A' + i, sizeof (buf));
+      or1ksim_lock (sim[i]);
+      or1ksim_write_mem (TEST_ADDR, buf, sizeof (buf));
+      or1ksim_unlock (sim[i]);
+    }
+
+  for (i = 0; i < NUM_INST; i++)
+    {
+      unsigned char  buf[4];
+
+      or1ksim_lock (sim[i]);
+      or1ksim_read_mem (TEST_ADDR, buf, sizeof (buf));
+      or1ksim_unlock (sim[i]);
+
+      if (('A' + i) != buf[0])
+	{
+	  printf ("Instance %d memory is 0x%02x, not 0x%02x.\n", i, buf[0],
+		  'A' + i);
+	  return  1;
+	}
+    }
+
+  printf ("Memory is separate.\n");
+
+  /* Run each instance in turn, then check each measured only its own time */
+  for (i = 0; i < NUM_INST; i++)
+    {
+      or1ksim_lock (sim[i]);
+      or1ksim_set_time_point ();
+      or1ksim_unlock (sim[i]);
+    }
+
+  for (i = 0; i < NUM_INST; i++)
+    {
+      if (OR1KSIM_RC_OK != or1ksim_run_inst (sim[i], duration))
+	{
+	  printf ("Running instance %d failed.\n", i);
+	  return  1;
+	}
+    }
+
+  for (i = 0; i < NUM_INST; i++)
+    {
+      double  measured_duration;
+
+      or1ksim_lock (sim[i]);
+      measured_duration = or1ksim_get_time_period ();
+      or1ksim_unlock (sim[i]);
+
+      if (fabs (duration - measured_duration) >= 1e-12)
+	{
+	  printf ("Instance %d failed. Requested period %.12f, but measured "
+		  "%.12f\n", i, duration, measured_duration);
+	  return  1;
+	}
+    }
+
+  printf ("Time is separate.\n");
+
+  /* Destroy the first instance, then check the rest still run with their
+     own memory */
+  or1ksim_destroy (sim[0]);
+
+  for (i = 1; i < NUM_INST; i++)
+    {
+      unsigned char  buf[4];
+
+      if (OR1KSIM_RC_OK != or1ksim_run_inst (sim[i], duration))
+	{
+	  printf ("Running instance %d after destroying instance 0 failed.\n",
+		  i);
+	  return  1;
+	}
+
+      or1ksim_lock (sim[i]);
+      or1ksim_read_mem (TEST_ADDR, buf, sizeof (buf));
+      or1ksim_unlock (sim[i]);
+
+      if (('A' + i) != buf[0])
+	{
+	  printf ("Instance %d memory is 0x%02x after destroying instance 0, "
+		  "not 0x%02x.\n", i, buf[0], 'A' + i);
+	  return  1;
+	}
+
+      or1ksim_destroy (sim[i]);
+    }
+
+  printf ("Instances destroyed.\n");
+  printf ("Test completed successfully.\n");
+  return  0;
+
+}	/* main () */
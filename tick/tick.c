@@ -46,6 +46,8 @@
 #include "sprs.h"
 #include "sim-config.h"
 #include "sched.h"
+#include "toplevel-support.h"
+#include "checkpoint.h"
 
 
 /*! When did the timer start to count */
@@ -79,6 +81,9 @@ tick_raise_except (void *dat)
    * TTMR_IP has been cleared */
   sched_next_insn (tick_raise_except, NULL);
 
+  /* Like any other interrupt, this ends doze and sleep mode */
+  cpu_state.sprs[SPR_PMR] &= ~(SPR_PMR_DME | SPR_PMR_SME);
+
   /* be sure not to issue a timer exception if an exception occured before it */
   if (cpu_state.sprs[SPR_SR] & SPR_SR_TEE)
     {
@@ -222,3 +227,34 @@ spr_read_ttcr ()
 
   return  ret;
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the tick timer as simulator state, one for each core */
+/*---------------------------------------------------------------------------*/
+void
+reg_tick_state ()
+{
+  reg_core_state (&cycle_count_at_tick_start,
+		  sizeof (cycle_count_at_tick_start));
+  reg_core_state (&tick_counting, sizeof (tick_counting));
+
+}	/* reg_tick_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the tick timer's state and jobs for checkpoints
+
+   TTMR and TTCR are SPRs, so are saved with the CPU.                        */
+/*---------------------------------------------------------------------------*/
+void
+reg_tick_checkpoint ()
+{
+  REG_CHECKPOINT (&cycle_count_at_tick_start,
+		  sizeof (cycle_count_at_tick_start));
+  REG_CHECKPOINT (&tick_counting, sizeof (tick_counting));
+  REG_CHECKPOINT_JOB (tick_raise_except);
+  REG_CHECKPOINT_JOB (tick_restart);
+  REG_CHECKPOINT_JOB (tick_one_shot);
+
+}	/* reg_tick_checkpoint() */
@@ -35,5 +35,7 @@ extern void      tick_reset ();
 extern void      spr_write_ttcr (uorreg_t value);
 extern void      spr_write_ttmr (uorreg_t value);
 extern uorreg_t  spr_read_ttcr ();
+extern void      reg_tick_state ();
+extern void      reg_tick_checkpoint ();
 
 #endif	/* TICK__H */
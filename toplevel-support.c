@@ -36,7 +36,9 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <fcntl.h>
+#include <string.h>
 
 /* Package includes */
 #include "toplevel-support.h"
@@ -57,6 +59,16 @@
 #include "abstract.h"
 #include "mc.h"
 #include "except.h"
+#include "dcache-model.h"
+#include "icache-model.h"
+#include "immu.h"
+#include "dmmu.h"
+#include "dma.h"
+#include "spr-defs.h"
+#include "checkpoint.h"
+#include "branch-predict.h"
+#include "atahost.h"
+#include "cfi_flash.h"
 
 
 /*! Struct for list of reset hooks */
@@ -70,6 +82,56 @@ struct sim_reset_hook
 /*! The list of reset hooks. Local to this source file */
 static struct sim_reset_hook *sim_reset_hooks = NULL;
 
+/*! Struct for list of close down hooks */
+struct sim_done_hook
+{
+  void *dat;
+  void (*done_hook) (void *);
+  struct sim_done_hook *next;
+};
+
+/*! The list of close down hooks. Local to this source file */
+static struct sim_done_hook *sim_done_hooks = NULL;
+
+/*! Struct for list of simulator state regions */
+struct sim_state
+{
+  void             *addr;
+  size_t            size;
+  struct sim_state *next;
+};
+
+/*! The list of simulator state regions and their total size. Local to this
+    source file */
+static struct sim_state *sim_states      = NULL;
+static size_t            sim_states_size = 0;
+
+/*! The list of regions which belong to one core of a multi-core machine,
+    also in sim_states, and their total size. Local to this source file */
+static struct sim_state *core_states      = NULL;
+static size_t            core_states_size = 0;
+
+/*! Value of smp_resv[] for a core holding no reservation. Load lock
+    addresses are always word aligned. */
+#define SMP_NO_RESV  1
+
+/*! The saved core state of each core of a multi-core machine, the core which
+    is loaded and the reservation (from l.lwa) each core held when it last
+    stopped running. None of these is registered state: they belong to the
+    machine, not to a core. */
+static void     **smp_states = NULL;
+static int        smp_core   = 0;
+static oraddr_t   smp_resv[MAX_CORES];
+
+/*! Interrupt lines to raise and to clear on each core when it next runs. Set
+    by smp_report_interrupt() and smp_clear_interrupt() for a core which is
+    not running. */
+static unsigned long  smp_ints[MAX_CORES];
+static unsigned long  smp_clr[MAX_CORES];
+
+/*! The cycle at which the running core must give way to the next */
+long long int  smp_switch_cycles;
+
 
 /*---------------------------------------------------------------------------*/
 /*!Random number initialization
@@ -215,6 +277,774 @@ reg_sim_reset (void (*reset_hook) (void *), void *dat)
 }	/* reg_sim_reset() */
 
 
+/*---------------------------------------------------------------------------*/
+/*!Register a new close down hook
+
+   The registered functions will be called in turn by sim_close(), to release
+   whatever a peripheral holds outside the simulator's own state (memory
+   buffers and the like).
+
+   @param[in] done_hook  The function to be called on close down
+   @param[in] dat        The data structure to be passed as argument when the
+                         done_hook function is called.                      */
+/*---------------------------------------------------------------------------*/
+void
+reg_sim_done (void (*done_hook) (void *), void *dat)
+{
+  struct sim_done_hook *new = malloc (sizeof (struct sim_done_hook));
+
+  if (!new)
+    {
+      fprintf (stderr, "reg_sim_done: Out-of-memory\n");
+      exit (1);
+    }
+
+  new->dat = dat;
+  new->done_hook = done_hook;
+  new->next = sim_done_hooks;
+  sim_done_hooks = new;
+
+}	/* reg_sim_done() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register a region of simulator state
+
+   Everything which describes one simulated machine (as opposed to things
+   which are the same for any machine, such as the disassembly tables) must
+   be registered, so that several machines may share one process. Each is
+   swapped in by sim_state_load() before it runs and out again by
+   sim_state_save().
+
+   State which belongs to one core of a multi-core machine is registered with
+   reg_core_state() instead.
+
+   @param[in] addr  Start of the region (usually a global or file static)
+   @param[in] size  Size of the region in bytes                              */
+/*---------------------------------------------------------------------------*/
+void
+reg_sim_state (void   *addr,
+	       size_t  size)
+{
+  struct sim_state *new = malloc (sizeof (struct sim_state));
+
+  if (!new)
+    {
+      fprintf (stderr, "reg_sim_state: Out-of-memory\n");
+      exit (1);
+    }
+
+  new->addr        = addr;
+  new->size        = size;
+  new->next        = sim_states;
+  sim_states       = new;
+  sim_states_size += size;
+
+}	/* reg_sim_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register a region of simulator state belonging to one core
+
+   The CPU, its MMUs, scheduler, tick timer and the like. As well as being
+   simulator state, each core of a multi-core machine has its own copy,
+   swapped in when the core takes its turn. Everything else (memory, the
+   peripherals, the configuration, breakpoints and labels) is shared by the
+   cores.
+
+   @param[in] addr  Start of the region (usually a global or file static)
+   @param[in] size  Size of the region in bytes                              */
+/*---------------------------------------------------------------------------*/
+void
+reg_core_state (void   *addr,
+		size_t  size)
+{
+  struct sim_state *new = malloc (sizeof (struct sim_state));
+
+  if (!new)
+    {
+      fprintf (stderr, "reg_core_state: Out-of-memory\n");
+      exit (1);
+    }
+
+  new->addr         = addr;
+  new->size         = size;
+  new->next         = core_states;
+  core_states       = new;
+  core_states_size += size;
+
+  reg_sim_state (addr, size);
+
+}	/* reg_core_state() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register all the simulator state
+
+   Modules with file static state register it themselves. Must be called
+   once, before any machine is configured, so that the state saved
+   immediately afterwards is that of an unconfigured machine.               */
+/*---------------------------------------------------------------------------*/
+void
+reg_sim_states ()
+{
+  reg_sim_state (&sim_reset_hooks, sizeof (sim_reset_hooks));
+  reg_sim_state (&sim_done_hooks, sizeof (sim_done_hooks));
+  reg_core_state (&except_pending, sizeof (except_pending));
+  reg_sim_state (&ic_state, sizeof (ic_state));
+  reg_core_state (&immu_state, sizeof (immu_state));
+  reg_core_state (&dmmu_state, sizeof (dmmu_state));
+
+  reg_config_state ();
+  reg_exec_state ();
+  reg_memory_state ();
+  reg_sched_state ();
+  reg_dc_state ();
+  reg_stats_state ();
+  reg_labels_state ();
+  reg_tick_state ();
+  reg_du_state ();
+  reg_mc_state ();
+  reg_dma_state ();
+  reg_checkpoint_state ();
+  reg_parse_state ();
+  reg_bpb_state ();
+  reg_ata_state ();
+  reg_cfi_memory_state ();
+  reg_sim_cmd_state ();
+  reg_rsp_state ();
+  reg_vapi_state ();
+
+}	/* reg_sim_states() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the state saved in checkpoints
+
+   Peripherals and memories register their own as they are configured. This
+   registers the rest, once the configuration is complete.                   */
+/*---------------------------------------------------------------------------*/
+static void
+reg_checkpoints ()
+{
+  reg_exec_checkpoint ();
+  REG_CHECKPOINT (&except_pending, sizeof (except_pending));
+  REG_CHECKPOINT (&runtime.sim.cycles, offsetof (struct runtime, sim.hush) -
+		  offsetof (struct runtime, sim.cycles));
+  REG_CHECKPOINT (&runtime.cpu, sizeof (runtime.cpu));
+  REG_CHECKPOINT_JOB (check_int);
+  reg_sim_cmd_checkpoint ();
+  reg_pic_checkpoint ();
+  reg_tick_checkpoint ();
+  reg_ic_checkpoint ();
+  reg_dc_checkpoint ();
+
+}	/* reg_checkpoints() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!The size of buffer needed to save the simulator state
+
+   @return  The total size of all registered state regions                   */
+/*---------------------------------------------------------------------------*/
+size_t
+sim_state_size ()
+{
+  return  sim_states_size;
+
+}	/* sim_state_size() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Save a list of state regions
+
+   Any TLB LRU updates held back by the MMU micro-TLBs are made first, so the
+   saved SPRs are complete.
+
+   @param[in]  list  The regions to save
+   @param[out] buf   Where to save them                                      */
+/*---------------------------------------------------------------------------*/
+static void
+state_save (struct sim_state *list,
+	    void             *buf)
+{
+  struct sim_state *cur;
+  char             *p = buf;
+
+  immu_sync_lru ();
+  dmmu_sync_lru ();
+
+  for (cur = list; cur; cur = cur->next)
+    {
+      memcpy (p, cur->addr, cur->size);
+      p += cur->size;
+    }
+}	/* state_save() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Copy a saved list of state regions back into place
+
+   @param[in] list  The regions to restore
+   @param[in] buf   State previously saved by state_save() from the same list*/
+/*---------------------------------------------------------------------------*/
+static void
+state_copy_in (struct sim_state *list,
+	       const void       *buf)
+{
+  struct sim_state *cur;
+  const char       *p = buf;
+
+  for (cur = list; cur; cur = cur->next)
+    {
+      memcpy (cur->addr, p, cur->size);
+      p += cur->size;
+    }
+}	/* state_copy_in() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Save the simulator state
+
+   @param[out] buf  Where to save it, of at least sim_state_size() bytes     */
+/*---------------------------------------------------------------------------*/
+void
+sim_state_save (void *buf)
+{
+  state_save (sim_states, buf);
+
+}	/* sim_state_save() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Restore the simulator state
+
+   Each machine's decoded instructions and translated blocks are reached
+   through a pointer in its state, so they come back with it and need not be
+   decoded again.
+
+   @param[in] buf  State previously saved by sim_state_save()                */
+/*---------------------------------------------------------------------------*/
+void
+sim_state_load (const void *buf)
+{
+  state_copy_in (sim_states, buf);
+
+}	/* sim_state_load() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Set up the extra cores of an interleaved multi-core machine
+
+   This is an experiment, not a model of cores running in parallel. The cores
+   take turns on the one host thread, each running for config.cpu.core_quantum
+   cycles before its core state (see reg_core_state()) is saved and the next
+   core's is loaded (all the CPU model's state is in globals, so only one core
+   can be loaded at once). Each switch copies the core state, most of it the
+   SPRs, so the quantum should not be made too small.
+
+   Everything else is shared: memory and its map, the peripherals, the
+   configuration, breakpoints and labels. So a change to the memory map (by a
+   memory controller, say) is seen by every core, as is a breakpoint set from
+   the command line. Decoded instructions are shared too, since they only
+   depend on memory.
+
+   Each extra core is a copy of core 0 after reset, with its own MMUs,
+   scheduler, tick timer and PIC. Peripherals are reset and schedule their
+   jobs on core 0 only, so their interrupts go to core 0. Cores interrupt
+   each other through the OMPIC (see smp_report_interrupt()). The cache
+   models hold data with no coherence between cores, so they are disabled.
+
+   Must be called after sim_init(), and not by the library, which swaps whole
+   machines in and out of the same state.                                    */
+/*---------------------------------------------------------------------------*/
+void
+smp_init ()
+{
+  int  i;
+
+  if (config.cpu.cores <= 1)
+    {
+      return;
+    }
+
+  PRINTF ("Interleaving %d cores, %d cycles at a time (experimental)\n",
+	  config.cpu.cores, config.cpu.core_quantum);
+
+  if (config.dc.enabled || ((NULL != ic_state) && ic_state->enabled))
+    {
+      fprintf (stderr, "Warning: smp_init: caches are not coherent between "
+	       "cores: disabled\n");
+      config.dc.enabled = 0;
+      cpu_state.sprs[SPR_UPR] &= ~SPR_UPR_DCP;
+
+      if (NULL != ic_state)
+	{
+	  ic_state->enabled = 0;
+	  cpu_state.sprs[SPR_UPR] &= ~SPR_UPR_ICP;
+	}
+    }
+
+  if (NULL == sim_states)
+    {
+      reg_sim_states ();
+    }
+
+  smp_states = malloc (config.cpu.cores * sizeof (void *));
+
+  if (NULL == smp_states)
+    {
+      fprintf (stderr, "smp_init: Out-of-memory\n");
+      exit (1);
+    }
+
+  cpu_state.sprs[SPR_COREID]   = 0;
+  cpu_state.sprs[SPR_NUMCORES] = config.cpu.cores;
+
+  for (i = 0; i < config.cpu.cores; i++)
+    {
+      smp_states[i] = malloc (core_states_size);
+
+      if (NULL == smp_states[i])
+	{
+	  fprintf (stderr, "smp_init: Out-of-memory\n");
+	  exit (1);
+	}
+
+      smp_resv[i] = SMP_NO_RESV;
+      smp_ints[i] = 0;
+      smp_clr[i]  = 0;
+    }
+
+  state_save (core_states, smp_states[0]);
+
+  for (i = 1; i < config.cpu.cores; i++)
+    {
+      state_copy_in (core_states, smp_states[0]);
+
+      if (NULL != immu_state)
+	{
+	  struct immu *immu = malloc (sizeof (*immu));
+
+	  if (NULL == immu)
+	    {
+	      fprintf (stderr, "smp_init: Out-of-memory\n");
+	      exit (1);
+	    }
+
+	  memcpy (immu, immu_state, sizeof (*immu));
+	  immu_state = immu;
+	}
+
+      if (NULL != dmmu_state)
+	{
+	  struct dmmu *dmmu = malloc (sizeof (*dmmu));
+
+	  if (NULL == dmmu)
+	    {
+	      fprintf (stderr, "smp_init: Out-of-memory\n");
+	      exit (1);
+	    }
+
+	  memcpy (dmmu, dmmu_state, sizeof (*dmmu));
+	  dmmu_state = dmmu;
+	}
+
+      /* As sim_reset(), but without the peripherals */
+      sched_new ();
+      tick_reset ();
+      pm_reset ();
+      pic_reset ();
+      du_reset ();
+      SCHED_ADD (check_int, NULL, 1);
+      runtime.sim.mem_cycles = 0;
+      cpu_reset ();
+
+      cpu_state.sprs[SPR_COREID] = i;
+      state_save (core_states, smp_states[i]);
+    }
+
+  state_copy_in (core_states, smp_states[0]);
+  smp_core          = 0;
+  smp_switch_cycles = config.cpu.core_quantum;
+
+}	/* smp_init() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Switch to the next core of a multi-core machine
+
+   Called when the running core reaches smp_switch_cycles. Once every core
+   has had its turn, the next round of turns is started.
+
+   A reservation the next core holds is dropped if another core has stored
+   to its address meanwhile (see smp_store()).                               */
+/*---------------------------------------------------------------------------*/
+void
+smp_next_core ()
+{
+  int  i;
+
+  smp_resv[smp_core] = cpu_state.loadlock_active ?
+    cpu_state.loadlock_addr : SMP_NO_RESV;
+  state_save (core_states, smp_states[smp_core]);
+
+  if (++smp_core == config.cpu.cores)
+    {
+      smp_core           = 0;
+      smp_switch_cycles += config.cpu.core_quantum;
+    }
+
+  state_copy_in (core_states, smp_states[smp_core]);
+
+  if (cpu_state.loadlock_active &&
+      (smp_resv[smp_core] != cpu_state.loadlock_addr))
+    {
+      cpu_state.loadlock_active = 0;
+    }
+
+  /* Interrupts sent to this core while it was not running */
+  for (i = 0; i < 32; i++)
+    {
+      if (smp_clr[smp_core] & (1UL << i))
+	{
+	  clear_interrupt (i);
+	}
+
+      if (smp_ints[smp_core] & (1UL << i))
+	{
+	  report_interrupt (i);
+	}
+    }
+
+  smp_ints[smp_core] = 0;
+  smp_clr[smp_core]  = 0;
+
+}	/* smp_next_core() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Note a store by the running core of a multi-core machine
+
+   Any other core's reservation of the same word is lost.
+
+   @param[in] phys_addr  Physical address stored to                          */
+/*---------------------------------------------------------------------------*/
+void
+smp_store (oraddr_t  phys_addr)
+{
+  int  i;
+
+  for (i = 0; i < config.cpu.cores; i++)
+    {
+      if ((i != smp_core) && (smp_resv[i] == (phys_addr & ~3)))
+	{
+	  smp_resv[i] = SMP_NO_RESV;
+	}
+    }
+}	/* smp_store() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Raise an interrupt on one core of a multi-core machine
+
+   If the core is not running, the interrupt is raised when it next runs.
+
+   @param[in] core  The core to interrupt
+   @param[in] line  The PIC line to raise                                    */
+/*---------------------------------------------------------------------------*/
+void
+smp_report_interrupt (int  core,
+		      int  line)
+{
+  if (core == smp_core)
+    {
+      report_interrupt (line);
+    }
+  else
+    {
+      smp_ints[core] |= 1UL << line;
+    }
+}	/* smp_report_interrupt() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Clear an interrupt on one core of a multi-core machine
+
+   If the core is not running, the interrupt is cleared when it next runs,
+   and a raise of the line still waiting for it is dropped.
+
+   @param[in] core  The core whose interrupt is cleared
+   @param[in] line  The PIC line to clear                                    */
+/*---------------------------------------------------------------------------*/
+void
+smp_clear_interrupt (int  core,
+		     int  line)
+{
+  if (core == smp_core)
+    {
+      clear_interrupt (line);
+    }
+  else
+    {
+      smp_ints[core] &= ~(1UL << line);
+      smp_clr[core]  |= 1UL << line;
+    }
+}	/* smp_clear_interrupt() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Expand a per-child file name
+
+   Each "%d" in the pattern is replaced by the index of the child.
+
+   @param[in] pattern  The file name pattern
+   @param[in] index    The index of the child
+
+   @return  The file name, which must be freed by the caller                 */
+/*---------------------------------------------------------------------------*/
+static char *
+fork_file_name (const char *pattern,
+		int         index)
+{
+  const char *p;
+  char       *name;
+  char       *q;
+  int         count = 0;
+
+  for (p = strstr (pattern, "%d"); NULL != p; p = strstr (p + 2, "%d"))
+    {
+      count++;
+    }
+
+  name = malloc (strlen (pattern) + count * 10 + 1);
+
+  if (NULL == name)
+    {
+      fprintf (stderr, "fork_file_name: Out-of-memory\n");
+      exit (1);
+    }
+
+  for (p = pattern, q = name; '\0' != *p;)
+    {
+      if (('%' == p[0]) && ('d' == p[1]))
+	{
+	  q += sprintf (q, "%d", index);
+	  p += 2;
+	}
+      else
+	{
+	  *q++ = *p++;
+	}
+    }
+
+  *q = '\0';
+  return  name;
+
+}	/* fork_file_name() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Set up a child created by sim_fork()
+
+   The child learns its index and the number of children in r11 and r12, as
+   the result of the l.nop. Its standard input and output may be redirected
+   to files of its own, and if the simulator was started interactively it
+   goes straight to the command line, to read commands from its input.
+
+   @param[in] index  The index of this child                                 */
+/*---------------------------------------------------------------------------*/
+static void
+sim_fork_child (int  index)
+{
+  runtime.sim.fork_index = index;
+  cpu_state.reg[11]      = index;
+  cpu_state.reg[12]      = runtime.sim.fork_children;
+  runtime.sim.fork_children = 0;
+
+  if (NULL != runtime.sim.fork_input)
+    {
+      char *name = fork_file_name (runtime.sim.fork_input, index);
+
+      if (NULL == freopen (name, "r", stdin))
+	{
+	  fprintf (stderr, "ERROR: sim_fork: cannot open input %s: %s\n",
+		   name, strerror (errno));
+	  exit (1);
+	}
+
+      free (name);
+    }
+
+  if (NULL != runtime.sim.fork_output)
+    {
+      char *name = fork_file_name (runtime.sim.fork_output, index);
+
+      if (NULL == freopen (name, "w", stdout))
+	{
+	  fprintf (stderr, "ERROR: sim_fork: cannot open output %s: %s\n",
+		   name, strerror (errno));
+	  exit (1);
+	}
+
+      free (name);
+    }
+
+  if (runtime.sim.fork_cli)
+    {
+      /* Poll for the prompt straight away, not at the next check */
+      runtime.sim.iprompt = 1;
+      SCHED_FIND_REMOVE (check_int, NULL);
+      SCHED_ADD (check_int, NULL, 1);
+    }
+}	/* sim_fork_child() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Fan the simulation out into several processes
+
+   Called from l.nop NOP_FORK when --fork was given. The simulator forks the
+   requested number of children, each of which carries on from the l.nop
+   with its own copy of the machine. The host shares all simulated memory
+   between the processes copy-on-write, so the children only cost the pages
+   they change, and the boot up to this point is done only once.
+
+   At most runtime.sim.fork_jobs children run at once (by default one per
+   host processor). The parent waits for them all, reports the exit code of
+   each and exits itself, with 1 if any child failed and 0 otherwise. A child
+   fails if it ends with a non-zero exit code (from r3 at l.nop NOP_EXIT) or
+   is killed.
+
+   Not done by the library, which belongs to another program, nor if the
+   remote debug server or VAPI are in use, since the children would share
+   their connections.                                                        */
+/*---------------------------------------------------------------------------*/
+void
+sim_fork ()
+{
+  int    n    = runtime.sim.fork_children;
+  int    jobs = runtime.sim.fork_jobs;
+  pid_t *pids;
+  int   *statuses;
+  int    started = 0;
+  int    running = 0;
+  int    failed  = 0;
+  int    i;
+
+  if (config.sim.is_library || config.debug.rsp_enabled ||
+      runtime.vapi.enabled)
+    {
+      fprintf (stderr, "Warning: sim_fork: cannot fork in the library, while "
+	       "debugging or using VAPI: ignored\n");
+      runtime.sim.fork_children = 0;
+      return;
+    }
+
+  if (jobs <= 0)
+    {
+      jobs = sysconf (_SC_NPROCESSORS_ONLN);
+      jobs = (jobs <= 0) ? 1 : jobs;
+    }
+
+  pids     = malloc (n * sizeof (*pids));
+  statuses = malloc (n * sizeof (*statuses));
+
+  if ((NULL == pids) || (NULL == statuses))
+    {
+      fprintf (stderr, "sim_fork: Out-of-memory\n");
+      exit (1);
+    }
+
+  /* Children which are never waited for (not started) count as failed */
+  for (i = 0; i < n; i++)
+    {
+      statuses[i] = -1;
+    }
+
+  /* Anything still buffered would otherwise be written by every child */
+  fflush (NULL);
+
+  while ((started < n) || (running > 0))
+    {
+      if ((started < n) && (running < jobs))
+	{
+	  pid_t  pid = fork ();
+
+	  if (0 == pid)
+	    {
+	      free (pids);
+	      free (statuses);
+	      sim_fork_child (started);
+	      return;
+	    }
+	  else if (pid < 0)
+	    {
+	      fprintf (stderr, "ERROR: sim_fork: cannot fork child %d: %s\n",
+		       started, strerror (errno));
+	      n = started;
+	      continue;
+	    }
+
+	  pids[started++] = pid;
+	  running++;
+	}
+      else
+	{
+	  int    status;
+	  pid_t  pid = wait (&status);
+
+	  if (pid < 0)
+	    {
+	      if (EINTR == errno)
+		{
+		  continue;
+		}
+
+	      break;
+	    }
+
+	  for (i = 0; i < started; i++)
+	    {
+	      if (pids[i] == pid)
+		{
+		  statuses[i] = status;
+		  running--;
+		}
+	    }
+	}
+    }
+
+  for (i = 0; i < runtime.sim.fork_children; i++)
+    {
+      if (-1 == statuses[i])
+	{
+	  PRINTF ("fork %d: not run\n", i);
+	  failed++;
+	}
+      else if (WIFEXITED (statuses[i]))
+	{
+	  PRINTF ("fork %d: exit(%d)\n", i, WEXITSTATUS (statuses[i]));
+	  failed += (0 != WEXITSTATUS (statuses[i]));
+	}
+      else
+	{
+	  PRINTF ("fork %d: killed by signal %d\n", i, WTERMSIG (statuses[i]));
+	  failed++;
+	}
+    }
+
+  PRINTF ("fork: %d of %d children failed\n", failed,
+	  runtime.sim.fork_children);
+
+  free (pids);
+  free (statuses);
+
+  runtime.sim.exit_code = (0 == failed) ? 0 : 1;
+  sim_done ();
+
+}	/* sim_fork() */
+
+
 /*---------------------------------------------------------------------------*/
 /*!Reset the simulator
 
@@ -296,6 +1126,7 @@ sim_init ()
 #endif
 
   sched_init ();
+  reg_checkpoints ();
 
   sim_reset ();			/* Must do this first - torches memory! */
 
@@ -363,6 +1194,13 @@ sim_init ()
 	}
     }
 
+  if (runtime.sim.restore_fn && checkpoint_restore (runtime.sim.restore_fn))
+    {
+      fprintf (stderr, "ERROR: sim_init: problem restoring checkpoint %s\n",
+	       runtime.sim.restore_fn);
+      exit (1);
+    }
+
   /* Disable RSP debugging, if debug unit is not available.  */
   if (config.debug.rsp_enabled && !config.debug.enabled)
     {
@@ -440,14 +1278,16 @@ sim_init ()
 
 
 /*---------------------------------------------------------------------------*/
-/*!Clean up
+/*!Close down the simulated machine
 
-   Close an profile or log files, disconnect VAPI. Call any memory mapped
-   peripheral close down function. Exit with rc 0.                           */
+   Close any profile or log files, disconnect VAPI. Call any memory mapped
+   peripheral close down function, and the close down hooks.                */
 /*---------------------------------------------------------------------------*/
 void
-sim_done ()
+sim_close ()
 {
+  struct sim_done_hook *cur;
+
   if (config.sim.profile)
     {
       fprintf (runtime.sim.fprof, "-%08llX FFFFFFFF\n", runtime.sim.cycles);
@@ -477,6 +1317,23 @@ sim_done ()
   done_memory_table ();
   mc_done ();
 
-  exit (0);
+  for (cur = sim_done_hooks; cur; cur = cur->next)
+    {
+      cur->done_hook (cur->dat);
+    }
+}	/* sim_close() */
+
+
+/*---------------------------------------------------------------------------*/
+/*!Clean up
+
+   Close down the simulated machine, then exit with runtime.sim.exit_code,
+   which is 0 unless set by sim_fork() or a child it forked.                 */
+/*---------------------------------------------------------------------------*/
+void
+sim_done ()
+{
+  sim_close ();
+  exit (runtime.sim.exit_code);
 
 }	/* sim_done() */
@@ -31,14 +31,39 @@
 #ifndef TOPLEVEL_SUPPORT__H
 #define TOPLEVEL_SUPPORT__H
 
+/* System includes */
+#include <stddef.h>
+
+/* Package includes */
+#include "arch.h"
+
+/* Global data structures for external use */
+extern long long int  smp_switch_cycles;
+
 /* Prototypes for external use */
 extern void  init_randomness ();
 extern void  ctrl_c (int  signum);
 extern void  toggle_trace (int signum);
 extern void  reg_sim_reset (void (*reset_hook) (void *), void *dat);
+extern void  reg_sim_done (void (*done_hook) (void *), void *dat);
+extern void  reg_sim_state (void *addr, size_t size);
+extern void  reg_core_state (void *addr, size_t size);
+extern void  reg_sim_states ();
+extern size_t  sim_state_size ();
+extern void  sim_state_save (void *buf);
+extern void  sim_state_load (const void *buf);
+extern void  sim_close ();
 extern void  sim_done ();
 extern void  check_int (void *dat);
 extern void  sim_reset ();
 extern void  sim_init ();
+extern void  smp_init ();
+extern void  smp_next_core ();
+extern void  smp_store (oraddr_t  phys_addr);
+extern void  smp_report_interrupt (int  core,
+				   int  line);
+extern void  smp_clear_interrupt (int  core,
+				  int  line);
+extern void  sim_fork ();
 
 #endif	/* TOPLEVEL_SUPPORT__H */
@@ -83,6 +83,7 @@ main (int   argc,
                      config.sim.exe_bin_insn_log;
 
   sim_init ();
+  smp_init ();
 
 #if DYNAMIC_EXECUTION
   dyn_main ();
@@ -43,6 +43,7 @@
 /* Package includes */
 #include "sim-config.h"
 #include "vapi.h"
+#include "toplevel-support.h"
 
 
 static unsigned int serverIP = 0;
@@ -790,3 +791,20 @@ reg_vapi_sec (void)
   reg_config_param (sec, "vapi_log_file",  PARAMT_STR, vapi_log_fn);
   reg_config_param (sec, "vapi_log_fn",    PARAMT_STR, vapi_log_fn);
 }
+
+
+/*---------------------------------------------------------------------------*/
+/*!Register the VAPI server's state as simulator state                      */
+/*---------------------------------------------------------------------------*/
+void
+reg_vapi_state ()
+{
+  reg_sim_state (&serverIP, sizeof (serverIP));
+  reg_sim_state (&server_fd, sizeof (server_fd));
+  reg_sim_state (&nhandlers, sizeof (nhandlers));
+  reg_sim_state (&tcp_level, sizeof (tcp_level));
+  reg_sim_state (&vapi_handler, sizeof (vapi_handler));
+  reg_sim_state (&fds, sizeof (fds));
+  reg_sim_state (&nfds, sizeof (nfds));
+
+}	/* reg_vapi_state() */
@@ -60,5 +60,6 @@ extern void  vapi_write_log_file (VAPI_COMMAND command,
 				  unsigned long device_id,
 				  unsigned long data);
 extern void  reg_vapi_sec ();
+extern void  reg_vapi_state ();
 
 #endif /* VAPI__H */